@@ -0,0 +1,12 @@
+// bindless table, shared by every effect (set 1)
+// uint push constant members named "...Image" get own image of render size and members named "...Buffer"
+// get own buffer with vec4 per pixel, engine writes their handles, effect indexes arrays below with them
+#extension GL_EXT_nonuniform_qualifier : require  // runtime descriptor arrays
+
+// same images twice: sampled with linear filter and as storage images (render image format)
+layout (set = 1, binding = 0) uniform sampler2D bindlessTextures[];
+layout (set = 1, binding = 1, rgba16f) uniform image2D bindlessImages[];
+
+layout (set = 1, binding = 2) buffer BindlessBuffer {
+    vec4 data[];
+} bindlessBuffers[];
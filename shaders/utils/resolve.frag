@@ -0,0 +1,17 @@
+#version 460
+
+// copies rendered part of render image to swapchain image (scale, format conversion and sRGB encode of sRGB targets in one pass)
+layout (location = 0) in vec2 inUV;
+layout (location = 0) out vec4 outColor;
+
+layout (set = 0, binding = 0) uniform sampler2D renderImage;
+
+layout( push_constant ) uniform constants {
+    vec2 uvScale;  // rendered size / render image size
+    vec2 uvMax;    // center of last rendered texel, so filtering does not read outside of rendered part
+} pc;
+
+void main() {
+    vec2 uv = min(inUV * pc.uvScale, pc.uvMax);
+    outColor = vec4(texture(renderImage, uv).rgb, 1.0);
+}
@@ -1,11 +1,15 @@
-layout (local_size_x = 16, local_size_y = 16) in;
+// workgroup size is specialization constant, so it can be tuned per device (see --autotune)
+layout (local_size_x = 16, local_size_y = 16, local_size_x_id = 100, local_size_y_id = 101) in;
 
-layout (rgba16f, set = 0, binding = 0) uniform writeonly image2D outImage;
+// no format, so effect can write both render image and swapchain image
+// (devices that cannot write images without format get rgba16f when shader is loaded)
+layout (set = 0, binding = 0) uniform writeonly image2D outImage;
 
 layout( push_constant ) uniform constants {
     vec4 data1;
     vec4 data2;
     vec4 data3;
     vec4 data4;
+    vec2 resolution;  // rendered size, can be smaller than outImage when resolution is scaled
 } pc;
 
@@ -1,9 +1,20 @@
 #include "vk-engine.hpp"
 
+#include <spdlog/sinks/stdout_color_sinks.h>
+
 int main(int argc, char *argv[]) {
-    vr::VulkanEngine engine;
+    vr::EngineConfig config;
+    vr::ParseResult parsed = vr::ParseCommandLine(argc, argv, config);
+    if (parsed != vr::ParseResult::Run) {
+        return parsed == vr::ParseResult::Exit ? 0 : 1;
+    }
+
+    // recorded video goes to stdout, so log must not
+    if (config.recordPath == "-") {
+        spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+    }
 
-    engine.Run();
+    vr::VulkanEngine engine(config);
 
-    return 0;
+    return engine.Run();
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <vk-barriers.hpp>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+using namespace vr;
+
+
+struct UsageInfo {
+	VkImageLayout         layout;
+	VkPipelineStageFlags2 stage;
+	VkAccessFlags2        access;
+};
+
+static UsageInfo GetUsageInfo(ImageUsage usage) {
+	switch (usage) {
+		case ImageUsage::ComputeStorage:
+			return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT};
+		case ImageUsage::FragmentSample:
+			return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+		case ImageUsage::ColorAttachment:
+			return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+		case ImageUsage::TransferSrc:
+			return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+		case ImageUsage::TransferDst:
+			return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+		case ImageUsage::Present:
+			// presentation engine waits for semaphore, so nothing after barrier has to wait for it
+			return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+		default:
+			return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+	}
+}
+
+static const VkAccessFlags2 WRITE_ACCESS =
+	VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+
+void BarrierBuilder::Track(VkImage image, ImageUsage usage, VkPipelineStageFlags2 stage) {
+	UsageInfo info = GetUsageInfo(usage);
+
+	ImageState &state = m_images[image];
+	state.usage = usage;
+	state.layout = info.layout;
+	state.stage = stage != VK_PIPELINE_STAGE_2_NONE ? stage : info.stage;
+	state.access = info.access;
+	state.pending = -1;
+}
+
+
+void BarrierBuilder::Forget(VkImage image) {
+	m_images.erase(image);
+}
+
+
+void BarrierBuilder::Transition(VkImage image, ImageUsage usage, bool discard) {
+	UsageInfo to = GetUsageInfo(usage);
+	ImageState &state = m_images[image];
+
+	VkImageLayout oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+	bool hazard = (state.access & WRITE_ACCESS) || (to.access & WRITE_ACCESS);
+
+	// read after read in same layout needs no barrier, later writes wait for both readers
+	if (oldLayout == to.layout && !hazard) {
+		if (state.usage == usage) {
+			Report(state, image, "redundant transition");
+		}
+		state.usage = usage;
+		state.stage |= to.stage;
+		state.access |= to.access;
+		return;
+	}
+
+	if (state.pending >= 0) {
+		// image is transitioned twice before flush, barriers in one call are not ordered, so they are merged into one
+		Report(state, image, "transitioned twice in one batch");
+		VkImageMemoryBarrier2 &barrier = m_batch[state.pending];
+		barrier.dstStageMask = to.stage;
+		barrier.dstAccessMask = to.access;
+		barrier.newLayout = to.layout;
+	} else {
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = state.stage;
+		barrier.srcAccessMask = state.access & WRITE_ACCESS;  // only writes have to be made available
+		barrier.dstStageMask = to.stage;
+		barrier.dstAccessMask = to.access;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = to.layout;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+		state.pending = static_cast<int>(m_batch.size());
+		m_batch.push_back(barrier);
+	}
+
+	state.usage = usage;
+	state.layout = to.layout;
+	state.stage = to.stage;
+	state.access = to.access;
+}
+
+
+void BarrierBuilder::Flush(VkCommandBuffer cmd) {
+	if (m_batch.empty()) {
+		return;
+	}
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_batch.size());
+	depInfo.pImageMemoryBarriers = m_batch.data();
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	for (auto &barrier : m_batch) {
+		m_images[barrier.image].pending = -1;
+	}
+	m_batch.clear();
+}
+
+
+void BarrierBuilder::Check(VkImage image, ImageUsage usage) {
+	if (!m_checks) {
+		return;
+	}
+
+	auto it = m_images.find(image);
+	if (it == m_images.end()) {
+		spdlog::error("Barrier check: image {} is used but not tracked", static_cast<void *>(image));
+		m_images[image].reported = true;
+		return;
+	}
+
+	ImageState &state = it->second;
+	if (state.pending >= 0) {
+		Report(state, image, "used before its barrier was flushed");
+	} else if (state.layout != GetUsageInfo(usage).layout || (state.stage & GetUsageInfo(usage).stage) == 0) {
+		Report(state, image, "missing barrier");
+	}
+}
+
+
+void BarrierBuilder::Report(ImageState &state, VkImage image, const char *message) {
+	// reported once per image, so frame loop does not flood log
+	if (!m_checks || state.reported) {
+		return;
+	}
+	state.reported = true;
+	spdlog::warn("Barrier check: image {} {}", static_cast<void *>(image), message);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vk-types.hpp>
+
+#include <unordered_map>
+
+namespace vr {
+	// how image is used by next commands, every usage has one layout, stage and access
+	enum class ImageUsage : uint32_t {
+		Undefined,        // contents are not needed
+		ComputeStorage,   // storage image read and written by compute shader
+		FragmentSample,   // sampled by fragment shader
+		ColorAttachment,  // rendered to (resolve pass and imgui)
+		TransferSrc,
+		TransferDst,
+		Present,
+	};
+
+	// tracks layout, stage and access of images and emits only barriers that are needed
+	// transitions are collected and recorded together with one vkCmdPipelineBarrier2 in Flush()
+	class BarrierBuilder final {
+	public:
+		// sets state of image without barrier, stage overrides stage of usage
+		// (acquired swapchain image is Undefined at stage where acquire semaphore is waited)
+		void Track(VkImage image, ImageUsage usage, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE);
+		void Forget(VkImage image);
+
+		// discard drops contents (old layout is UNDEFINED), previous accesses are still waited for
+		void Transition(VkImage image, ImageUsage usage, bool discard = false);
+		void Flush(VkCommandBuffer cmd);
+
+		// debug check that image is ready for usage (logs missing barriers once per image)
+		void EnableChecks(bool enable) { m_checks = enable; }
+		void Check(VkImage image, ImageUsage usage);
+
+	private:
+		struct ImageState {
+			ImageUsage            usage = ImageUsage::Undefined;
+			VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2        access = VK_ACCESS_2_NONE;
+			int                   pending = -1;  // index of barrier in batch that is not flushed yet
+			bool                  reported = false;
+		};
+
+		void Report(ImageState &state, VkImage image, const char *message);
+
+	private:
+		std::unordered_map<VkImage, ImageState> m_images;
+		std::vector<VkImageMemoryBarrier2>      m_batch;
+		bool                                    m_checks = false;
+	};
+}
@@ -0,0 +1,184 @@
+#include <vk-benchmark.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+using namespace vr;
+
+
+static std::string EscapeJson(const std::string &text) {
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+	}
+	return escaped;
+}
+
+
+// values are looked up by key in one line, reader only has to understand files written by WriteBenchmarkReport
+static bool FindString(const std::string &line, const char *key, std::string &out) {
+	std::string pattern = fmt::format("\"{}\": \"", key);
+	size_t pos = line.find(pattern);
+	if (pos == std::string::npos) {
+		return false;
+	}
+
+	out.clear();
+	for (size_t i = pos + pattern.size(); i < line.size(); ++i) {
+		if (line[i] == '"') {
+			return true;
+		}
+		if (line[i] == '\\' && i + 1 < line.size()) {
+			++i;
+		}
+		out += line[i];
+	}
+	return false;
+}
+
+static bool FindNumber(const std::string &line, const char *key, float &out) {
+	std::string pattern = fmt::format("\"{}\": ", key);
+	size_t pos = line.find(pattern);
+	if (pos == std::string::npos) {
+		return false;
+	}
+
+	out = std::strtof(line.c_str() + pos + pattern.size(), nullptr);
+	return true;
+}
+
+
+bool vkutils::WriteBenchmarkReport(const std::string &path, const BenchmarkReport &report) {
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "{\n";
+	file << fmt::format("  \"device\": \"{}\",\n", EscapeJson(report.device));
+	file << fmt::format("  \"driver\": \"{}\",\n", EscapeJson(report.driver));
+	file << "  \"results\": [\n";
+
+	for (size_t i = 0; i != report.results.size(); ++i) {
+		const BenchmarkResult &r = report.results[i];
+		file << fmt::format(
+			"    {{\"effect\": \"{}\", \"width\": {}, \"height\": {}, \"frames\": {}, "
+			"\"pacing\": \"{}\", \"frames_in_flight\": {}, "
+			"\"gpu_ms_min\": {:.4f}, \"gpu_ms_avg\": {:.4f}, \"gpu_ms_p99\": {:.4f}, "
+			"\"cpu_submit_ms\": {:.4f}, \"frame_ms\": {:.4f}, \"mpixels_per_s\": {:.2f}, \"allocs_per_frame\": {:.2f}}}{}\n",
+			EscapeJson(r.effect), r.width, r.height, r.frames, r.pacing, r.framesInFlight,
+			r.gpuMinMs, r.gpuAvgMs, r.gpuP99Ms,
+			r.cpuSubmitMs, r.frameMs, r.mpixelsPerSecond, r.allocationsPerFrame,
+			i + 1 != report.results.size() ? "," : "");
+	}
+
+	file << "  ],\n";
+	file << "  \"host\": [\n";
+
+	for (size_t i = 0; i != report.host.size(); ++i) {
+		const HostBenchmarkResult &h = report.host[i];
+		file << fmt::format("    {{\"benchmark\": \"{}\", \"value\": {:.4f}, \"unit\": \"{}\"}}{}\n",
+			EscapeJson(h.name), h.value, EscapeJson(h.unit), i + 1 != report.host.size() ? "," : "");
+	}
+
+	file << "  ]\n";
+	file << "}\n";
+	return file.good();
+}
+
+
+bool vkutils::ReadBenchmarkReport(const std::string &path, BenchmarkReport &report) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	report = BenchmarkReport{};
+
+	std::string line;
+	while (std::getline(file, line)) {
+		BenchmarkResult r;
+		if (!FindString(line, "effect", r.effect)) {
+			HostBenchmarkResult h;
+			if (FindString(line, "benchmark", h.name)) {
+				FindNumber(line, "value", h.value);
+				FindString(line, "unit", h.unit);
+				report.host.push_back(h);
+				continue;
+			}
+			FindString(line, "device", report.device);
+			FindString(line, "driver", report.driver);
+			continue;
+		}
+
+		float width = 0.0f;
+		float height = 0.0f;
+		float frames = 0.0f;
+		float framesInFlight = 0.0f;
+		FindNumber(line, "width", width);
+		FindNumber(line, "height", height);
+		FindNumber(line, "frames", frames);
+		FindNumber(line, "frames_in_flight", framesInFlight);
+		FindString(line, "pacing", r.pacing);
+		r.width = static_cast<uint32_t>(width);
+		r.height = static_cast<uint32_t>(height);
+		r.frames = static_cast<uint32_t>(frames);
+		r.framesInFlight = static_cast<uint32_t>(framesInFlight);
+
+		FindNumber(line, "gpu_ms_min", r.gpuMinMs);
+		FindNumber(line, "gpu_ms_avg", r.gpuAvgMs);
+		FindNumber(line, "gpu_ms_p99", r.gpuP99Ms);
+		FindNumber(line, "cpu_submit_ms", r.cpuSubmitMs);
+		FindNumber(line, "frame_ms", r.frameMs);
+		FindNumber(line, "mpixels_per_s", r.mpixelsPerSecond);
+		FindNumber(line, "allocs_per_frame", r.allocationsPerFrame);
+		report.results.push_back(r);
+	}
+	return true;
+}
+
+
+uint32_t vkutils::CompareBenchmarkReports(const BenchmarkReport &baseline, const BenchmarkReport &current, float tolerance) {
+	if (baseline.device != current.device || baseline.driver != current.driver) {
+		spdlog::warn("Baseline was measured on {} ({}), results are not directly comparable", baseline.device, baseline.driver);
+	}
+
+	uint32_t regressions = 0;
+	for (auto &r : current.results) {
+		// old baselines have no pacing, they are compared with every mode
+		const BenchmarkResult *base = nullptr;
+		for (auto &b : baseline.results) {
+			if (b.effect == r.effect && b.width == r.width && b.height == r.height && (b.pacing.empty() || b.pacing == r.pacing)) {
+				base = &b;
+			}
+		}
+		if (!base) {
+			spdlog::info("{} {}x{} {}: not in baseline", r.effect, r.width, r.height, r.pacing);
+			continue;
+		}
+
+		// gpu time is steadier than wall time, wall time is used only when device has no timestamps
+		bool useGpu = r.gpuAvgMs > 0.0f && base->gpuAvgMs > 0.0f;
+		float now = useGpu ? r.gpuAvgMs : r.frameMs;
+		float before = useGpu ? base->gpuAvgMs : base->frameMs;
+		if (before <= 0.0f) {
+			continue;
+		}
+
+		float change = now / before - 1.0f;
+		if (change > tolerance) {
+			regressions++;
+			spdlog::error("{} {}x{} {}: REGRESSION {:.3f}ms -> {:.3f}ms ({:+.1f}%)", r.effect, r.width, r.height, r.pacing, before, now, change * 100.0f);
+		} else {
+			spdlog::info("{} {}x{} {}: {:.3f}ms -> {:.3f}ms ({:+.1f}%)", r.effect, r.width, r.height, r.pacing, before, now, change * 100.0f);
+		}
+	}
+	return regressions;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vr {
+	// measurements of one effect at one resolution
+	struct BenchmarkResult {
+		std::string effect;
+		uint32_t    width = 0;
+		uint32_t    height = 0;
+		uint32_t    frames = 0;
+		std::string pacing;                 // frame pacing mode (empty in reports written before pacing was measured)
+		uint32_t    framesInFlight = 0;
+		float       gpuMinMs = 0.0f;      // dispatch time from timestamp queries (zero if device has no timestamps)
+		float       gpuAvgMs = 0.0f;
+		float       gpuP99Ms = 0.0f;
+		float       cpuSubmitMs = 0.0f;   // recording and submitting one frame
+		float       frameMs = 0.0f;       // wall time per frame, including waits
+		float       mpixelsPerSecond = 0.0f;
+		float       allocationsPerFrame = 0.0f;  // heap allocations of main thread per measured frame
+	};
+
+	// host side measurement (--benchmark-host), for example cost of one queue operation
+	struct HostBenchmarkResult {
+		std::string name;   // dotted, like "deletion_queue.typed.push"
+		float       value = 0.0f;
+		std::string unit;
+	};
+
+	struct BenchmarkReport {
+		std::string                      device;
+		std::string                      driver;
+		std::vector<BenchmarkResult>     results;
+		std::vector<HostBenchmarkResult> host;  // not compared with baseline, they depend on cpu and disk more than on effects
+	};
+}
+
+namespace vkutils {
+	// report is JSON with one result object per line, so it is easy to diff and to read back
+	bool WriteBenchmarkReport(const std::string &path, const vr::BenchmarkReport &report);
+	bool ReadBenchmarkReport(const std::string &path, vr::BenchmarkReport &report);
+
+	// logs every result that is slower than baseline by more than tolerance, returns number of regressions
+	uint32_t CompareBenchmarkReports(const vr::BenchmarkReport &baseline, const vr::BenchmarkReport &current, float tolerance);
+}
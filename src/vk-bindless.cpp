@@ -0,0 +1,170 @@
+#include <vk-bindless.hpp>
+#include <vk-descriptors.hpp>
+
+#include <algorithm>
+
+using namespace vr;
+
+
+// upper limit of every array, devices allow much more but effects need only few
+static const uint32_t MAX_TABLE_SIZE = 1024;
+
+
+void BindlessTable::Init(VkDevice device, VkPhysicalDevice physicalDevice) {
+	m_device = device;
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexing{};
+	indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexing;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	// combined image samplers count as both sampled images and samplers
+	m_images.capacity = std::min({MAX_TABLE_SIZE,
+		indexing.maxPerStageDescriptorUpdateAfterBindSampledImages, indexing.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexing.maxPerStageDescriptorUpdateAfterBindStorageImages, indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexing.maxDescriptorSetUpdateAfterBindStorageImages});
+	m_buffers.capacity = std::min({MAX_TABLE_SIZE,
+		indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexing.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+	// descriptors are written while frames that use other elements are in flight
+	const VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+	DescriptorLayoutBuilder builder;
+	builder.AddBinding(SampledImages, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_images.capacity, flags);
+	builder.AddBinding(StorageImages, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_images.capacity, flags);
+	builder.AddBinding(StorageBuffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_buffers.capacity, flags);
+	m_layout = builder.Build(m_device, VK_SHADER_STAGE_COMPUTE_BIT, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+	VkDescriptorPoolSize poolSizes[] = {
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_images.capacity},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_images.capacity},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_buffers.capacity},
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+	VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool));
+
+	VkDescriptorSetAllocateInfo setInfo{};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = m_pool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &m_layout;
+	VK_CHECK(vkAllocateDescriptorSets(m_device, &setInfo, &m_set));
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	VK_CHECK(vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler));
+
+	spdlog::info("Bindless table: {} images, {} buffers", m_images.capacity, m_buffers.capacity);
+}
+
+
+void BindlessTable::Destroy() {
+	vkDestroySampler(m_device, m_sampler, nullptr);
+	vkDestroyDescriptorPool(m_device, m_pool, nullptr);  // frees set
+	vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+}
+
+
+uint32_t BindlessTable::AddImage(VkImageView imageView) {
+	uint32_t handle = m_images.Allocate();
+	if (handle == INVALID_HANDLE) {
+		spdlog::error("Bindless table has no free image handle ({} are used)", m_images.capacity);
+		return handle;
+	}
+
+	VkDescriptorImageInfo sampled{m_sampler, imageView, VK_IMAGE_LAYOUT_GENERAL};
+	VkDescriptorImageInfo storage{VK_NULL_HANDLE, imageView, VK_IMAGE_LAYOUT_GENERAL};
+
+	VkWriteDescriptorSet writes[2]{};
+	for (uint32_t i = 0; i != 2; ++i) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_set;
+		writes[i].dstArrayElement = handle;
+		writes[i].descriptorCount = 1;
+	}
+	writes[0].dstBinding = SampledImages;
+	writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writes[0].pImageInfo = &sampled;
+	writes[1].dstBinding = StorageImages;
+	writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	writes[1].pImageInfo = &storage;
+	vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+
+	return handle;
+}
+
+
+uint32_t BindlessTable::AddBuffer(VkBuffer buffer) {
+	uint32_t handle = m_buffers.Allocate();
+	if (handle == INVALID_HANDLE) {
+		spdlog::error("Bindless table has no free buffer handle ({} are used)", m_buffers.capacity);
+		return handle;
+	}
+
+	VkDescriptorBufferInfo bufferInfo{buffer, 0, VK_WHOLE_SIZE};
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_set;
+	write.dstBinding = StorageBuffers;
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+	return handle;
+}
+
+
+void BindlessTable::RemoveImage(uint32_t handle) {
+	// descriptor stays until handle is reused, partially bound arrays do not need it cleared
+	if (handle != INVALID_HANDLE) {
+		m_images.Release(handle);
+	}
+}
+
+
+void BindlessTable::RemoveBuffer(uint32_t handle) {
+	if (handle != INVALID_HANDLE) {
+		m_buffers.Release(handle);
+	}
+}
+
+
+bool BindlessTable::IsTableBinding(const DescriptorBinding &binding) {
+	if (binding.set != SET || binding.count != 0) {
+		return false;
+	}
+
+	switch (binding.binding) {
+		case SampledImages:  return binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case StorageImages:  return binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		case StorageBuffers: return binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		default:             return false;
+	}
+}
+
+
+uint32_t BindlessTable::Handles::Allocate() {
+	if (!free.empty()) {
+		uint32_t handle = free.back();
+		free.pop_back();
+		return handle;
+	}
+	return next < capacity ? next++ : INVALID_HANDLE;
+}
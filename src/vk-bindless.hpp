@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vk-types.hpp>
+#include <vk-reflection.hpp>
+
+namespace vr {
+	// one global update after bind descriptor set with large arrays, shared by every effect pipeline
+	// effects index arrays with handles from their push constants, so adding image or buffer does not touch layouts
+	// images get one handle for both arrays (sampled and storage), they stay in GENERAL layout
+	class BindlessTable final {
+	public:
+		enum Binding : uint32_t {
+			SampledImages  = 0,  // sampler2D[], linear filter, clamp to edge
+			StorageImages  = 1,  // image2D[]
+			StorageBuffers = 2,  // buffer[]
+		};
+
+		// set index that effects declare table at (see shaders/utils/bindless.glsl)
+		static constexpr uint32_t SET = 1;
+		static constexpr uint32_t INVALID_HANDLE = ~0u;
+
+		void Init(VkDevice device, VkPhysicalDevice physicalDevice);
+		void Destroy();
+
+		// returns INVALID_HANDLE when array is full
+		uint32_t AddImage(VkImageView imageView);
+		uint32_t AddBuffer(VkBuffer buffer);
+
+		// handle is reused by next add, so frames that can use it have to be finished
+		void RemoveImage(uint32_t handle);
+		void RemoveBuffer(uint32_t handle);
+
+		// binding that table provides (runtime array in SET with matching index and type)
+		static bool IsTableBinding(const DescriptorBinding &binding);
+
+		VkDescriptorSetLayout GetLayout() const { return m_layout; }
+		VkDescriptorSet GetSet() const { return m_set; }
+
+	private:
+		// free handles of one array, never freed handles are above next
+		struct Handles {
+			uint32_t              capacity = 0;
+			uint32_t              next = 0;
+			std::vector<uint32_t> free;
+
+			uint32_t Allocate();
+			void Release(uint32_t handle) { free.push_back(handle); }
+		};
+
+	private:
+		VkDevice              m_device = VK_NULL_HANDLE;
+		VkDescriptorPool      m_pool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+		VkDescriptorSet       m_set = VK_NULL_HANDLE;
+		VkSampler             m_sampler = VK_NULL_HANDLE;
+		Handles               m_images;
+		Handles               m_buffers;
+	};
+}
@@ -0,0 +1,481 @@
+#include <vk-config.hpp>
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace vr;
+
+
+static void PrintUsage(const char *program) {
+	std::printf(
+		"Usage: %s [options]\n"
+		"\n"
+		"Options:\n"
+		"  --headless           render offscreen without window and write frames to disk\n"
+		"  --width <px>         headless render width (default 1280)\n"
+		"  --height <px>        headless render height (default 720)\n"
+		"  --frames <n>         number of headless frames to render (default 60)\n"
+		"  --time-step <s>      time between headless frames in seconds (default 1/60)\n"
+		"  --output <dir>       directory for rendered frames (default \"frames\")\n"
+		"  --frame-format <ppm|exr|raw>\n"
+		"                       file format of frames and screenshots, exr and raw keep half floats (default ppm)\n"
+		"  --exr-compression <none|rle|zip>\n"
+		"                       compression of EXR files (default zip)\n"
+		"  --write-backend <auto|io_uring|pwrite>\n"
+		"                       how raw frame files are written (default auto, io_uring when available)\n"
+		"  --write-threads <n>  threads of pwrite backend (default 2)\n"
+		"  --direct-io          write raw frame files with O_DIRECT to preallocated files\n"
+		"  --effect <name>      effect selected at startup\n"
+		"  --render-scale <f>   render resolution relative to window (default 1)\n"
+		"  --frame-budget <ms>  scale resolution down to keep GPU frame time under budget (default 0, off)\n"
+		"  --min-render-scale <f>\n"
+		"                       lowest scale used by frame budget (default 0.25)\n"
+		"  --no-swapchain-writes\n"
+		"                       always render to render image and resolve it to window\n"
+		"  --no-async-compute   dispatch effects on graphics queue even if device has compute queue\n"
+		"  --prerecorded-frames record command buffers once per effect and reuse them while overlay is hidden\n"
+		"  --parameter-ring <KiB>\n"
+		"                       memory for parameter blocks of one frame (default 1024)\n"
+		"  --readback-buffers <n>\n"
+		"                       staging buffers for frames copied to host (default 4)\n"
+		"  --record <file|->    record every frame as video to file or stdout (\"-\")\n"
+		"  --record-format <raw|bgra|y4m>\n"
+		"                       raw RGBA8 or BGRA8 frames or YUV 4:2:0 Y4M stream (default y4m)\n"
+		"  --record-fps <n>     frame rate written to stream (default 60)\n"
+		"  --record-threads <n> threads that convert recorded frames (default 2)\n"
+		"  --export-srgb        sRGB encode exported frames (for effects that output linear values)\n"
+		"  --convert-threads <n>\n"
+		"                       threads that convert and compress frame files and screenshots (default 0, one per core)\n"
+		"  --frames-in-flight <n>\n"
+		"                       frames recorded while gpu works on earlier ones, 1 to 4 (default 2)\n"
+		"  --frame-pacing <timeline|fence>\n"
+		"                       how cpu waits for frame slots (default timeline)\n"
+		"  --pipeline-cache <file>\n"
+		"                       pipeline cache file (default \"pipeline_cache.bin\")\n"
+		"  --no-pipeline-cache  do not load or save pipeline cache\n"
+		"  --pipeline-cache-checkpoint <s>\n"
+		"                       seconds between pipeline cache saves (default 30)\n"
+		"  --compile-threads <n>\n"
+		"                       threads that build pipelines (default 0, one per core)\n"
+		"  --on-demand-pipelines\n"
+		"                       build only selected effect at startup, others in background\n"
+		"  --no-hot-reload      do not recompile effects when shader sources change\n"
+		"  --autotune           measure workgroup sizes of all effects offscreen, save best ones and exit\n"
+		"  --workgroup-sizes <file>\n"
+		"                       file with tuned workgroup sizes (default \"workgroup_sizes.txt\")\n"
+		"  --gpu-profile <file> write GPU time of every frame phase to file as JSON lines\n"
+		"  --check-allocations  fail with exit code 3 if steady state frames allocate on heap\n"
+		"  --benchmark          measure all effects offscreen (or only --effect) and write JSON report\n"
+		"  --benchmark-resolutions <WxH,...>\n"
+		"                       resolutions to measure (default 1280x720,1920x1080)\n"
+		"  --benchmark-pacing <mode,...>\n"
+		"                       frame pacing modes to measure (default timeline,fence)\n"
+		"  --benchmark-warmup <n>\n"
+		"                       frames rendered before measuring (default 20)\n"
+		"  --benchmark-frames <n>\n"
+		"                       measured frames (default 200)\n"
+		"  --benchmark-output <file>\n"
+		"                       report file (default \"benchmark.json\")\n"
+		"  --benchmark-baseline <file>\n"
+		"                       compare with earlier report, exit code is 2 if anything got slower\n"
+		"  --benchmark-tolerance <f>\n"
+		"                       slowdown that counts as regression (default 0.1, 10%%)\n"
+		"  --benchmark-host     also measure host side code and add it to report\n"
+		"  --benchmark-writers  also measure frame writers (writes about 2 GB to output dir)\n"
+		"  --help               show this message\n",
+		program
+	);
+}
+
+
+// reads value of option at argv[i + 1] and advances i
+static const char *NextValue(int argc, char *argv[], int &i) {
+	if (i + 1 >= argc) {
+		std::fprintf(stderr, "Missing value for option %s\n", argv[i]);
+		return nullptr;
+	}
+	return argv[++i];
+}
+
+// whole value has to be number, strtoul would take "-1" as huge value and "abc" as 0
+static bool ReadValue(int argc, char *argv[], int &i, uint32_t &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	char *end = nullptr;
+	errno = 0;
+	unsigned long number = std::isdigit(static_cast<unsigned char>(value[0])) ? std::strtoul(value, &end, 10) : 0;
+	if (!end || *end != '\0' || errno == ERANGE || number > UINT32_MAX) {
+		std::fprintf(stderr, "Invalid value for option %s: %s (expected non-negative integer)\n", argv[i - 1], value);
+		return false;
+	}
+	out = static_cast<uint32_t>(number);
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, float &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	char *end = nullptr;
+	errno = 0;
+	float number = std::strtof(value, &end);
+	if (end == value || *end != '\0' || errno == ERANGE || !std::isfinite(number)) {
+		std::fprintf(stderr, "Invalid value for option %s: %s (expected number)\n", argv[i - 1], value);
+		return false;
+	}
+	out = number;
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, std::string &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+	out = value;
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, RecordFormat &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	if (std::strcmp(value, "raw") == 0) {
+		out = RecordFormat::Raw;
+	} else if (std::strcmp(value, "bgra") == 0) {
+		out = RecordFormat::RawBgra;
+	} else if (std::strcmp(value, "y4m") == 0) {
+		out = RecordFormat::Y4M;
+	} else {
+		std::fprintf(stderr, "Invalid record format: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, FrameFileFormat &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	if (std::strcmp(value, "ppm") == 0) {
+		out = FrameFileFormat::Ppm;
+	} else if (std::strcmp(value, "exr") == 0) {
+		out = FrameFileFormat::Exr;
+	} else if (std::strcmp(value, "raw") == 0) {
+		out = FrameFileFormat::Raw;
+	} else {
+		std::fprintf(stderr, "Invalid frame format: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, ExrCompression &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	if (std::strcmp(value, "none") == 0) {
+		out = ExrCompression::None;
+	} else if (std::strcmp(value, "rle") == 0) {
+		out = ExrCompression::Rle;
+	} else if (std::strcmp(value, "zip") == 0) {
+		out = ExrCompression::Zip;
+	} else {
+		std::fprintf(stderr, "Invalid EXR compression: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, WriteBackend &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	if (std::strcmp(value, "auto") == 0) {
+		out = WriteBackend::Auto;
+	} else if (std::strcmp(value, "io_uring") == 0) {
+		out = WriteBackend::IoUring;
+	} else if (std::strcmp(value, "pwrite") == 0) {
+		out = WriteBackend::Pwrite;
+	} else {
+		std::fprintf(stderr, "Invalid write backend: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool ParseFramePacing(const char *value, size_t length, FramePacing &out) {
+	if (length == 8 && std::strncmp(value, "timeline", length) == 0) {
+		out = FramePacing::Timeline;
+	} else if (length == 5 && std::strncmp(value, "fence", length) == 0) {
+		out = FramePacing::Fence;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static bool ReadValue(int argc, char *argv[], int &i, FramePacing &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	if (!ParseFramePacing(value, std::strlen(value), out)) {
+		std::fprintf(stderr, "Invalid frame pacing: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+// comma separated list like "timeline,fence"
+static bool ReadValue(int argc, char *argv[], int &i, std::vector<FramePacing> &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	out.clear();
+	for (const char *p = value; ; ) {
+		const char *end = std::strchr(p, ',');
+		size_t length = end ? static_cast<size_t>(end - p) : std::strlen(p);
+
+		FramePacing pacing;
+		if (!ParseFramePacing(p, length, pacing)) {
+			std::fprintf(stderr, "Invalid frame pacing list: %s\n", value);
+			return false;
+		}
+		out.push_back(pacing);
+
+		if (!end) break;
+		p = end + 1;
+	}
+	return true;
+}
+
+// comma separated list like "1280x720,1920x1080"
+static bool ReadValue(int argc, char *argv[], int &i, std::vector<Resolution> &out) {
+	const char *value = NextValue(argc, argv, i);
+	if (!value) return false;
+
+	out.clear();
+	const char *p = value;
+	while (*p) {
+		char *end;
+		Resolution resolution{};
+		if (!std::isdigit(static_cast<unsigned char>(*p))) break;
+		resolution.width = static_cast<uint32_t>(std::strtoul(p, &end, 10));
+		if (*end != 'x' || !std::isdigit(static_cast<unsigned char>(end[1]))) break;
+		resolution.height = static_cast<uint32_t>(std::strtoul(end + 1, &end, 10));
+		if (resolution.width == 0 || resolution.height == 0 || (*end != ',' && *end != '\0')) break;
+
+		out.push_back(resolution);
+		p = *end == ',' ? end + 1 : end;
+	}
+
+	if (*p || out.empty()) {
+		std::fprintf(stderr, "Invalid resolution list: %s\n", value);
+		return false;
+	}
+	return true;
+}
+
+
+ParseResult vr::ParseCommandLine(int argc, char *argv[], EngineConfig &config) {
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+
+		if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+			PrintUsage(argv[0]);
+			return ParseResult::Exit;
+		} else if (std::strcmp(arg, "--headless") == 0) {
+			config.headless = true;
+		} else if (std::strcmp(arg, "--width") == 0) {
+			if (!ReadValue(argc, argv, i, config.width)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--height") == 0) {
+			if (!ReadValue(argc, argv, i, config.height)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--frames") == 0) {
+			if (!ReadValue(argc, argv, i, config.frameCount)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--time-step") == 0) {
+			if (!ReadValue(argc, argv, i, config.timeStep)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--output") == 0) {
+			if (!ReadValue(argc, argv, i, config.outputDir)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--frame-format") == 0) {
+			if (!ReadValue(argc, argv, i, config.frameFormat)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--exr-compression") == 0) {
+			if (!ReadValue(argc, argv, i, config.exrCompression)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--write-backend") == 0) {
+			if (!ReadValue(argc, argv, i, config.writeBackend)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--write-threads") == 0) {
+			if (!ReadValue(argc, argv, i, config.writeThreads)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--direct-io") == 0) {
+			config.directIo = true;
+		} else if (std::strcmp(arg, "--effect") == 0) {
+			if (!ReadValue(argc, argv, i, config.effectName)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--render-scale") == 0) {
+			if (!ReadValue(argc, argv, i, config.renderScale)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--frame-budget") == 0) {
+			if (!ReadValue(argc, argv, i, config.frameBudgetMs)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--min-render-scale") == 0) {
+			if (!ReadValue(argc, argv, i, config.minRenderScale)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--no-swapchain-writes") == 0) {
+			config.swapChainWrites = false;
+		} else if (std::strcmp(arg, "--no-async-compute") == 0) {
+			config.asyncCompute = false;
+		} else if (std::strcmp(arg, "--prerecorded-frames") == 0) {
+			config.prerecordedFrames = true;
+		} else if (std::strcmp(arg, "--parameter-ring") == 0) {
+			if (!ReadValue(argc, argv, i, config.parameterRingKiB)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--readback-buffers") == 0) {
+			if (!ReadValue(argc, argv, i, config.readbackBuffers)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--record") == 0) {
+			if (!ReadValue(argc, argv, i, config.recordPath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--record-format") == 0) {
+			if (!ReadValue(argc, argv, i, config.recordFormat)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--record-fps") == 0) {
+			if (!ReadValue(argc, argv, i, config.recordFps)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--record-threads") == 0) {
+			if (!ReadValue(argc, argv, i, config.recordThreads)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--export-srgb") == 0) {
+			config.exportSrgb = true;
+		} else if (std::strcmp(arg, "--convert-threads") == 0) {
+			if (!ReadValue(argc, argv, i, config.convertThreads)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--frames-in-flight") == 0) {
+			if (!ReadValue(argc, argv, i, config.framesInFlight)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--frame-pacing") == 0) {
+			if (!ReadValue(argc, argv, i, config.framePacing)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--pipeline-cache") == 0) {
+			if (!ReadValue(argc, argv, i, config.pipelineCachePath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--no-pipeline-cache") == 0) {
+			config.pipelineCachePath.clear();
+		} else if (std::strcmp(arg, "--pipeline-cache-checkpoint") == 0) {
+			if (!ReadValue(argc, argv, i, config.pipelineCacheCheckpoint)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--compile-threads") == 0) {
+			if (!ReadValue(argc, argv, i, config.compileThreads)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--on-demand-pipelines") == 0) {
+			config.onDemandPipelines = true;
+		} else if (std::strcmp(arg, "--no-hot-reload") == 0) {
+			config.hotReload = false;
+		} else if (std::strcmp(arg, "--autotune") == 0) {
+			config.autotune = true;
+			config.headless = true;  // tuning does not need window
+		} else if (std::strcmp(arg, "--workgroup-sizes") == 0) {
+			if (!ReadValue(argc, argv, i, config.workgroupSizesPath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--gpu-profile") == 0) {
+			if (!ReadValue(argc, argv, i, config.gpuProfilePath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--check-allocations") == 0) {
+			config.checkAllocations = true;
+		} else if (std::strcmp(arg, "--benchmark") == 0) {
+			config.benchmark = true;
+			config.headless = true;  // frames are not presented or written
+		} else if (std::strcmp(arg, "--benchmark-resolutions") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkResolutions)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-pacing") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkPacing)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-warmup") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkWarmupFrames)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-frames") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkFrames)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-output") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkOutputPath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-baseline") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkBaselinePath)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-tolerance") == 0) {
+			if (!ReadValue(argc, argv, i, config.benchmarkTolerance)) return ParseResult::Invalid;
+		} else if (std::strcmp(arg, "--benchmark-host") == 0) {
+			config.benchmarkHost = true;
+		} else if (std::strcmp(arg, "--benchmark-writers") == 0) {
+			config.benchmarkWriters = true;
+		} else {
+			std::fprintf(stderr, "Unknown option: %s\n", arg);
+			PrintUsage(argv[0]);
+			return ParseResult::Invalid;
+		}
+	}
+
+	if (config.width == 0 || config.height == 0) {
+		std::fprintf(stderr, "Render resolution must not be zero\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.renderScale <= 0.0f || config.minRenderScale <= 0.0f || config.minRenderScale > 1.0f) {
+		std::fprintf(stderr, "Render scale must be positive and minimum scale must not be above 1\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.frameCount == 0) {
+		std::fprintf(stderr, "Frame count must not be zero\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.timeStep <= 0.0f || config.timeStep > 60.0f) {
+		std::fprintf(stderr, "Time step must be above 0 and at most 60 seconds\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.writeThreads == 0 || config.writeThreads > 64) {
+		std::fprintf(stderr, "Write threads must be between 1 and 64\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.framesInFlight == 0 || config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+		std::fprintf(stderr, "Frames in flight must be between 1 and %u\n", MAX_FRAMES_IN_FLIGHT);
+		return ParseResult::Invalid;
+	}
+
+	if (config.readbackBuffers == 0 || config.readbackBuffers > 32) {
+		std::fprintf(stderr, "Readback buffers must be between 1 and 32\n");
+		return ParseResult::Invalid;
+	}
+
+	if (!config.recordPath.empty() && (config.recordFps == 0 || config.recordThreads == 0)) {
+		std::fprintf(stderr, "Recording needs non-zero frame rate and threads\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.parameterRingKiB == 0) {
+		std::fprintf(stderr, "Parameter ring must not be empty\n");
+		return ParseResult::Invalid;
+	}
+
+	if (config.benchmark && config.benchmarkFrames == 0) {
+		std::fprintf(stderr, "Benchmark needs at least one measured frame\n");
+		return ParseResult::Invalid;
+	}
+
+	return ParseResult::Run;
+}
+
+
+const char *vr::FramePacingName(FramePacing pacing) {
+	return pacing == FramePacing::Fence ? "fence" : "timeline";
+}
+
+
+const char *vr::RecordFormatName(RecordFormat format) {
+	switch (format) {
+		case RecordFormat::Raw:     return "raw";
+		case RecordFormat::RawBgra: return "bgra";
+		case RecordFormat::Y4M:     return "y4m";
+		default:                    return "unknown";
+	}
+}
+
+
+const char *vr::ExrCompressionName(ExrCompression compression) {
+	switch (compression) {
+		case ExrCompression::None: return "none";
+		case ExrCompression::Rle:  return "rle";
+		case ExrCompression::Zip:  return "zip";
+		default:                   return "unknown";
+	}
+}
+
+
+const char *vr::WriteBackendName(WriteBackend backend) {
+	switch (backend) {
+		case WriteBackend::Auto:    return "auto";
+		case WriteBackend::IoUring: return "io_uring";
+		case WriteBackend::Pwrite:  return "pwrite";
+		default:                    return "unknown";
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vr {
+	struct Resolution {
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// how cpu waits until frame slot can be reused
+	enum class FramePacing {
+		Timeline,  // one timeline semaphore, frame waits for value its slot signalled last time
+		Fence,     // fence per frame slot
+	};
+
+	// container of recorded video
+	enum class RecordFormat {
+		Raw,      // RGBA8 frames one after another
+		RawBgra,  // BGRA8 frames one after another
+		Y4M,  // YUV4MPEG2 with YUV 4:2:0 frames
+	};
+
+	// file format of headless frames and screenshots
+	enum class FrameFileFormat {
+		Ppm,  // 8 bit RGB
+		Exr,  // half float RGBA as rendered
+		Raw,  // half float RGBA bytes of staging buffer, no header, written in background
+	};
+
+	// compression of EXR scanline blocks
+	enum class ExrCompression {
+		None,
+		Rle,
+		Zip,
+	};
+
+	// how raw frame files are written
+	enum class WriteBackend {
+		Auto,     // io_uring when kernel allows it, pwrite otherwise
+		IoUring,  // linux only
+		Pwrite,   // blocking writes on writer threads
+	};
+
+	const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+	// engine options that can be changed from command line
+	struct EngineConfig {
+		// headless mode renders offscreen without window, surface and swapchain
+		bool        headless = false;
+		uint32_t    width = 1280;
+		uint32_t    height = 720;
+		uint32_t    frameCount = 60;
+		float       timeStep = 1.0f / 60.0f;  // fixed time step between headless frames (in seconds)
+		std::string outputDir = "frames";     // rendered frames are written here
+		FrameFileFormat frameFormat = FrameFileFormat::Ppm;
+		ExrCompression  exrCompression = ExrCompression::Zip;
+		WriteBackend    writeBackend = WriteBackend::Auto;  // of raw frame files
+		uint32_t        writeThreads = 2;                   // threads of pwrite backend
+		bool            directIo = false;                   // O_DIRECT writes to preallocated files, past page cache (linux)
+
+		// window mode renders at swapchain size times scale
+		// with frame budget, part of render image that is used is scaled down further to keep gpu frame time under budget
+		float       renderScale = 1.0f;
+		float       frameBudgetMs = 0.0f;    // 0 disables dynamic resolution
+		float       minRenderScale = 0.25f;  // lowest dynamic scale
+
+		// effects write swapchain image directly when surface supports it and image does not have to be scaled
+		bool        swapChainWrites = true;
+
+		// effect dispatch runs on separate compute queue (if device has one) and overlaps present of previous frame
+		bool        asyncCompute = true;
+
+		// command buffers are recorded once per effect, swapchain image and frame slot and submitted again every frame
+		// (effect parameters are read from buffer, so frame only copies them; frames with overlay are recorded as usual)
+		bool        prerecordedFrames = false;
+
+		// parameter blocks (buffer references in push constants) of one frame are copied to ring part of this size
+		uint32_t    parameterRingKiB = 1024;
+
+		// staging buffers that frames are copied to for screenshots and headless output
+		// copies are dropped in window mode when all are busy, headless mode waits for oldest one
+		uint32_t    readbackBuffers = 4;
+
+		// video recording of every frame, to file or stdout ("-"), empty disables it
+		std::string  recordPath;
+		RecordFormat recordFormat = RecordFormat::Y4M;
+		uint32_t     recordFps = 60;        // frame rate in stream header (headless frames advance by time step)
+		uint32_t     recordThreads = 2;     // threads that convert frames to 8 bit
+
+		// exported frames (files, screenshots, recording) are sRGB encoded, for effects that output linear values
+		// otherwise they are stored as displayed (swapchain is UNORM and gets values as they are)
+		bool        exportSrgb = false;
+		uint32_t    convertThreads = 0;  // threads that convert and compress frame files and screenshots (0 means one per core)
+
+		// more frames in flight give more throughput and more latency (1 to MAX_FRAMES_IN_FLIGHT)
+		uint32_t    framesInFlight = 2;
+		FramePacing framePacing = FramePacing::Timeline;
+
+		// effect that is selected at startup (by name, empty means first effect)
+		std::string effectName;
+
+		// pipeline cache file (empty disables cache)
+		std::string pipelineCachePath = "pipeline_cache.bin";
+		float       pipelineCacheCheckpoint = 30.0f;  // seconds between checkpoint saves
+
+		// pipeline building
+		uint32_t    compileThreads = 0;        // 0 means one per core
+		bool        onDemandPipelines = false; // build only selected effect before first frame
+
+		// recompile effects when their sources change (ignored in headless mode)
+		bool        hotReload = true;
+
+		// workgroup sizes measured by autotune, stored per device (empty disables file)
+		bool        autotune = false;  // measure all effects, save best sizes and exit
+		std::string workgroupSizesPath = "workgroup_sizes.txt";
+
+		// gpu timings of every frame as JSON lines (empty disables export)
+		std::string gpuProfilePath;
+
+		// frames after warmup must not allocate on heap, exit code is 3 if one did
+		bool        checkAllocations = false;
+
+		// benchmark renders every effect (or only selected one) at every resolution offscreen
+		bool                    benchmark = false;
+		std::vector<Resolution> benchmarkResolutions = {{1280, 720}, {1920, 1080}};
+		std::vector<FramePacing> benchmarkPacing = {FramePacing::Timeline, FramePacing::Fence};  // every effect is measured with each
+		uint32_t                benchmarkWarmupFrames = 20;
+		uint32_t                benchmarkFrames = 200;
+		std::string             benchmarkOutputPath = "benchmark.json";
+		std::string             benchmarkBaselinePath;         // earlier report to compare with (empty disables comparison)
+		float                   benchmarkTolerance = 0.1f;     // slowdown that is reported as regression (0.1 is 10%)
+		bool                    benchmarkHost = false;         // also measure host side code (queues, conversion, compression)
+		bool                    benchmarkWriters = false;      // also write frames with every write backend (about 2 GB to output dir)
+	};
+
+	enum class ParseResult {
+		Run,
+		Exit,     // help was printed, application exits successfully
+		Invalid,  // arguments are invalid, error was printed
+	};
+
+	ParseResult ParseCommandLine(int argc, char *argv[], EngineConfig &config);
+
+	const char *FramePacingName(FramePacing pacing);
+	const char *RecordFormatName(RecordFormat format);
+	const char *ExrCompressionName(ExrCompression compression);
+	const char *WriteBackendName(WriteBackend backend);
+}
@@ -0,0 +1,201 @@
+#include <vk-deletion-queue.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+using namespace vr;
+
+
+void HandleDeletionQueue::Init(VkDevice device, VmaAllocator allocator, BindlessTable *bindless) {
+	m_device = device;
+	m_allocator = allocator;
+	m_bindless = bindless;
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, VkPipeline pipeline) {
+	m_pipelines.Push(value, pipeline);
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, VkPipelineLayout layout) {
+	m_layouts.Push(value, layout);
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, VkDescriptorPool pool) {
+	m_descriptorPools.Push(value, pool);
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, VkImageView imageView) {
+	m_imageViews.Push(value, imageView);
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, const AllocatedImage &image) {
+	m_images.Push(value, {image.imageView, image.image, image.allocation});
+}
+
+
+void HandleDeletionQueue::Push(uint64_t value, const AllocatedBuffer &buffer) {
+	m_buffers.Push(value, {buffer.buffer, buffer.allocation});
+}
+
+
+void HandleDeletionQueue::PushBindlessImage(uint64_t value, uint32_t handle) {
+	m_bindlessImages.Push(value, handle);
+}
+
+
+void HandleDeletionQueue::PushBindlessBuffer(uint64_t value, uint32_t handle) {
+	m_bindlessBuffers.Push(value, handle);
+}
+
+
+void HandleDeletionQueue::PushFunction(uint64_t value, std::function<void()> &&function) {
+	m_functions.values.push_back(value);
+	m_functions.handles.push_back(std::move(function));
+}
+
+
+void HandleDeletionQueue::Flush(uint64_t completedValue) {
+	size_t count = m_functions.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		m_functions.handles[i]();
+	}
+	m_functions.Drop(count);
+
+	// table entries only point to resources, they are released first
+	count = m_bindlessImages.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		m_bindless->RemoveImage(m_bindlessImages.handles[i]);
+	}
+	m_bindlessImages.Drop(count);
+
+	count = m_bindlessBuffers.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		m_bindless->RemoveBuffer(m_bindlessBuffers.handles[i]);
+	}
+	m_bindlessBuffers.Drop(count);
+
+	count = m_pipelines.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		vkDestroyPipeline(m_device, m_pipelines.handles[i], nullptr);
+	}
+	m_pipelines.Drop(count);
+
+	count = m_layouts.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		vkDestroyPipelineLayout(m_device, m_layouts.handles[i], nullptr);
+	}
+	m_layouts.Drop(count);
+
+	count = m_descriptorPools.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPools.handles[i], nullptr);
+	}
+	m_descriptorPools.Drop(count);
+
+	count = m_imageViews.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		vkDestroyImageView(m_device, m_imageViews.handles[i], nullptr);
+	}
+	m_imageViews.Drop(count);
+
+	count = m_images.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		const ImageHandles &image = m_images.handles[i];
+		vkDestroyImageView(m_device, image.view, nullptr);
+		vmaDestroyImage(m_allocator, image.image, image.allocation);
+	}
+	m_images.Drop(count);
+
+	count = m_buffers.CountReady(completedValue);
+	for (size_t i = 0; i != count; ++i) {
+		vmaDestroyBuffer(m_allocator, m_buffers.handles[i].buffer, m_buffers.handles[i].allocation);
+	}
+	m_buffers.Drop(count);
+}
+
+
+size_t HandleDeletionQueue::GetPendingCount() const {
+	return m_functions.values.size() + m_pipelines.values.size() + m_layouts.values.size() + m_descriptorPools.values.size() +
+		m_imageViews.values.size() + m_images.values.size() + m_buffers.values.size() + m_bindlessImages.values.size() + m_bindlessBuffers.values.size();
+}
+
+
+// copy of queue of functions that typed queue replaced (push copies function, flush runs them in reverse order)
+// kept only as benchmark baseline
+namespace {
+	struct FunctionDeletionQueue {
+		std::deque<std::function<void()>> deletors;
+
+		void PushFunction(std::function<void()> &&function) {
+			deletors.push_back(function);
+		}
+
+		void flush() {
+			for (auto it = deletors.rbegin(); it != deletors.rend(); ++it) {
+				(*it)();
+			}
+
+			deletors.clear();
+		}
+	};
+}
+
+
+void vkutils::BenchmarkDeletionQueues(VkDevice device, VmaAllocator allocator, uint32_t handleCount, BenchmarkReport &report) {
+	using Clock = std::chrono::high_resolution_clock;
+	const uint32_t repeats = 20;  // best of runs, first runs also grow vectors
+
+	// mix of what engine retires: pipelines, images and buffers of effects
+	AllocatedImage image{};
+	AllocatedBuffer buffer{};
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	FunctionDeletionQueue functions;
+	HandleDeletionQueue typed;
+	typed.Init(device, allocator, nullptr);
+
+	double best[4] = {1e30, 1e30, 1e30, 1e30};  // push and flush of both queues, nanoseconds per handle
+	for (uint32_t r = 0; r != repeats; ++r) {
+		auto start = Clock::now();
+		for (uint32_t i = 0; i != handleCount; ++i) {
+			switch (i % 3) {
+				case 0: functions.PushFunction([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); }); break;
+				case 1: functions.PushFunction([device, allocator, image]() { vkDestroyImageView(device, image.imageView, nullptr); vmaDestroyImage(allocator, image.image, image.allocation); }); break;
+				case 2: functions.PushFunction([allocator, buffer]() { vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation); }); break;
+			}
+		}
+		auto pushed = Clock::now();
+		functions.flush();
+		auto flushed = Clock::now();
+		best[0] = std::min(best[0], std::chrono::duration<double, std::nano>(pushed - start).count() / handleCount);
+		best[1] = std::min(best[1], std::chrono::duration<double, std::nano>(flushed - pushed).count() / handleCount);
+
+		start = Clock::now();
+		for (uint32_t i = 0; i != handleCount; ++i) {
+			switch (i % 3) {
+				case 0: typed.Push(i, pipeline); break;
+				case 1: typed.Push(i, image); break;
+				case 2: typed.Push(i, buffer); break;
+			}
+		}
+		pushed = Clock::now();
+		typed.FlushAll();
+		flushed = Clock::now();
+		best[2] = std::min(best[2], std::chrono::duration<double, std::nano>(pushed - start).count() / handleCount);
+		best[3] = std::min(best[3], std::chrono::duration<double, std::nano>(flushed - pushed).count() / handleCount);
+	}
+
+	spdlog::info("Deletion queue, {} handles: functions push {:.1f} ns, flush {:.1f} ns; typed push {:.1f} ns, flush {:.1f} ns (per handle)",
+		handleCount, best[0], best[1], best[2], best[3]);
+
+	const char *names[4] = {"deletion_queue.functions.push", "deletion_queue.functions.flush", "deletion_queue.typed.push", "deletion_queue.typed.flush"};
+	for (uint32_t i = 0; i != 4; ++i) {
+		report.host.push_back({names[i], static_cast<float>(best[i]), "ns"});
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vk-types.hpp>
+#include <vk-bindless.hpp>
+#include <vk-benchmark.hpp>
+
+namespace vr {
+	// handles that are destroyed when gpu timeline reaches value they were pushed with (values are pushed in increasing order)
+	// every handle type has its own contiguous batch, so push only appends and flush destroys in bulk
+	// vectors keep their capacity, so once they have grown nothing is allocated
+	class HandleDeletionQueue final {
+	public:
+		void Init(VkDevice device, VmaAllocator allocator, BindlessTable *bindless);
+
+		void Push(uint64_t value, VkPipeline pipeline);
+		void Push(uint64_t value, VkPipelineLayout layout);
+		void Push(uint64_t value, VkDescriptorPool pool);  // frees its sets too
+		void Push(uint64_t value, VkImageView imageView);
+		void Push(uint64_t value, const AllocatedImage &image);  // view, image and memory
+		void Push(uint64_t value, const AllocatedBuffer &buffer);
+
+		// entries of bindless table, handle is given to next resource that is added
+		void PushBindlessImage(uint64_t value, uint32_t handle);
+		void PushBindlessBuffer(uint64_t value, uint32_t handle);
+
+		// for everything else, function can allocate
+		void PushFunction(uint64_t value, std::function<void()> &&function);
+
+		// destroys users (pipelines, sets) before resources they use
+		void Flush(uint64_t completedValue);
+		void FlushAll() { Flush(UINT64_MAX); }
+
+		size_t GetPendingCount() const;
+
+	private:
+		// values and handles in separate arrays, ready handles are always at front
+		template<typename T>
+		struct Batch {
+			std::vector<uint64_t> values;
+			std::vector<T>        handles;
+
+			void Push(uint64_t value, const T &handle) {
+				values.push_back(value);
+				handles.push_back(handle);
+			}
+
+			size_t CountReady(uint64_t completedValue) const {
+				size_t count = 0;
+				while (count != values.size() && values[count] <= completedValue) {
+					++count;
+				}
+				return count;
+			}
+
+			void Drop(size_t count) {
+				values.erase(values.begin(), values.begin() + count);
+				handles.erase(handles.begin(), handles.begin() + count);
+			}
+		};
+
+		struct ImageHandles {
+			VkImageView   view;
+			VkImage       image;
+			VmaAllocation allocation;
+		};
+
+		struct BufferHandles {
+			VkBuffer      buffer;
+			VmaAllocation allocation;
+		};
+
+	private:
+		VkDevice       m_device = VK_NULL_HANDLE;
+		VmaAllocator   m_allocator = VK_NULL_HANDLE;
+		BindlessTable *m_bindless = nullptr;
+
+		Batch<std::function<void()>> m_functions;
+		Batch<VkPipeline>            m_pipelines;
+		Batch<VkPipelineLayout>      m_layouts;
+		Batch<VkDescriptorPool>      m_descriptorPools;
+		Batch<VkImageView>           m_imageViews;
+		Batch<ImageHandles>          m_images;
+		Batch<BufferHandles>         m_buffers;
+		Batch<uint32_t>              m_bindlessImages;
+		Batch<uint32_t>              m_bindlessBuffers;
+	};
+}
+
+namespace vkutils {
+	// push and flush cost of typed queue against queue of functions, results are logged and added to report
+	// handles are null (destroying them does nothing), so only cost of queues is measured
+	void BenchmarkDeletionQueues(VkDevice device, VmaAllocator allocator, uint32_t handleCount, vr::BenchmarkReport &report);
+}
@@ -1,21 +1,25 @@
 #include <vk-descriptors.hpp>
 
+#include <algorithm>
+
 using namespace vr;
 
-void DescriptorLayoutBuilder::AddBinding(uint32_t binding, VkDescriptorType type) {
+void DescriptorLayoutBuilder::AddBinding(uint32_t binding, VkDescriptorType type, uint32_t count, VkDescriptorBindingFlags flags) {
 	VkDescriptorSetLayoutBinding newbind{};
 	newbind.binding = binding;
-	newbind.descriptorCount = 1;
+	newbind.descriptorCount = count;
 	newbind.descriptorType = type;
 
 	m_bindings.push_back(newbind);
+	m_bindingFlags.push_back(flags);
 }
 
 void DescriptorLayoutBuilder::Clear() {
 	m_bindings.clear();
+	m_bindingFlags.clear();
 }
 
-VkDescriptorSetLayout DescriptorLayoutBuilder::Build(VkDevice device, VkShaderStageFlags shaderStages) {
+VkDescriptorSetLayout DescriptorLayoutBuilder::Build(VkDevice device, VkShaderStageFlags shaderStages, VkDescriptorSetLayoutCreateFlags flags) {
 	for (auto &b : m_bindings) {
 		b.stageFlags |= shaderStages;
 	}
@@ -24,7 +28,18 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::Build(VkDevice device, VkShaderSt
 	info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	info.pBindings = m_bindings.data();
 	info.bindingCount = static_cast<uint32_t>(m_bindings.size());
-	info.flags = 0;
+	info.flags = flags;
+
+	// binding flags (update after bind, partially bound) are chained only when some binding has them
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.pBindingFlags = m_bindingFlags.data();
+	flagsInfo.bindingCount = static_cast<uint32_t>(m_bindingFlags.size());
+	for (auto bindingFlags : m_bindingFlags) {
+		if (bindingFlags != 0) {
+			info.pNext = &flagsInfo;
+		}
+	}
 
 	VkDescriptorSetLayout set;
 	VK_CHECK(vkCreateDescriptorSetLayout(device, &info, nullptr, &set));
@@ -35,46 +50,106 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::Build(VkDevice device, VkShaderSt
 
 // Descriptor allocator
 
+// pools grow by half, up to this many sets
+static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+
+void DescriptorAllocator::Init(VkDevice device, uint32_t initialSets, const std::vector<PoolSizeRatio> &poolRatios) {
+	DestroyPools(device);
+	m_ratios = poolRatios;
+	m_setsPerPool = initialSets;
+	m_stats = Stats{};
+}
+
+
 VkDescriptorSet DescriptorAllocator::Allocate(VkDevice device, VkDescriptorSetLayout layout) {
+	Pool pool = GetPool(device);
+
 	VkDescriptorSetAllocateInfo setInfo{};
 	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setInfo.descriptorPool = m_pool;
+	setInfo.descriptorPool = pool.pool;
 	setInfo.descriptorSetCount = 1;
 	setInfo.pSetLayouts = &layout;
 
 	VkDescriptorSet set;
-	VK_CHECK(vkAllocateDescriptorSets(device, &setInfo, &set));
+	VkResult result = vkAllocateDescriptorSets(device, &setInfo, &set);
+
+	// pool is full, it waits for next clear and set is allocated from another one
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		m_fullPools.push_back(pool);
+		pool = GetPool(device);
+		setInfo.descriptorPool = pool.pool;
+		result = vkAllocateDescriptorSets(device, &setInfo, &set);
+	}
+	VK_CHECK(result);
 
+	m_readyPools.push_back(pool);
+	m_stats.sets++;
+	m_stats.allocations++;
 	return set;
 }
 
 
-void DescriptorAllocator::InitPool(VkDevice device, uint32_t maxSets, const std::vector<PoolSizeRatio> &poolRatios) {
+DescriptorAllocator::Pool DescriptorAllocator::GetPool(VkDevice device) {
+	if (!m_readyPools.empty()) {
+		Pool pool = m_readyPools.back();
+		m_readyPools.pop_back();
+		return pool;
+	}
+
+	Pool pool{VK_NULL_HANDLE, m_setsPerPool};
+
 	std::vector<VkDescriptorPoolSize> poolSizes;
-	poolSizes.reserve(poolRatios.size());
-	for (auto &ratio : poolRatios) {
+	poolSizes.reserve(m_ratios.size());
+	for (auto &ratio : m_ratios) {
 		VkDescriptorPoolSize size{};
 		size.type = ratio.type;
-		size.descriptorCount = static_cast<uint32_t>(ratio.ratio * maxSets);
+		size.descriptorCount = std::max(static_cast<uint32_t>(ratio.ratio * pool.sets), 1u);
 
 		poolSizes.emplace_back(size);
 	}
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = maxSets;
+	poolInfo.maxSets = pool.sets;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
+	VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool.pool));
 
-	vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_pool);
+	if (m_stats.pools > 0) {
+		m_stats.grown++;
+		spdlog::info("Descriptor pools are full, new pool has room for {} sets", pool.sets);
+	}
+	m_stats.pools++;
+	m_stats.capacity += pool.sets;
+	m_setsPerPool = std::min(m_setsPerPool + std::max(m_setsPerPool / 2, 1u), MAX_SETS_PER_POOL);
+	return pool;
 }
 
 
-void DescriptorAllocator::ClearDescriptors(VkDevice device) {
-	vkResetDescriptorPool(device, m_pool, 0);
+void DescriptorAllocator::ClearPools(VkDevice device) {
+	for (auto &pool : m_fullPools) {
+		m_readyPools.push_back(pool);
+	}
+	m_fullPools.clear();
+
+	for (auto &pool : m_readyPools) {
+		VK_CHECK(vkResetDescriptorPool(device, pool.pool, 0));
+	}
+	m_stats.sets = 0;
 }
 
 
-void DescriptorAllocator::DestroyPool(VkDevice device) {
-	vkDestroyDescriptorPool(device, m_pool, nullptr);
-}
\ No newline at end of file
+void DescriptorAllocator::DestroyPools(VkDevice device) {
+	for (auto &pool : m_readyPools) {
+		vkDestroyDescriptorPool(device, pool.pool, nullptr);
+	}
+	for (auto &pool : m_fullPools) {
+		vkDestroyDescriptorPool(device, pool.pool, nullptr);
+	}
+	m_readyPools.clear();
+	m_fullPools.clear();
+	m_stats.pools = 0;
+	m_stats.sets = 0;
+	m_stats.capacity = 0;
+}
@@ -5,16 +5,19 @@
 namespace vr {
 	class DescriptorLayoutBuilder final {
 	public:
-		void AddBinding(uint32_t binding, VkDescriptorType type);
+		void AddBinding(uint32_t binding, VkDescriptorType type, uint32_t count = 1, VkDescriptorBindingFlags flags = 0);
 		void Clear();
 
-		VkDescriptorSetLayout Build(VkDevice device, VkShaderStageFlags shaderStages);
+		VkDescriptorSetLayout Build(VkDevice device, VkShaderStageFlags shaderStages, VkDescriptorSetLayoutCreateFlags flags = 0);
 
 	private:
 		std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+		std::vector<VkDescriptorBindingFlags>     m_bindingFlags;  // same order as bindings
 	};
 
 
+	// hands out descriptor sets from list of pools, new larger pool is created when all are full
+	// pools are only reset together, so allocator can be cleared every frame for sets that live one frame
 	class DescriptorAllocator final {
 	public:
 		struct PoolSizeRatio {
@@ -22,14 +25,37 @@ namespace vr {
 			float ratio;
 		};
 
+		struct Stats {
+			uint32_t pools = 0;        // full and ready
+			uint32_t sets = 0;         // allocated since last clear
+			uint32_t capacity = 0;     // sets that all pools can hold
+			uint32_t grown = 0;        // pools created because others were full
+			uint64_t allocations = 0;  // since init
+		};
+
+		// first pool is created on first allocation with room for initialSets
+		void Init(VkDevice device, uint32_t initialSets, const std::vector<PoolSizeRatio> &poolRatios);
 		VkDescriptorSet Allocate(VkDevice device, VkDescriptorSetLayout layout);
 
-		void InitPool(VkDevice device, uint32_t maxSets, const std::vector<PoolSizeRatio> &poolRatios);
-		void ClearDescriptors(VkDevice device);
-		void DestroyPool(VkDevice device);
+		// frees every set, pools are kept for next allocations
+		void ClearPools(VkDevice device);
+		void DestroyPools(VkDevice device);
+
+		const Stats &GetStats() const { return m_stats; }
 
 	private:
+		struct Pool {
+			VkDescriptorPool pool;
+			uint32_t         sets;
+		};
+
+		Pool GetPool(VkDevice device);
 
-		VkDescriptorPool m_pool;
+	private:
+		std::vector<PoolSizeRatio> m_ratios;
+		std::vector<Pool>          m_fullPools;
+		std::vector<Pool>          m_readyPools;
+		uint32_t                   m_setsPerPool = 0;  // size of next pool
+		Stats                      m_stats;
 	};
 }
\ No newline at end of file
@@ -16,18 +16,32 @@
 #include <vk-pipelines.hpp>
 #include <vk-types.hpp>
 #include <vk-images.hpp>
+#include <vk-frame-io.hpp>
+#include <vk-shader-compiler.hpp>
+
+#include <spdlog/fmt/fmt.h>
 
 #include <chrono>
+#include <cmath>
 #include <thread>
 #include <filesystem>
+#include <limits>
+#include <set>
+#include <unordered_map>
 
 
 const bool USE_VALIDATION_LAYERS = true;
 
+// transient cpu data of one frame, arena grows if frame needs more
+const size_t FRAME_ARENA_SIZE = 64 * 1024;
+
+// frames after change (resize, new pipeline, other effect) that can allocate while caches and containers grow
+const uint32_t STEADY_STATE_FRAMES = 16;
+
 
 using namespace vr;
 
-VulkanEngine::VulkanEngine() : m_isInitialized(false), m_frameNumber(0), m_stopRendering(false), m_windowExtent{800, 800}, m_currentComputeEffect(0) {
+VulkanEngine::VulkanEngine(const EngineConfig &config) : m_config(config), m_isInitialized(false), m_frameNumber(0), m_stopRendering(false), m_windowExtent{800, 800}, m_currentComputeEffect(0) {
 	Init();
 }
 
@@ -40,15 +54,27 @@ VulkanEngine::~VulkanEngine() {
 void VulkanEngine::Init() {
 	spdlog::info("Renderer initialization started");
 
-	CreateSDLWindow();
+	if (!m_config.headless) {
+		CreateSDLWindow();
+	}
+	m_barriers.EnableChecks(USE_VALIDATION_LAYERS);
+
 	InitVulkan();
 	InitSwapchain();
 	InitCommands();
 	InitSyncStructures();
+	m_gpuProfiler.Init(m_device, m_physicalDevice, m_graphicsQueueFamily, MAX_FRAMES_IN_FLIGHT, m_config.gpuProfilePath);
 	InitDescriptors();
 	InitPipelines();
-	InitImgui();
 
+	InitReadback();
+	if (!m_config.headless) {
+		InitResolvePass();
+		InitImgui();
+	}
+
+	m_frameArena.Init(FRAME_ARENA_SIZE);
+	RestartSteadyState();
 	m_isInitialized = true;
 
 	spdlog::info("Renderer initialized");
@@ -59,26 +85,45 @@ void VulkanEngine::Cleanup() {
 	if (m_isInitialized) {
 		vkDeviceWaitIdle(m_device);
 
+		// recorder and frame writer hold readback buffers until their frames are converted or written
+		m_readback.Poll(m_submittedValue);
+		m_recorder.Stop();
+		m_frameWriter.Destroy();
+
+		DestroyComputeEffects();
+		m_shaderWatcher.Destroy();
+
+		m_pipelineCache.Save();
+		m_pipelineCache.Destroy();
+		m_gpuProfiler.Destroy();
+
+		// retired objects need allocator, which is destroyed by main deletion queue
+		m_retiredObjects.FlushAll();
 		m_mainDeletionQueue.flush();
 		for (auto &frame : m_frames) {
 			vkDestroyCommandPool(m_device, frame.commandPool, nullptr);
+			vkDestroyCommandPool(m_device, frame.computeCommandPool, nullptr);
 
 			vkDestroyFence(m_device, frame.renderFence, nullptr);
 			vkDestroySemaphore(m_device, frame.renderSemaphore, nullptr);
 			vkDestroySemaphore(m_device, frame.swapchainSemaphore, nullptr);
-
-			frame.deletionQueue.flush();
 		}
+		vkDestroySemaphore(m_device, m_frameTimeline, nullptr);
+		vkDestroySemaphore(m_device, m_computeTimeline, nullptr);
 
-		DestroySwapChain();
+		if (!m_config.headless) {
+			DestroySwapChain();
 
-		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+			vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		}
 
 		vkDestroyDevice(m_device, nullptr);
 		vkb::destroy_debug_utils_messenger(m_instance, m_debugMessenger);
 		vkDestroyInstance(m_instance, nullptr);
 
-		SDL_DestroyWindow(m_window);
+		if (!m_config.headless) {
+			SDL_DestroyWindow(m_window);
+		}
 	}
 
 	spdlog::info("Renderer cleaned up");
@@ -112,6 +157,7 @@ void VulkanEngine::InitVulkan() {
 		.request_validation_layers(USE_VALIDATION_LAYERS)
 		.use_default_debug_messenger()
 		.require_api_version(1, 3, 0)
+		.set_headless(m_config.headless)  // no surface extensions without window
 		.build();
 	vkb::Instance vkbInstance= instanceRes.value();
 
@@ -119,7 +165,9 @@ void VulkanEngine::InitVulkan() {
 	m_debugMessenger = vkbInstance.debug_messenger;
 
 	// surface creation
-	SDL_Vulkan_CreateSurface(m_window, m_instance, &m_surface);
+	if (!m_config.headless) {
+		SDL_Vulkan_CreateSurface(m_window, m_instance, &m_surface);
+	}
 
 	// physical device creation
 	VkPhysicalDeviceVulkan13Features features13{};
@@ -131,15 +179,37 @@ void VulkanEngine::InitVulkan() {
 	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 	features12.bufferDeviceAddress = true;
 	features12.descriptorIndexing = true;
+	features12.timelineSemaphore = true;
+	features12.hostQueryReset = true;                             // profiler queries are reset on host, not on one of two queues
+	features12.runtimeDescriptorArray = true;                     // bindless table
+	features12.descriptorBindingPartiallyBound = true;
+	features12.descriptorBindingUpdateUnusedWhilePending = true;
+	features12.descriptorBindingSampledImageUpdateAfterBind = true;
+	features12.descriptorBindingStorageImageUpdateAfterBind = true;
+	features12.descriptorBindingStorageBufferUpdateAfterBind = true;
 
 	vkb::PhysicalDeviceSelector selector{vkbInstance};
-	vkb::PhysicalDevice vkbPhysicalDevice = selector
+	selector
 		.set_minimum_version(1, 3)
 		.set_required_features_13(features13)
-		.set_required_features_12(features12)
-		.set_surface(m_surface)
-		.select()
-		.value();
+		.set_required_features_12(features12);
+
+	// in headless mode any device will do (including software ones like lavapipe)
+	if (!m_config.headless) {
+		selector.set_surface(m_surface);
+	}
+
+	vkb::PhysicalDevice vkbPhysicalDevice = selector.select().value();
+	spdlog::info("Using physical device: {}", vkbPhysicalDevice.name);
+
+	// effects declare output image without format, so same shader can write render image and swapchain image
+	// without this feature output is declared rgba16f when shader is loaded, and effects only write render image
+	VkPhysicalDeviceFeatures features{};
+	features.shaderStorageImageWriteWithoutFormat = true;
+	m_writeWithoutFormat = vkbPhysicalDevice.enable_features_if_present(features);
+	if (!m_writeWithoutFormat) {
+		spdlog::info("Device cannot write images without format, effects write render image and resolve pass copies it");
+	}
 
 	m_physicalDevice = vkbPhysicalDevice.physical_device;
 
@@ -153,6 +223,32 @@ void VulkanEngine::InitVulkan() {
 	m_graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
 	m_graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+	// effect dispatch overlaps graphics work of previous frame when there is compute queue in another family
+	// (queue without graphics is preferred, otherwise any compute family that is not graphics one)
+	if (m_config.asyncCompute && !m_config.headless) {
+		auto computeQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::compute);
+		auto computeFamily = vkbDevice.get_dedicated_queue_index(vkb::QueueType::compute);
+		if (!computeQueue || !computeFamily) {
+			computeQueue = vkbDevice.get_queue(vkb::QueueType::compute);
+			computeFamily = vkbDevice.get_queue_index(vkb::QueueType::compute);
+		}
+
+		if (computeQueue && computeFamily && computeFamily.value() != m_graphicsQueueFamily) {
+			m_computeQueue = computeQueue.value();
+			m_computeQueueFamily = computeFamily.value();
+
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, families.data());
+			m_computeTimestamps = families[m_computeQueueFamily].timestampValidBits > 0;
+
+			spdlog::info("Async compute on queue family {}", m_computeQueueFamily);
+		} else {
+			spdlog::info("No separate compute queue, effects are dispatched on graphics queue");
+		}
+	}
+
 	// allocator creation
 	VmaAllocatorCreateInfo allocatorInfo{};
 	allocatorInfo.physicalDevice = m_physicalDevice;
@@ -160,54 +256,103 @@ void VulkanEngine::InitVulkan() {
 	allocatorInfo.instance = m_instance;
 	allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 	vmaCreateAllocator(&allocatorInfo, &m_allocator);
+	m_retiredObjects.Init(m_device, m_allocator, &m_bindless);
 	m_mainDeletionQueue.PushFunction( [&]() { vmaDestroyAllocator(m_allocator); } );
 }
 
 
 void VulkanEngine::InitSwapchain() {
-	CreateSwapChain(m_windowExtent.width, m_windowExtent.height);
+	VkExtent3D renderImageExtent{};
+	renderImageExtent.depth = 1;
 
-	// render image allocation
-	SDL_DisplayMode dm;
-	if (SDL_GetDesktopDisplayMode(0, &dm) != 0) {
-		spdlog::critical("SDL_GetDesktopDisplayMode failed: {}", SDL_GetError());
-		exit(1);
+	if (m_config.headless) {
+		// there is nothing to present to, so output frame is the "window"
+		m_windowExtent = {m_config.width, m_config.height};
+		m_swapChainExtent = m_windowExtent;
+
+		renderImageExtent.width = m_config.width;
+		renderImageExtent.height = m_config.height;
+	} else {
+		CreateSwapChain(m_windowExtent.width, m_windowExtent.height);
+
+		// pixels that are never shown are not rendered, image is recreated when window is resized
+		renderImageExtent = GetWindowRenderExtent();
 	}
-	spdlog::info("Rendering to image with resolution: width={}px, height={}px", dm.w, dm.h);
 
-	VkExtent3D renderImageExtent{};
-	renderImageExtent.width = dm.w;
-	renderImageExtent.height = dm.h;
-	renderImageExtent.depth = 1;
+	spdlog::info("Rendering to image with resolution: width={}px, height={}px", renderImageExtent.width, renderImageExtent.height);
+	CreateRenderImage(renderImageExtent);
+
+	// destroys whatever render image is current at exit
+	m_mainDeletionQueue.PushFunction([&]() {
+		DestroyImage(m_renderImage);
+		if (m_asyncRenderImage.image != VK_NULL_HANDLE) {
+			DestroyImage(m_asyncRenderImage);
+		}
+	});
+}
 
-	m_renderImage.imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
-	m_renderImage.imageExtent = renderImageExtent;
 
+void VulkanEngine::CreateRenderImage(VkExtent3D renderImageExtent) {
 	VkImageUsageFlags renderImageUsages{};
 	renderImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 	renderImageUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	renderImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;          // for compute shader
 	renderImageUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // to use in graphics pipeline
+	renderImageUsages |= VK_IMAGE_USAGE_SAMPLED_BIT;          // read by resolve pass
 
-	VkImageCreateInfo imgInfo = vkinit::ImageCreateInfo(m_renderImage.imageFormat, renderImageUsages, renderImageExtent);
+	// with async compute both queues use render images, concurrent sharing avoids ownership transfers
+	bool shared = m_computeQueue != VK_NULL_HANDLE;
+	m_renderImage = CreateImage(renderImageExtent, VK_FORMAT_R16G16B16A16_SFLOAT, renderImageUsages, shared);
+	m_renderExtent = {renderImageExtent.width, renderImageExtent.height};
+	m_barriers.Track(m_renderImage.image, ImageUsage::Undefined);
 
-	//for the draw image, we want to allocate it from gpu local memory
-	VmaAllocationCreateInfo imgAllocInfo{};
-	imgAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	imgAllocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (shared) {
+		m_asyncRenderImage = CreateImage(renderImageExtent, VK_FORMAT_R16G16B16A16_SFLOAT, renderImageUsages, shared);
+		m_barriers.Track(m_asyncRenderImage.image, ImageUsage::Undefined);
+	}
+	m_renderTargetLastUse[0] = 0;
+	m_renderTargetLastUse[1] = 0;
+}
 
-	// allocate and create image
-	vmaCreateImage(m_allocator, &imgInfo, &imgAllocInfo, &m_renderImage.image, &m_renderImage.allocation, nullptr);
 
-	// create image view
-	VkImageViewCreateInfo imgViewInfo = vkinit::ImageviewCreateInfo(m_renderImage.imageFormat, m_renderImage.image, VK_IMAGE_ASPECT_COLOR_BIT);
-	VK_CHECK(vkCreateImageView(m_device, &imgViewInfo, nullptr, &m_renderImage.imageView));
+VkExtent3D VulkanEngine::GetWindowRenderExtent() const {
+	VkExtent3D extent{};
+	extent.width = std::max(static_cast<uint32_t>(m_swapChainExtent.width * m_config.renderScale + 0.5f), 1u);
+	extent.height = std::max(static_cast<uint32_t>(m_swapChainExtent.height * m_config.renderScale + 0.5f), 1u);
+	extent.depth = 1;
+	return extent;
+}
 
-	// add to deletion queue
-	m_mainDeletionQueue.PushFunction([&]() {
-		vkDestroyImageView(m_device, m_renderImage.imageView, nullptr);
-		vmaDestroyImage(m_allocator, m_renderImage.image, m_renderImage.allocation);
-	});
+
+// effect has images, buffers or descriptor sets of its own
+static bool HasResources(const EffectResources &resources) {
+	return resources.descriptorPool != VK_NULL_HANDLE || !resources.images.empty() || !resources.buffers.empty();
+}
+
+
+void VulkanEngine::ResizeRenderImage(VkExtent3D extent) {
+	// render image is used by frames in flight and by descriptor sets of effects
+	vkDeviceWaitIdle(m_device);
+
+	m_barriers.Forget(m_renderImage.image);
+	DestroyImage(m_renderImage);
+	m_recordedGeneration++;
+	if (m_asyncRenderImage.image != VK_NULL_HANDLE) {
+		m_barriers.Forget(m_asyncRenderImage.image);
+		DestroyImage(m_asyncRenderImage);
+	}
+	CreateRenderImage(extent);
+	UpdateRenderImageDescriptors();
+	RestartSteadyState();
+
+	// effect images and per pixel buffers have size of render image
+	for (auto &effect : m_computeEffects) {
+		if (HasResources(effect.resources)) {
+			DestroyEffectResources(effect.resources);
+			effect.resources = EffectResources{};
+			CreateEffectResources(effect);
+		}
+	}
 }
 
 
@@ -219,11 +364,26 @@ void VulkanEngine::CreateSwapChain(uint32_t width, uint32_t height) {
 	surfaceFormat.format = m_swapChainImageFormat;
 	surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 
+	// compute can write swapchain image directly if surface allows storage usage for its format
+	VkSurfaceCapabilitiesKHR surfaceCapabilities{};
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &surfaceCapabilities);
+	VkFormatProperties formatProperties{};
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, m_swapChainImageFormat, &formatProperties);
+
+	m_swapChainStorage = m_config.swapChainWrites && m_writeWithoutFormat
+		&& (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT)
+		&& (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (m_swapChainStorage) {
+		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+	}
+
 	vkb::Swapchain vkbSwapchain = swapChainBuilder
 		.set_desired_format(surfaceFormat)
 		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 		.set_desired_extent(width, height)
-		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		.set_image_usage_flags(usage)
 		.build()
 		.value();
 
@@ -237,6 +397,10 @@ void VulkanEngine::CreateSwapChain(uint32_t width, uint32_t height) {
 void VulkanEngine::DestroySwapChain() {
 	vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
 
+	for (auto &swapChainImage : m_swapChainImages) {
+		m_barriers.Forget(swapChainImage);
+	}
+
 	// deletes images as well
 	for (auto &swapChainImageView : m_swapChainImageViews) {
 		vkDestroyImageView(m_device, swapChainImageView, nullptr);
@@ -247,6 +411,8 @@ void VulkanEngine::DestroySwapChain() {
 void VulkanEngine::RecreateSwapChain() {
 	vkDeviceWaitIdle(m_device);
 
+	// number of swapchain images can change
+	FreeRecordedFrames();
 	DestroySwapChain();
 
 	int w, h;
@@ -255,9 +421,16 @@ void VulkanEngine::RecreateSwapChain() {
 	m_windowExtent.height = h;
 
 	CreateSwapChain(m_windowExtent.width, m_windowExtent.height);
+	UpdateSwapChainDescriptors();
+
+	VkExtent3D renderImageExtent = GetWindowRenderExtent();
+	if (renderImageExtent.width != m_renderImage.imageExtent.width || renderImageExtent.height != m_renderImage.imageExtent.height) {
+		ResizeRenderImage(renderImageExtent);
+	}
 
 	spdlog::info("Swap chain recreation");
 	m_resizeRequested = false;
+	RestartSteadyState();
 }
 
 
@@ -266,7 +439,7 @@ void VulkanEngine::InitCommands() {
 	// this flag allows us to reset individual command buffer
 	VkCommandPoolCreateInfo commandPoolInfo = vkinit::CommandPoolCreateInfo(m_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-	for (int i = 0; i != FRAMES_IN_FLIGHT; ++i) {
+	for (int i = 0; i != MAX_FRAMES_IN_FLIGHT; ++i) {
 		VK_CHECK(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_frames[i].commandPool));
 
 		// allocate command buffer using this command pool
@@ -275,6 +448,18 @@ void VulkanEngine::InitCommands() {
 		VK_CHECK(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &m_frames[i].mainCommandBuffer));
 	}
 
+	// compute queue records effect dispatch in its own command buffers
+	if (m_computeQueue != VK_NULL_HANDLE) {
+		VkCommandPoolCreateInfo computePoolInfo = vkinit::CommandPoolCreateInfo(m_computeQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+		for (auto &frame : m_frames) {
+			VK_CHECK(vkCreateCommandPool(m_device, &computePoolInfo, nullptr, &frame.computeCommandPool));
+
+			VkCommandBufferAllocateInfo computeBufferInfo = vkinit::CommandBufferAllocateInfo(frame.computeCommandPool);
+			VK_CHECK(vkAllocateCommandBuffers(m_device, &computeBufferInfo, &frame.computeCommandBuffer));
+		}
+	}
+
 	// create command pool and buffer for immediate commands
 	VK_CHECK(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_immCommandPool));
 
@@ -296,25 +481,92 @@ void VulkanEngine::InitSyncStructures() {
 	VkFenceCreateInfo fenceCreateInfo = vkinit::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
 	VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::SemaphoreCreateInfo();
 
+	// objects for all slots are created, so number of frames in flight can change at runtime
 	for (auto &frame : m_frames) {
 		VK_CHECK(vkCreateFence(m_device, &fenceCreateInfo, nullptr, &frame.renderFence));
 		VK_CHECK(vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &frame.swapchainSemaphore));
 		VK_CHECK(vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &frame.renderSemaphore));
 	}
 
+	// frame timeline counts finished frames, swapchain still needs binary semaphores above
+	VkSemaphoreTypeCreateInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo timelineCreateInfo = vkinit::SemaphoreCreateInfo();
+	timelineCreateInfo.pNext = &timelineInfo;
+	VK_CHECK(vkCreateSemaphore(m_device, &timelineCreateInfo, nullptr, &m_frameTimeline));
+
+	// graphics submit of frame waits for compute submit of same frame
+	if (m_computeQueue != VK_NULL_HANDLE) {
+		VK_CHECK(vkCreateSemaphore(m_device, &timelineCreateInfo, nullptr, &m_computeTimeline));
+	}
+
+	m_framesInFlight = m_config.framesInFlight;
+	m_framePacing = m_config.framePacing;
+	spdlog::info("Frame pacing: {}, {} frames in flight", FramePacingName(m_framePacing), m_framesInFlight);
+
 	// create fence for immediate commands
 	VK_CHECK(vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_immFence));
 	m_mainDeletionQueue.PushFunction( [&]() { vkDestroyFence(m_device, m_immFence, nullptr); });
 }
 
 
+
+void VulkanEngine::WaitForFrame(FrameData &frame) {
+	// we can wait no more than 1 second
+	if (m_framePacing == FramePacing::Fence) {
+		VK_CHECK(vkWaitForFences(m_device, 1, &frame.renderFence, true, 1000000000));
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_frameTimeline;
+	waitInfo.pValues = &frame.timelineValue;
+	VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, 1000000000));
+}
+
+
+void VulkanEngine::SetFramePacing(FramePacing pacing, uint32_t framesInFlight) {
+	if (pacing == m_framePacing && framesInFlight == m_framesInFlight) {
+		return;
+	}
+
+	// slots are remapped, so nothing can be in flight
+	vkDeviceWaitIdle(m_device);
+	m_gpuProfiler.ReadPending();
+	m_readback.Poll(m_submittedValue);
+
+	m_framePacing = pacing;
+	m_framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+	spdlog::info("Frame pacing: {}, {} frames in flight", FramePacingName(m_framePacing), m_framesInFlight);
+	RestartSteadyState();
+}
+
+
 void VulkanEngine::InitDescriptors() {
 	// create pool
 	std::vector<DescriptorAllocator::PoolSizeRatio> sizes {
-		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
 	};
 
-	m_globalDescriptorAllocator.InitPool(m_device, 10, sizes);
+	m_globalDescriptorAllocator.Init(m_device, 16, sizes);
+
+	// sets that live for one frame, cleared when frame slot is reused
+	std::vector<DescriptorAllocator::PoolSizeRatio> frameSizes {
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}
+	};
+	for (auto &allocator : m_frameDescriptors) {
+		allocator.Init(m_device, 16, frameSizes);
+	}
 
 	// get layout that matches pool
 	{
@@ -323,210 +575,1498 @@ void VulkanEngine::InitDescriptors() {
 		m_renderImageDescriptorLayout = builder.Build(m_device, VK_SHADER_STAGE_COMPUTE_BIT);
 	}
 
+	// resolve pass samples render image
+	if (!m_config.headless) {
+		DescriptorLayoutBuilder builder;
+		builder.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		m_resolveDescriptorLayout = builder.Build(m_device, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		VK_CHECK(vkCreateSampler(m_device, &samplerInfo, nullptr, &m_resolveSampler));
+
+		m_resolveDescriptors = m_globalDescriptorAllocator.Allocate(m_device, m_resolveDescriptorLayout);
+		if (m_computeQueue != VK_NULL_HANDLE) {
+			m_asyncResolveDescriptors = m_globalDescriptorAllocator.Allocate(m_device, m_resolveDescriptorLayout);
+		}
+	}
+
 	// allocate descriptor sets
 	m_renderImageDescriptors = m_globalDescriptorAllocator.Allocate(m_device, m_renderImageDescriptorLayout);
+	if (m_computeQueue != VK_NULL_HANDLE) {
+		m_asyncRenderImageDescriptors = m_globalDescriptorAllocator.Allocate(m_device, m_renderImageDescriptorLayout);
+	}
+	UpdateRenderImageDescriptors();
+	UpdateSwapChainDescriptors();
+
+	// prerecorded frames read push constants from this buffer, every frame slot has its part
+	if (m_config.prerecordedFrames) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+		VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		VkDeviceSize range = std::min(properties.limits.maxPushConstantsSize, properties.limits.maxUniformBufferRange);
+		m_paramsStride = (range + alignment - 1) / alignment * alignment;
+		m_paramsBuffer = CreateBuffer(m_paramsStride * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
-	// update descriptor sets
-	VkDescriptorImageInfo imgInfo{};
-	imgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-	imgInfo.imageView = m_renderImage.imageView;
+		DescriptorLayoutBuilder builder;
+		builder.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+		m_paramsDescriptorLayout = builder.Build(m_device, VK_SHADER_STAGE_COMPUTE_BIT);
+		m_paramsDescriptors = m_globalDescriptorAllocator.Allocate(m_device, m_paramsDescriptorLayout);
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = m_paramsBuffer.buffer;
+		bufferInfo.range = range;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstBinding = 0;
+		write.dstSet = m_paramsDescriptors;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+		m_mainDeletionQueue.PushFunction([&]() {
+			DestroyBuffer(m_paramsBuffer);
+			vkDestroyDescriptorSetLayout(m_device, m_paramsDescriptorLayout, nullptr);
+		});
+	}
 
-	VkWriteDescriptorSet renderImageWrite{};
-	renderImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	renderImageWrite.dstBinding = 0;
-	renderImageWrite.dstSet = m_renderImageDescriptors;
-	renderImageWrite.descriptorCount = 1;
-	renderImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-	renderImageWrite.pImageInfo = &imgInfo;
+	// images and buffers that effects index by handle
+	m_bindless.Init(m_device, m_physicalDevice);
+	m_mainDeletionQueue.PushFunction([&]() { m_bindless.Destroy(); });
 
-	vkUpdateDescriptorSets(m_device, 1, &renderImageWrite, 0, nullptr);
+	// parameter blocks are copied to part of frame slot, addresses are pushed with other push constants
+	m_parameterRing.Init(m_device, m_allocator, MAX_FRAMES_IN_FLIGHT, static_cast<VkDeviceSize>(m_config.parameterRingKiB) * 1024);
+	m_mainDeletionQueue.PushFunction([&]() { m_parameterRing.Destroy(); });
 
 	// add to destruction queue
 	m_mainDeletionQueue.PushFunction([&]() {
-		m_globalDescriptorAllocator.DestroyPool(m_device);
+		m_globalDescriptorAllocator.DestroyPools(m_device);
+		for (auto &allocator : m_frameDescriptors) {
+			allocator.DestroyPools(m_device);
+		}
 		vkDestroyDescriptorSetLayout(m_device, m_renderImageDescriptorLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_resolveDescriptorLayout, nullptr);
+		vkDestroySampler(m_device, m_resolveSampler, nullptr);
+	});
+}
+
+
+static void WriteImageDescriptor(VkDevice device, VkDescriptorSet set, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler) {
+	VkDescriptorImageInfo imgInfo{};
+	imgInfo.imageLayout = layout;
+	imgInfo.imageView = view;
+	imgInfo.sampler = sampler;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstBinding = 0;
+	write.dstSet = set;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pImageInfo = &imgInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+
+void VulkanEngine::UpdateRenderImageDescriptors() {
+	WriteImageDescriptor(m_device, m_renderImageDescriptors, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_renderImage.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+	if (m_resolveDescriptors != VK_NULL_HANDLE) {
+		WriteImageDescriptor(m_device, m_resolveDescriptors, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_renderImage.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_resolveSampler);
+	}
+
+	if (m_asyncRenderImageDescriptors != VK_NULL_HANDLE) {
+		WriteImageDescriptor(m_device, m_asyncRenderImageDescriptors, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_asyncRenderImage.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+		WriteImageDescriptor(m_device, m_asyncResolveDescriptors, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_asyncRenderImage.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_resolveSampler);
+	}
+}
+
+
+void VulkanEngine::UpdateSwapChainDescriptors() {
+	if (m_config.headless || !m_swapChainStorage) {
+		return;
+	}
+
+	// sets are reused after swapchain recreation, new ones are allocated only if there are more images
+	while (m_swapChainDescriptors.size() < m_swapChainImageViews.size()) {
+		m_swapChainDescriptors.push_back(m_globalDescriptorAllocator.Allocate(m_device, m_renderImageDescriptorLayout));
+	}
+
+	for (size_t i = 0; i != m_swapChainImageViews.size(); ++i) {
+		WriteImageDescriptor(m_device, m_swapChainDescriptors[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_swapChainImageViews[i], VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+	}
+}
+
+
+void VulkanEngine::InitResolvePass() {
+	VkPushConstantRange pushConstant{};
+	pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstant.size = sizeof(float) * 4;  // uv scale and max uv
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_resolveDescriptorLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstant;
+	VK_CHECK(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_resolveLayout));
+
+	VkShaderModule vertexShader;
+	VkShaderModule fragmentShader;
+	if (!vkutils::LoadShaderModule((m_shadersPath + "resolve.vert.spv").c_str(), m_device, &vertexShader) ||
+		!vkutils::LoadShaderModule((m_shadersPath + "resolve.frag.spv").c_str(), m_device, &fragmentShader)) {
+		spdlog::critical("Failed to load resolve shaders from {}", m_shadersPath);
+		exit(1);
+	}
+
+	if (!vkutils::CreateFullscreenPipeline(m_device, m_resolveLayout, vertexShader, fragmentShader, m_swapChainImageFormat, &m_resolvePipeline)) {
+		spdlog::critical("Failed to create resolve pipeline");
+		exit(1);
+	}
+
+	vkDestroyShaderModule(m_device, vertexShader, nullptr);
+	vkDestroyShaderModule(m_device, fragmentShader, nullptr);
+
+	m_mainDeletionQueue.PushFunction([&]() {
+		vkDestroyPipeline(m_device, m_resolvePipeline, nullptr);
+		vkDestroyPipelineLayout(m_device, m_resolveLayout, nullptr);
 	});
 }
 
 
 void VulkanEngine::InitPipelines() {
-	std::string shadersPath;
 	#ifdef SHADERS_DIR
 		const char* shadersDir = SHADERS_DIR;
-		shadersPath = std::string(shadersDir) + "/";
+		m_shadersPath = std::string(shadersDir) + "/";
 	#endif
 
-	for (auto &p : std::filesystem::recursive_directory_iterator(shadersPath)) {
-		if (!(p.path().extension() == ".spv")) {
-			continue;  // look only for compiled shaders
+	m_pipelineCache.Init(m_device, m_physicalDevice, m_config.pipelineCachePath);
+
+	// pipeline layouts are created from shader reflection, effects can use more push constants than spec minimum
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+	m_maxPushConstantsSize = properties.limits.maxPushConstantsSize;
+
+	// tuned workgroup sizes are valid only for device they were measured on
+	VkPhysicalDeviceIDProperties idProperties{};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &idProperties;
+	vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+	m_workgroupTuning.Load(m_config.workgroupSizesPath, idProperties.deviceUUID);
+
+	// find compiled shaders, pipelines are built later on worker threads
+	// sources are remembered for hot reload (compiled shaders are put into shaders root, sources can be in subfolders)
+	std::vector<std::filesystem::path> shaderFiles;
+	std::unordered_map<std::string, std::string> sourceFiles;
+	for (auto &p : std::filesystem::recursive_directory_iterator(m_shadersPath)) {
+		if (p.path().extension() == ".spv" && p.path().stem().extension() == ".comp") {
+			shaderFiles.push_back(p.path());  // graphics shaders are compiled here too
+		} else if (p.path().extension() == ".comp") {
+			sourceFiles[p.path().filename().string()] = p.path().string();
 		}
+	}
+	std::sort(shaderFiles.begin(), shaderFiles.end());  // directory order is not specified
 
-		// initialize effect struct
+	for (auto &path : shaderFiles) {
 		ComputeEffect effect{};
-		effect.name = p.path().stem().stem().string();
+		effect.name = path.stem().stem().string();
+		effect.shaderPath = path.string();
+		effect.sourcePath = sourceFiles[path.stem().string()];
+		effect.layout = VK_NULL_HANDLE;
+		effect.pipeline = VK_NULL_HANDLE;
+
+		m_computeEffects.push_back(effect);
+	}
+
+	if (m_computeEffects.empty()) {
+		spdlog::critical("No compiled shaders found in {}", m_shadersPath);
+		exit(1);
+	}
 
-		// create pipeline layout
-		VkPipelineLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		layoutInfo.pSetLayouts = &m_renderImageDescriptorLayout;
-		layoutInfo.setLayoutCount = 1;
+	// select effect that was requested from command line
+	if (!m_config.effectName.empty()) {
+		auto it = std::find_if(m_computeEffects.begin(), m_computeEffects.end(), [&](const ComputeEffect &e) { return e.name == m_config.effectName; });
+		if (it != m_computeEffects.end()) {
+			m_currentComputeEffect = static_cast<int>(it - m_computeEffects.begin());
+		} else {
+			spdlog::warn("Effect \"{}\" not found, using \"{}\"", m_config.effectName, m_computeEffects[m_currentComputeEffect].name);
+		}
+	}
+	m_displayedComputeEffect = m_currentComputeEffect;
 
-		VkPushConstantRange pushConstants{};
-		pushConstants.offset = 0;
-		pushConstants.size = sizeof(ComputePushConstants);
-		pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	m_buildStarted.assign(m_computeEffects.size(), false);
+	m_pendingBuilds = static_cast<uint32_t>(m_computeEffects.size());
+	m_buildStartTime = std::chrono::high_resolution_clock::now();
 
-		layoutInfo.pPushConstantRanges = &pushConstants;
-		layoutInfo.pushConstantRangeCount = 1;
+	m_compileThreads = std::make_unique<ThreadPool>(m_config.compileThreads);
+	spdlog::info("Building {} compute pipelines on {} threads ({})", m_computeEffects.size(), m_compileThreads->Size(), m_config.onDemandPipelines ? "on demand" : "all up front");
 
-		VK_CHECK(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &effect.layout));
+	if (m_config.onDemandPipelines) {
+		// only selected effect is needed to start rendering, others are built in background
+		const ComputeEffect &current = m_computeEffects[m_currentComputeEffect];
+		BuildComputeEffect(m_currentComputeEffect, current.shaderPath, GetTunedLocalSize(current));
+		InstallFinishedPipelines();
 
-		// create shader module
-		std::string shaderPath = p.path().string();
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_buildStartTime).count();
+		spdlog::info("Effect \"{}\" ready in {:.2f}ms", m_computeEffects[m_currentComputeEffect].name, ms);
 
-		if (!std::filesystem::exists(shaderPath)) {
-			spdlog::error("no such shader: {}\n", shaderPath);
+		for (size_t i = 0; i != m_computeEffects.size(); ++i) {
+			RequestComputeEffect(i, false);
 		}
+	} else {
+		for (size_t i = 0; i != m_computeEffects.size(); ++i) {
+			RequestComputeEffect(i, false);
+		}
+
+		m_compileThreads->WaitIdle();
+		InstallFinishedPipelines();
+	}
+
+	if (!m_config.headless && m_config.hotReload) {
+		m_hotReload = m_shaderWatcher.Init(m_shadersPath);
+	}
+}
 
-		VkShaderModule shaderModule;
-		if (!vkutils::LoadShaderModule(shaderPath.c_str(), m_device, &shaderModule)) {
-			spdlog::error("error when building the compute shader\n");
+
+void VulkanEngine::RequestComputeEffect(size_t effectIndex, bool urgent) {
+	{
+		std::lock_guard<std::mutex> lock(m_buildMutex);
+		if (m_buildStarted[effectIndex]) {
+			return;
 		}
+	}
 
-		// create pipeline
-		VkPipelineShaderStageCreateInfo stageInfo{};
-		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-		stageInfo.module = shaderModule;
-		stageInfo.pName = "main";
+	// path is copied, so worker does not touch effects list
+	std::string shaderPath = m_computeEffects[effectIndex].shaderPath;
+	std::array<uint32_t, 2> tunedLocalSize = GetTunedLocalSize(m_computeEffects[effectIndex]);
+	m_compileThreads->Submit([this, effectIndex, shaderPath, tunedLocalSize]() {
+		BuildComputeEffect(effectIndex, shaderPath, tunedLocalSize);
+	}, urgent);
+}
 
-		VkComputePipelineCreateInfo computePipelineCreateInfo{};
-		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		computePipelineCreateInfo.layout = effect.layout;
-		computePipelineCreateInfo.stage = stageInfo;
 
-		VK_CHECK(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &effect.pipeline));
+void VulkanEngine::BuildComputeEffect(size_t effectIndex, const std::string &shaderPath, std::array<uint32_t, 2> tunedLocalSize) {
+	// same effect could be queued twice (for example, urgent request after normal one)
+	{
+		std::lock_guard<std::mutex> lock(m_buildMutex);
+		if (m_buildStarted[effectIndex]) {
+			return;
+		}
+		m_buildStarted[effectIndex] = true;
+	}
 
-		// add effect to effects list
-		m_computeEffects.push_back(effect);
+	EffectBuild build{};
+	build.effectIndex = effectIndex;
+	build.pipeline = VK_NULL_HANDLE;
+	build.generation = 0;
+	build.variant = false;
+	build.tunedLocalSize = tunedLocalSize;
+
+	auto spirv = std::make_shared<std::vector<uint32_t>>();
+	if (!vkutils::ReadSpirvFile(shaderPath, *spirv)) {
+		build.error = "cannot read " + shaderPath;
+	} else if (DeclareOutputFormat(*spirv, build.error)) {
+		build.spirv = spirv;
+		CreateComputePipeline({}, build);
+	}
 
-		// destroy shader module and sent pipeline to deletion queue
-		vkDestroyShaderModule(m_device, shaderModule, nullptr);
-		m_mainDeletionQueue.PushFunction([=]() {
-			vkDestroyPipelineLayout(m_device, effect.layout, nullptr);
-			vkDestroyPipeline(m_device, effect.pipeline, nullptr);
-		});
+	if (build.pipeline == VK_NULL_HANDLE) {
+		spdlog::error("error when building the compute shader {}: {}", shaderPath, build.error);
 	}
 
+	std::lock_guard<std::mutex> lock(m_buildMutex);
+	m_finishedBuilds.push_back(build);
 }
 
 
-void VulkanEngine::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)> &&function) {
-	VK_CHECK(vkResetFences(m_device, 1, &m_immFence));
-	VK_CHECK(vkResetCommandBuffer(m_immCommandBuffer, 0));
+// specValues are in order of reflection.specConstants, returns VK_NULL_HANDLE on failure
+static VkPipeline CreatePipeline(VkDevice device, VkPipelineCache cache, const std::vector<uint32_t> &spirv, VkPipelineLayout layout, const ShaderReflection &reflection, const std::vector<uint32_t> &specValues, std::string &error) {
+	std::vector<VkSpecializationMapEntry> specEntries;
+	for (auto &constant : reflection.specConstants) {
+		VkSpecializationMapEntry entry{};
+		entry.constantID = constant.id;
+		entry.offset = static_cast<uint32_t>(specEntries.size() * sizeof(uint32_t));
+		entry.size = sizeof(uint32_t);  // VkBool32 has same size
+		specEntries.push_back(entry);
+	}
 
-	VkCommandBuffer cmd = m_immCommandBuffer;
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+	VkSpecializationInfo specInfo{};
+	specInfo.mapEntryCount = static_cast<uint32_t>(specEntries.size());
+	specInfo.pMapEntries = specEntries.data();
+	specInfo.dataSize = specValues.size() * sizeof(uint32_t);
+	specInfo.pData = specValues.data();
+
+	// create shader module
+	VkShaderModule shaderModule;
+	if (!vkutils::CreateShaderModule(spirv, device, &shaderModule)) {
+		error = "failed to create shader module";
+		return VK_NULL_HANDLE;
+	}
 
-	function(cmd);
+	// create pipeline
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = shaderModule;
+	stageInfo.pName = "main";
+	stageInfo.pSpecializationInfo = specEntries.empty() ? nullptr : &specInfo;
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.layout = layout;
+	computePipelineCreateInfo.stage = stageInfo;
+
+	// pipeline cache is internally synchronized, so all workers can share it
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateComputePipelines(device, cache, 1, &computePipelineCreateInfo, nullptr, &pipeline);
+	if (result != VK_SUCCESS) {
+		error = fmt::format("failed to create compute pipeline: {}", string_VkResult(result));
+		pipeline = VK_NULL_HANDLE;
+	}
 
-	VK_CHECK(vkEndCommandBuffer(cmd));
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	return pipeline;
+}
 
-	VkCommandBufferSubmitInfo submitInfo = vkinit::CommandBufferSubmitInfo(cmd);
-	VkSubmitInfo2 submit = vkinit::SubmitInfo(&submitInfo, nullptr, nullptr);
 
-	// submit command buffer and block fence
-	VK_CHECK(vkQueueSubmit2(m_graphicsQueue, 1, &submit, m_immFence));
-	VK_CHECK(vkWaitForFences(m_device, 1, &m_immFence, true, 9999999999));
+// shader files stay the same on every device, output gets format of render image only where it is needed
+bool VulkanEngine::DeclareOutputFormat(std::vector<uint32_t> &spirv, std::string &error) const {
+	return m_writeWithoutFormat || vkutils::DeclareStorageImageFormat(spirv, 0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, error);
 }
 
 
-void VulkanEngine::InitImgui() {
-	std::vector<VkDescriptorPoolSize> poolSizes{
-		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
-		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
-	};
+bool VulkanEngine::CreateComputePipeline(const std::map<uint32_t, uint32_t> &specOverrides, EffectBuild &build) {
+	build.pipeline = VK_NULL_HANDLE;
+	const std::vector<uint32_t> &spirv = *build.spirv;
 
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-	poolInfo.maxSets = 1000;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
+	// layout is made for interface that shader actually uses
+	if (!vkutils::ReflectComputeShader(spirv, build.reflection, build.error)) {
+		return false;
+	}
 
-	VkDescriptorPool imguiPool;
-	VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &imguiPool));
+	// tuned workgroup size replaces shader default, but values chosen by caller win
+	std::map<uint32_t, uint32_t> overrides = specOverrides;
+	for (int i = 0; i != 2; ++i) {
+		uint32_t id = build.reflection.localSizeSpecIds[i];
+		if (id != ~0u && build.tunedLocalSize[i] != 0) {
+			overrides.emplace(id, build.tunedLocalSize[i]);
+		}
+	}
 
-	// 2: initialize imgui library
+	// constants that are not overridden keep default values from shader
+	build.specValues.clear();
+	for (auto &constant : build.reflection.specConstants) {
+		auto it = overrides.find(constant.id);
+		build.specValues.push_back(it != overrides.end() ? it->second : constant.defaultValue);
+	}
 
-	// this initializes the core structures of imgui
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
+	InterfaceLayout interfaceLayout;
+	if (!GetInterfaceLayout(build.reflection, interfaceLayout, build.error)) {
+		return false;
+	}
+	build.layout = interfaceLayout.layout;
+	build.setLayouts = interfaceLayout.setLayouts;
 
-	// this initializes imgui for SDL
-	ImGui_ImplSDL2_InitForVulkan(m_window);
+	build.pipeline = CreatePipeline(m_device, m_pipelineCache.Get(), spirv, build.layout, build.reflection, build.specValues, build.error);
+	return build.pipeline != VK_NULL_HANDLE;
+}
 
-	// this initializes imgui for Vulkan
-	ImGui_ImplVulkan_InitInfo init_info = {};
-	init_info.Instance = m_instance;
-	init_info.PhysicalDevice = m_physicalDevice;
-	init_info.Device = m_device;
-	init_info.Queue = m_graphicsQueue;
-	init_info.DescriptorPool = imguiPool;
-	init_info.MinImageCount = 3;
-	init_info.ImageCount = 3;
-	init_info.UseDynamicRendering = true;
 
-	//dynamic rendering parameters for imgui to use
-	VkPipelineRenderingCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+// output of effect, bound to render image
+static bool IsRenderImageBinding(const DescriptorBinding &binding) {
+	return binding.set == 0 && binding.binding == 0 && binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && binding.count == 1;
+}
 
-	init_info.PipelineRenderingCreateInfo = pipelineInfo;
-	init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
-	init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &m_swapChainImageFormat;
 
+static bool UsesBindlessTable(const ShaderReflection &reflection) {
+	return std::any_of(reflection.bindings.begin(), reflection.bindings.end(), BindlessTable::IsTableBinding);
+}
 
-	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 
-	ImGui_ImplVulkan_Init(&init_info);
+// uint push constant members that get own image ("...Image") or buffer ("...Buffer") in bindless table
+enum class BindlessHandle {
+	None,
+	Image,
+	Buffer,
+};
 
-	ImGui_ImplVulkan_CreateFontsTexture();
+static BindlessHandle GetBindlessHandle(const ShaderReflection &reflection, const PushConstantMember &member) {
+	if (member.scalar != ReflectedScalar::Uint || member.components != 1 || member.count != 1 || !UsesBindlessTable(reflection)) {
+		return BindlessHandle::None;
+	}
 
-	// add the destroy the imgui created structures
-	m_mainDeletionQueue.PushFunction([=]() {
-		ImGui_ImplVulkan_Shutdown();
-		ImGui_ImplSDL2_Shutdown();
-		ImGui::DestroyContext();
-		vkDestroyDescriptorPool(m_device, imguiPool, nullptr);
-	});
+	auto endsWith = [&](const std::string &suffix) {
+		return member.name.size() > suffix.size() && member.name.compare(member.name.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	if (endsWith("Image")) {
+		return BindlessHandle::Image;
+	}
+	if (endsWith("Buffer")) {
+		return BindlessHandle::Buffer;
+	}
+	return BindlessHandle::None;
 }
 
 
-void VulkanEngine::DrawImgui(VkCommandBuffer cmd, VkImageView targetImageView) {
-	VkRenderingAttachmentInfo colorAttachment = vkinit::AttachmentInfo(targetImageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	VkRenderingInfo renderInfo = vkinit::RenderingInfo(m_swapChainExtent, &colorAttachment, nullptr);
-
-	vkCmdBeginRendering(cmd, &renderInfo);
+static std::string SetLayoutKey(const ShaderReflection &reflection, uint32_t set) {
+	std::string key;
+	for (auto &binding : reflection.bindings) {
+		if (binding.set == set) {
+			key += fmt::format("{}:{}:{};", binding.binding, static_cast<int>(binding.type), binding.count);
+		}
+	}
+	return key;
+}
 
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
 
-	vkCmdEndRendering(cmd);
+// effects with same key can keep their images and buffers over hot reload
+static std::string ResourceKey(const ShaderReflection &reflection) {
+	std::string key;
+	for (auto &binding : reflection.bindings) {
+		key += fmt::format("{}.{}:{}:{}:{}:{}:{};", binding.set, binding.binding, static_cast<int>(binding.type), binding.count, static_cast<int>(binding.imageFormat), binding.bufferSize, binding.arrayStride);
+	}
+	for (auto &member : reflection.pushConstants) {
+		if (GetBindlessHandle(reflection, member) != BindlessHandle::None) {
+			key += fmt::format("{}@{};", member.name, member.offset);
+		}
+	}
+	return key;
 }
 
 
-void VulkanEngine::Run() {
-	SDL_Event e;
-	bool bQuit = false;
+bool VulkanEngine::GetInterfaceLayout(const ShaderReflection &reflection, InterfaceLayout &layout, std::string &error) {
+	if (reflection.pushConstantSize > m_maxPushConstantsSize) {
+		error = fmt::format("push constants use {} bytes, device supports {}", reflection.pushConstantSize, m_maxPushConstantsSize);
+		return false;
+	}
+
+	// every block is copied to ring part of frame slot, with alignment between them
+	VkDeviceSize blocksSize = 0;
+	for (auto &block : reflection.parameterBlocks) {
+		blocksSize += (block.size + ParameterRing::ALIGNMENT - 1) / ParameterRing::ALIGNMENT * ParameterRing::ALIGNMENT;
+	}
+	if (blocksSize > m_parameterRing.GetSlotSize()) {
+		error = fmt::format("parameter blocks use {} bytes, parameter ring has {} per frame", blocksSize, m_parameterRing.GetSlotSize());
+		return false;
+	}
+
+	// engine can create storage images and buffers for effect, other resources have no source
+	// runtime arrays are only bindless table, which then owns its whole set
+	bool bindless = UsesBindlessTable(reflection);
+	uint32_t setCount = 0;
+	for (auto &binding : reflection.bindings) {
+		if (BindlessTable::IsTableBinding(binding)) {
+			setCount = std::max(setCount, binding.set + 1);
+			continue;
+		}
+		if (binding.count == 0) {
+			error = fmt::format("runtime array \"{}\" (set {}, binding {}) is not part of bindless table (see utils/bindless.glsl)", binding.name, binding.set, binding.binding);
+			return false;
+		}
+		if (bindless && binding.set == BindlessTable::SET) {
+			error = fmt::format("binding \"{}\" uses set {}, which is bindless table", binding.name, binding.set);
+			return false;
+		}
+		if (binding.type != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && binding.type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && binding.type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+			error = fmt::format("binding \"{}\" (set {}, binding {}) has unsupported type {}", binding.name, binding.set, binding.binding, string_VkDescriptorType(binding.type));
+			return false;
+		}
+		setCount = std::max(setCount, binding.set + 1);
+	}
+
+	std::vector<std::string> setKeys;
+	std::string key = fmt::format("pc{}|", reflection.pushConstantSize);
+	for (uint32_t set = 0; set != setCount; ++set) {
+		setKeys.push_back(SetLayoutKey(reflection, set));
+		key += setKeys.back() + "|";
+	}
+
+	std::lock_guard<std::mutex> lock(m_layoutMutex);
+
+	auto it = m_interfaceLayouts.find(key);
+	if (it != m_interfaceLayouts.end()) {
+		layout = it->second;
+		return true;
+	}
+
+	// set layouts are shared too (unused set indices get empty layout)
+	layout.setLayouts.clear();
+	for (uint32_t set = 0; set != setCount; ++set) {
+		if (bindless && set == BindlessTable::SET) {
+			layout.setLayouts.push_back(m_bindless.GetLayout());  // owned by table
+			continue;
+		}
+
+		VkDescriptorSetLayout &setLayout = m_setLayouts[setKeys[set]];
+		if (setLayout == VK_NULL_HANDLE) {
+			DescriptorLayoutBuilder builder;
+			for (auto &binding : reflection.bindings) {
+				if (binding.set == set) {
+					builder.AddBinding(binding.binding, binding.type, binding.count);
+				}
+			}
+			setLayout = builder.Build(m_device, VK_SHADER_STAGE_COMPUTE_BIT);
+		}
+		layout.setLayouts.push_back(setLayout);
+	}
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.pSetLayouts = layout.setLayouts.data();
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(layout.setLayouts.size());
+
+	VkPushConstantRange pushConstants{};
+	pushConstants.offset = 0;
+	pushConstants.size = reflection.pushConstantSize;
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	if (reflection.pushConstantSize > 0) {
+		layoutInfo.pPushConstantRanges = &pushConstants;
+		layoutInfo.pushConstantRangeCount = 1;
+	}
+
+	VK_CHECK(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &layout.layout));
+
+	m_interfaceLayouts[key] = layout;
+	return true;
+}
+
+
+void VulkanEngine::PollShaderChanges() {
+	std::vector<std::string> changed = m_shaderWatcher.Poll();
+	if (changed.empty()) {
+		return;
+	}
+
+	// include files are not effects themselves, rebuild every effect that uses them
+	std::set<std::string> sources;
+	for (auto &file : changed) {
+		if (std::filesystem::path(file).extension() == ".glsl") {
+			for (auto &dependent : vkutils::FindDependentShaders(m_shadersPath, file)) {
+				sources.insert(dependent);
+			}
+		} else {
+			sources.insert(file);
+		}
+	}
+
+	for (auto &source : sources) {
+		std::filesystem::path sourcePath = std::filesystem::path(m_shadersPath) / source;
+
+		auto it = std::find_if(m_computeEffects.begin(), m_computeEffects.end(), [&](const ComputeEffect &e) {
+			return !e.sourcePath.empty() && std::filesystem::path(e.sourcePath).lexically_normal() == sourcePath.lexically_normal();
+		});
+
+		size_t effectIndex = it - m_computeEffects.begin();
+		if (it == m_computeEffects.end()) {
+			// new shader, compiled file goes next to others (same as cmake does)
+			ComputeEffect effect{};
+			effect.name = sourcePath.stem().string();
+			effect.shaderPath = m_shadersPath + sourcePath.filename().string() + ".spv";
+			effect.sourcePath = sourcePath.string();
+			effect.layout = VK_NULL_HANDLE;
+			effect.pipeline = VK_NULL_HANDLE;
+
+			m_computeEffects.push_back(effect);
+			{
+				std::lock_guard<std::mutex> lock(m_buildMutex);
+				m_buildStarted.push_back(true);  // there is no compiled file to build from
+			}
+
+			spdlog::info("New effect \"{}\"", effect.name);
+		}
+
+		ReloadComputeEffect(effectIndex);
+	}
+}
+
+
+void VulkanEngine::ReloadComputeEffect(size_t effectIndex) {
+	ComputeEffect &effect = m_computeEffects[effectIndex];
+	uint32_t generation = ++effect.buildGeneration;
+
+	spdlog::info("Recompiling effect \"{}\"", effect.name);
+
+	// paths are copied, so worker does not touch effects list
+	// selected specialization is kept if new code still has same constants
+	std::string sourcePath = effect.sourcePath;
+	std::string shaderPath = effect.shaderPath;
+	std::map<uint32_t, uint32_t> specOverrides = GetSpecOverrides(effect, effect.specValues);
+	std::array<uint32_t, 2> tunedLocalSize = GetTunedLocalSize(effect);
+	bool urgent = static_cast<int>(effectIndex) == m_currentComputeEffect;
+	m_compileThreads->Submit([this, effectIndex, sourcePath, shaderPath, generation, specOverrides, tunedLocalSize]() {
+		CompileComputeEffect(effectIndex, sourcePath, shaderPath, generation, specOverrides, tunedLocalSize);
+	}, urgent);
+}
+
+
+void VulkanEngine::CompileComputeEffect(size_t effectIndex, const std::string &sourcePath, const std::string &shaderPath, uint32_t generation, const std::map<uint32_t, uint32_t> &specOverrides, std::array<uint32_t, 2> tunedLocalSize) {
+	EffectBuild build{};
+	build.effectIndex = effectIndex;
+	build.pipeline = VK_NULL_HANDLE;
+	build.generation = generation;
+	build.variant = false;
+	build.tunedLocalSize = tunedLocalSize;
+
+	auto spirv = std::make_shared<std::vector<uint32_t>>();
+	if (vkutils::CompileComputeShader(sourcePath, m_shadersPath, *spirv, build.error)) {
+		// keep compiled shader up to date, so next start does not need cmake
+		if (!vkutils::WriteSpirvFile(shaderPath, *spirv)) {
+			spdlog::warn("failed to write compiled shader: {}", shaderPath);
+		}
+
+		if (DeclareOutputFormat(*spirv, build.error)) {
+			build.spirv = spirv;
+			CreateComputePipeline(specOverrides, build);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_buildMutex);
+	m_finishedBuilds.push_back(build);
+}
+
+
+std::map<uint32_t, uint32_t> VulkanEngine::GetSpecOverrides(const ComputeEffect &effect, const std::vector<uint32_t> &values) const {
+	std::map<uint32_t, uint32_t> overrides;
+	for (size_t i = 0; i < values.size() && i < effect.reflection.specConstants.size(); ++i) {
+		overrides[effect.reflection.specConstants[i].id] = values[i];
+	}
+	return overrides;
+}
+
+
+void VulkanEngine::SelectEffectVariant(size_t effectIndex, const std::vector<uint32_t> &values) {
+	ComputeEffect &effect = m_computeEffects[effectIndex];
+	if (!effect.spirv) {
+		return;  // first build is not finished yet
+	}
+	effect.specValues = values;
+	RestartSteadyState();
+
+	// variants are kept, so switching back is free
+	auto it = effect.variants.find(values);
+	if (it != effect.variants.end()) {
+		effect.pipeline = it->second;
+		effect.activeValues = values;
+		return;
+	}
+
+	if (std::find(effect.variantsBuilding.begin(), effect.variantsBuilding.end(), values) != effect.variantsBuilding.end()) {
+		return;
+	}
+	effect.variantsBuilding.push_back(values);
+
+	// current variant keeps running until new one is built
+	std::shared_ptr<const std::vector<uint32_t>> spirv = effect.spirv;
+	std::map<uint32_t, uint32_t> specOverrides = GetSpecOverrides(effect, values);
+	uint32_t generation = effect.buildGeneration;
+
+	m_compileThreads->Submit([this, effectIndex, spirv, specOverrides, generation]() {
+		EffectBuild build{};
+		build.effectIndex = effectIndex;
+		build.pipeline = VK_NULL_HANDLE;
+		build.generation = generation;
+		build.variant = true;
+		build.spirv = spirv;
+
+		CreateComputePipeline(specOverrides, build);
+
+		std::lock_guard<std::mutex> lock(m_buildMutex);
+		m_finishedBuilds.push_back(build);
+	}, true);
+}
+
+
+void VulkanEngine::RetireEffectPipelines(ComputeEffect &effect) {
+	// previous frame can still use them, they are destroyed when this frame slot comes around again
+	for (auto &[values, pipeline] : effect.variants) {
+		RetireHandleAfterFrame(pipeline);
+	}
+
+	effect.variants.clear();
+	effect.variantsBuilding.clear();
+	effect.pipeline = VK_NULL_HANDLE;
+	effect.activeValues.clear();
+	RetireRecordedPipeline(effect);
+}
+
+
+std::array<uint32_t, 2> VulkanEngine::GetTunedLocalSize(const ComputeEffect &effect) const {
+	std::array<uint32_t, 2> localSize = {0, 0};  // zero keeps shader default
+	m_workgroupTuning.Get(effect.name, localSize[0], localSize[1]);
+	return localSize;
+}
+
+
+void VulkanEngine::InstallFinishedPipelines() {
+	std::vector<EffectBuild> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_buildMutex);
+		if (m_finishedBuilds.empty()) {
+			return;
+		}
+		finished.swap(m_finishedBuilds);
+	}
+	RestartSteadyState();
+
+	// called between frames, so effects that are used by recorded commands are not changed
+	uint32_t firstBuilds = 0;
+	for (auto &build : finished) {
+		ComputeEffect &effect = m_computeEffects[build.effectIndex];
+
+		if (build.generation == 0 && !build.variant) {
+			firstBuilds++;
+		}
+
+		if (build.generation != effect.buildGeneration) {
+			// newer build was requested while this one was running, this pipeline was never used
+			if (build.pipeline != VK_NULL_HANDLE) {
+				vkDestroyPipeline(m_device, build.pipeline, nullptr);
+			}
+			continue;
+		}
+
+		if (build.variant) {
+			auto building = std::find(effect.variantsBuilding.begin(), effect.variantsBuilding.end(), build.specValues);
+			if (building != effect.variantsBuilding.end()) {
+				effect.variantsBuilding.erase(building);
+			}
+
+			if (build.pipeline == VK_NULL_HANDLE) {
+				effect.compileError = build.error;
+				spdlog::error("failed to build variant of effect \"{}\": {}", effect.name, build.error);
+				continue;
+			}
+
+			effect.variants[build.specValues] = build.pipeline;
+			if (build.specValues == effect.specValues) {
+				effect.pipeline = build.pipeline;
+				effect.activeValues = build.specValues;
+			}
+			continue;
+		}
+
+		if (build.pipeline == VK_NULL_HANDLE) {
+			// last good pipeline keeps running
+			effect.compileError = build.error;
+			if (build.generation != 0) {
+				spdlog::error("failed to reload effect \"{}\":\n{}", effect.name, build.error);
+			}
+			continue;
+		}
+
+		// variants of old code are not valid anymore
+		RetireEffectPipelines(effect);
+
+		effect.pipeline = build.pipeline;
+		effect.spirv = build.spirv;
+		effect.specValues = build.specValues;
+		effect.activeValues = build.specValues;
+		effect.variants[build.specValues] = build.pipeline;
+		effect.compileError.clear();
+		InstallEffectInterface(effect, build);
+
+		if (build.generation != 0) {
+			spdlog::info("Reloaded effect \"{}\"", effect.name);
+		}
+	}
+
+	if (firstBuilds == 0) {
+		return;
+	}
+
+	m_pendingBuilds -= firstBuilds;
+	if (m_pendingBuilds == 0) {
+		// compare with and without cache to see how much time cache saves
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_buildStartTime).count();
+		spdlog::info("Created {} compute pipelines in {:.2f}ms ({} start)", m_computeEffects.size(), ms, m_pipelineCache.IsWarm() ? "warm" : "cold");
+
+		// save right away, so other players started later can use it
+		m_pipelineCache.SaveAsync();
+	}
+}
+
+
+void VulkanEngine::DestroyComputeEffects() {
+	// stop background builds and destroy what they have already created
+	if (m_compileThreads) {
+		m_compileThreads->Clear();
+		m_compileThreads->WaitIdle();
+		m_compileThreads.reset();
+	}
+
+	for (auto &build : m_finishedBuilds) {
+		if (build.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_device, build.pipeline, nullptr);
+		}
+	}
+	m_finishedBuilds.clear();
+
+	for (auto &effect : m_computeEffects) {
+		for (auto &[values, pipeline] : effect.variants) {
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+		}
+		if (effect.recordedPipeline != VK_NULL_HANDLE && effect.recordedPipeline != effect.recordedSource) {
+			vkDestroyPipeline(m_device, effect.recordedPipeline, nullptr);
+			vkDestroyPipelineLayout(m_device, effect.recordedLayout, nullptr);
+		}
+		DestroyEffectResources(effect.resources);
+	}
+	m_computeEffects.clear();
+
+	for (auto &[key, layout] : m_interfaceLayouts) {
+		vkDestroyPipelineLayout(m_device, layout.layout, nullptr);
+	}
+	m_interfaceLayouts.clear();
+
+	for (auto &[key, setLayout] : m_setLayouts) {
+		vkDestroyDescriptorSetLayout(m_device, setLayout, nullptr);
+	}
+	m_setLayouts.clear();
+}
+
+
+// push constant members that engine fills, matched by name and type
+static const struct {
+	const char     *name;
+	uint32_t        components;
+	EngineInput     input;
+} ENGINE_INPUTS[] = {
+	{ "data1",  4, EngineInput::Data1  },
+	{ "time",   1, EngineInput::Time   },
+	{ "aspect", 1, EngineInput::Aspect },
+	{ "mouse",  2, EngineInput::Mouse  },
+	{ "resolution", 2, EngineInput::Resolution },
+};
+
+
+void VulkanEngine::InstallEffectInterface(ComputeEffect &effect, const EffectBuild &build) {
+	effect.layout = build.layout;
+	effect.setLayouts = build.setLayouts;
+
+	// parameters that still exist after hot reload keep their values
+	std::vector<uint8_t> pushData(build.reflection.pushConstantSize, 0);
+	for (auto &member : build.reflection.pushConstants) {
+		for (auto &old : effect.reflection.pushConstants) {
+			if (old.name == member.name && old.size == member.size && old.scalar == member.scalar && old.offset + old.size <= effect.pushData.size()) {
+				std::memcpy(pushData.data() + member.offset, effect.pushData.data() + old.offset, member.size);
+			}
+		}
+	}
+	effect.pushData = std::move(pushData);
+
+	// same for members of parameter blocks, matched by block name too
+	std::vector<std::vector<uint8_t>> parameterData;
+	for (auto &block : build.reflection.parameterBlocks) {
+		std::vector<uint8_t> data(block.size, 0);
+		for (size_t b = 0; b != effect.reflection.parameterBlocks.size() && b != effect.parameterData.size(); ++b) {
+			const ParameterBlock &oldBlock = effect.reflection.parameterBlocks[b];
+			if (oldBlock.name != block.name) {
+				continue;
+			}
+			for (auto &member : block.members) {
+				for (auto &old : oldBlock.members) {
+					if (old.name == member.name && old.size == member.size && old.scalar == member.scalar && old.offset + old.size <= effect.parameterData[b].size()) {
+						std::memcpy(data.data() + member.offset, effect.parameterData[b].data() + old.offset, member.size);
+					}
+				}
+			}
+		}
+		parameterData.push_back(std::move(data));
+	}
+	effect.parameterData = std::move(parameterData);
+	effect.reflection = build.reflection;
+
+	effect.inputs.clear();
+	for (auto &member : effect.reflection.pushConstants) {
+		for (auto &input : ENGINE_INPUTS) {
+			if (member.name == input.name && member.scalar == ReflectedScalar::Float && member.components == input.components && member.count == 1) {
+				effect.inputs.push_back({input.input, member.offset});
+			}
+		}
+	}
+
+	std::string resourceKey = ResourceKey(effect.reflection);
+	if (resourceKey != effect.resourceKey) {
+		RetireEffectResources(effect);
+		effect.resourceKey = resourceKey;
+		CreateEffectResources(effect);
+	}
+}
+
+
+void VulkanEngine::CreateEffectResources(ComputeEffect &effect) {
+	const std::vector<DescriptorBinding> &bindings = effect.reflection.bindings;
+
+	// most effects only write render image and use shared descriptor set, bindless table is shared too
+	bool ownSets = !std::all_of(bindings.begin(), bindings.end(), [](const DescriptorBinding &binding) {
+		return IsRenderImageBinding(binding) || BindlessTable::IsTableBinding(binding);
+	});
+	bool handles = std::any_of(effect.reflection.pushConstants.begin(), effect.reflection.pushConstants.end(), [&](const PushConstantMember &member) {
+		return GetBindlessHandle(effect.reflection, member) != BindlessHandle::None;
+	});
+	if (!ownSets && !handles) {
+		return;
+	}
+
+	EffectResources &resources = effect.resources;
+	m_recordedGeneration++;
+
+	// images have size of render image, runtime arrays get one element per pixel
+	VkExtent3D extent = m_renderImage.imageExtent;
+
+	if (ownSets) {
+		bool bindless = UsesBindlessTable(effect.reflection);
+
+		// pool holds exactly what this effect needs
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (auto &binding : bindings) {
+			if (!BindlessTable::IsTableBinding(binding)) {
+				poolSizes.push_back({binding.type, binding.count});
+			}
+		}
+
+		// table set is not allocated, it is placed at its index
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		for (uint32_t set = 0; set != effect.setLayouts.size(); ++set) {
+			if (!bindless || set != BindlessTable::SET) {
+				setLayouts.push_back(effect.setLayouts[set]);
+			}
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = static_cast<uint32_t>(setLayouts.size());
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &resources.descriptorPool));
+
+		resources.descriptorSets.resize(setLayouts.size());
+		VkDescriptorSetAllocateInfo setInfo{};
+		setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setInfo.descriptorPool = resources.descriptorPool;
+		setInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+		setInfo.pSetLayouts = setLayouts.data();
+		VK_CHECK(vkAllocateDescriptorSets(m_device, &setInfo, resources.descriptorSets.data()));
+		if (bindless) {
+			resources.descriptorSets.insert(resources.descriptorSets.begin() + BindlessTable::SET, m_bindless.GetSet());
+		}
+
+		std::deque<VkDescriptorImageInfo>  imageInfos;  // deque keeps pointers valid
+		std::deque<VkDescriptorBufferInfo> bufferInfos;
+		std::vector<VkWriteDescriptorSet>  writes;
+
+		for (auto &binding : bindings) {
+			if (BindlessTable::IsTableBinding(binding)) {
+				continue;
+			}
+
+			for (uint32_t i = 0; i != binding.count; ++i) {
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = resources.descriptorSets[binding.set];
+				write.dstBinding = binding.binding;
+				write.dstArrayElement = i;
+				write.descriptorCount = 1;
+				write.descriptorType = binding.type;
+
+				if (IsRenderImageBinding(binding)) {
+					imageInfos.push_back({VK_NULL_HANDLE, m_renderImage.imageView, VK_IMAGE_LAYOUT_GENERAL});
+					write.pImageInfo = &imageInfos.back();
+				} else if (binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+					VkFormat format = binding.imageFormat != VK_FORMAT_UNDEFINED ? binding.imageFormat : m_renderImage.imageFormat;
+					resources.images.push_back(CreateImage(extent, format, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+
+					imageInfos.push_back({VK_NULL_HANDLE, resources.images.back().imageView, VK_IMAGE_LAYOUT_GENERAL});
+					write.pImageInfo = &imageInfos.back();
+				} else {
+					size_t size = binding.bufferSize + static_cast<size_t>(binding.arrayStride) * extent.width * extent.height;
+					VkBufferUsageFlags usage = binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+					resources.buffers.push_back(CreateBuffer(std::max<size_t>(size, 16), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY));
+
+					bufferInfos.push_back({resources.buffers.back().buffer, 0, VK_WHOLE_SIZE});
+					write.pBufferInfo = &bufferInfos.back();
+				}
+
+				writes.push_back(write);
+			}
+		}
+
+		vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	// images and buffers in bindless table, their handles are written to push constants
+	// images have render image format, buffers have vec4 per pixel
+	for (auto &member : effect.reflection.pushConstants) {
+		uint32_t handle = BindlessTable::INVALID_HANDLE;
+		switch (GetBindlessHandle(effect.reflection, member)) {
+			case BindlessHandle::Image:
+				resources.images.push_back(CreateImage(extent, m_renderImage.imageFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+				handle = m_bindless.AddImage(resources.images.back().imageView);
+				resources.imageHandles.push_back(handle);
+				break;
+			case BindlessHandle::Buffer:
+				resources.buffers.push_back(CreateBuffer(sizeof(glm::vec4) * extent.width * extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY));
+				handle = m_bindless.AddBuffer(resources.buffers.back().buffer);
+				resources.bufferHandles.push_back(handle);
+				break;
+			case BindlessHandle::None:
+				continue;
+		}
+		if (member.offset + sizeof(handle) <= effect.pushData.size()) {
+			std::memcpy(effect.pushData.data() + member.offset, &handle, sizeof(handle));
+		}
+	}
+
+	// effect state starts from zero
+	ImmediateSubmit([&](VkCommandBuffer cmd) {
+		VkClearColorValue clearColor{};
+		VkImageSubresourceRange range = vkinit::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+
+		// all images are transitioned with one barrier before and one after clears
+		BarrierBuilder barriers;
+		for (auto &image : resources.images) {
+			barriers.Track(image.image, ImageUsage::Undefined);
+			barriers.Transition(image.image, ImageUsage::TransferDst);
+		}
+		barriers.Flush(cmd);
+
+		for (auto &image : resources.images) {
+			vkCmdClearColorImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+			barriers.Transition(image.image, ImageUsage::ComputeStorage);
+		}
+		barriers.Flush(cmd);
+
+		for (auto &buffer : resources.buffers) {
+			vkCmdFillBuffer(cmd, buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		}
+
+		VkMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+
+		VkDependencyInfo depInfo{};
+		depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		depInfo.memoryBarrierCount = 1;
+		depInfo.pMemoryBarriers = &barrier;
+		vkCmdPipelineBarrier2(cmd, &depInfo);
+	});
+
+	spdlog::info("Effect \"{}\" uses {} images and {} buffers of its own", effect.name, resources.images.size(), resources.buffers.size());
+}
+
+
+void VulkanEngine::RetireEffectResources(ComputeEffect &effect) {
+	EffectResources retired = std::move(effect.resources);
+	effect.resources = EffectResources{};
+
+	if (!HasResources(retired)) {
+		return;
+	}
+
+	// previous frame can still use them
+	for (auto &image : retired.images) {
+		RetireHandleAfterFrame(image);
+	}
+	for (auto &buffer : retired.buffers) {
+		RetireHandleAfterFrame(buffer);
+	}
+	if (retired.descriptorPool != VK_NULL_HANDLE) {
+		RetireHandleAfterFrame(retired.descriptorPool);
+	}
+
+	// table entries can be given to other resources only after frame stops using them
+	for (uint32_t handle : retired.imageHandles) {
+		m_retiredObjects.PushBindlessImage(m_submittedValue + 1, handle);
+	}
+	for (uint32_t handle : retired.bufferHandles) {
+		m_retiredObjects.PushBindlessBuffer(m_submittedValue + 1, handle);
+	}
+	m_recordedGeneration++;
+}
+
+
+void VulkanEngine::DestroyEffectResources(const EffectResources &resources) {
+	for (auto &image : resources.images) {
+		DestroyImage(image);
+	}
+	for (auto &buffer : resources.buffers) {
+		DestroyBuffer(buffer);
+	}
+	for (uint32_t handle : resources.imageHandles) {
+		m_bindless.RemoveImage(handle);
+	}
+	for (uint32_t handle : resources.bufferHandles) {
+		m_bindless.RemoveBuffer(handle);
+	}
+	if (resources.descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, resources.descriptorPool, nullptr);  // frees sets
+	}
+}
+
+
+void VulkanEngine::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)> &&function) {
+	VK_CHECK(vkResetFences(m_device, 1, &m_immFence));
+	VK_CHECK(vkResetCommandBuffer(m_immCommandBuffer, 0));
+
+	VkCommandBuffer cmd = m_immCommandBuffer;
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	function(cmd);
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	VkCommandBufferSubmitInfo submitInfo = vkinit::CommandBufferSubmitInfo(cmd);
+	VkSubmitInfo2 submit = vkinit::SubmitInfo(&submitInfo, nullptr, nullptr);
+
+	// submit command buffer and block fence
+	VK_CHECK(vkQueueSubmit2(m_graphicsQueue, 1, &submit, m_immFence));
+	VK_CHECK(vkWaitForFences(m_device, 1, &m_immFence, true, 9999999999));
+}
+
+
+AllocatedBuffer VulkanEngine::CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = allocSize;
+	bufferInfo.usage = usage;
+
+	// host visible buffers stay mapped for their whole lifetime
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = memoryUsage;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	AllocatedBuffer newBuffer;
+	VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &newBuffer.buffer, &newBuffer.allocation, &newBuffer.info));
+
+	return newBuffer;
+}
+
+
+void VulkanEngine::DestroyBuffer(const AllocatedBuffer &buffer) {
+	vmaDestroyBuffer(m_allocator, buffer.buffer, buffer.allocation);
+}
+
+
+AllocatedImage VulkanEngine::CreateImage(VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, bool sharedWithCompute) {
+	AllocatedImage newImage;
+	newImage.imageFormat = format;
+	newImage.imageExtent = extent;
+
+	VkImageCreateInfo imgInfo = vkinit::ImageCreateInfo(format, usage, extent);
+
+	uint32_t queueFamilies[2] = {m_graphicsQueueFamily, m_computeQueueFamily};
+	if (sharedWithCompute) {
+		imgInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imgInfo.queueFamilyIndexCount = 2;
+		imgInfo.pQueueFamilyIndices = queueFamilies;
+	}
+
+	// always allocate images from gpu local memory
+	VmaAllocationCreateInfo imgAllocInfo{};
+	imgAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	imgAllocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VK_CHECK(vmaCreateImage(m_allocator, &imgInfo, &imgAllocInfo, &newImage.image, &newImage.allocation, nullptr));
+
+	VkImageViewCreateInfo imgViewInfo = vkinit::ImageviewCreateInfo(format, newImage.image, VK_IMAGE_ASPECT_COLOR_BIT);
+	VK_CHECK(vkCreateImageView(m_device, &imgViewInfo, nullptr, &newImage.imageView));
+
+	return newImage;
+}
+
+
+void VulkanEngine::DestroyImage(const AllocatedImage &image) {
+	vkDestroyImageView(m_device, image.imageView, nullptr);
+	vmaDestroyImage(m_allocator, image.image, image.allocation);
+}
+
+
+void VulkanEngine::InitReadback() {
+	m_readback.Init(m_device, m_allocator, m_config.readbackBuffers);
+	m_mainDeletionQueue.PushFunction([&]() {
+		m_readback.Destroy();
+	});
+
+	m_exportWorkers = std::make_unique<ParallelWorkers>(m_config.convertThreads);
+	if (m_config.frameFormat == FrameFileFormat::Exr) {
+		spdlog::info("Frame files: EXR ({} compression), {} threads", ExrCompressionName(m_config.exrCompression), m_exportWorkers->GetThreadCount());
+	} else if (m_config.frameFormat == FrameFileFormat::Raw) {
+		// staging buffer is held until its file is written, frame and screenshot can write same buffer
+		m_frameWriter.Init(m_config.writeBackend, m_config.directIo, m_config.writeThreads, 2 * m_config.readbackBuffers, m_config.readbackBuffers,
+			[this](uint64_t tag, bool ok) {
+				m_readback.Release(static_cast<uint32_t>(tag));
+				if (!ok) {
+					spdlog::error("failed to write frame {}", tag >> 32);
+				}
+			});
+		spdlog::info("Frame files: raw RGBA16F (rows of width * 8 bytes), {} backend{}", WriteBackendName(m_frameWriter.GetBackend()),
+			m_frameWriter.IsDirect() ? " with direct io" : "");
+	} else {
+		spdlog::info("Frame conversion: {} kernel, {} threads{}", vkutils::ConvertKernelName(vkutils::GetBestConvertKernel()), m_exportWorkers->GetThreadCount(),
+			m_config.exportSrgb ? ", sRGB" : "");
+	}
+
+	m_frameOutputConsumer = m_readback.AddConsumer([this](const ReadbackImage &image) {
+		WriteFrameOutput(image, "frame");
+	});
+	m_screenshotConsumer = m_readback.AddConsumer([this](const ReadbackImage &image) {
+		std::filesystem::create_directories(m_config.outputDir);
+		WriteFrameOutput(image, "screenshot");
+		spdlog::info("Screenshot of frame {} written to {}", image.frameNumber, m_config.outputDir);
+	});
+
+	if (!m_config.recordPath.empty() && !m_config.benchmark) {
+		m_recordConsumer = m_readback.AddConsumer([this](const ReadbackImage &image) {
+			m_recorder.Submit(image, m_config.headless);
+		});
+		m_recorder.Start(m_config.recordPath, m_config.recordFormat, m_config.exportSrgb, m_config.recordFps, m_config.recordThreads, &m_readback);
+	}
+}
+
+
+uint32_t VulkanEngine::GetReadbackConsumers() {
+	uint32_t consumers = 0;
+	if (m_recorder.IsRecording()) {
+		consumers |= m_recordConsumer;  // recording replaces frame files
+	} else if (m_config.headless && !m_config.benchmark) {
+		consumers |= m_frameOutputConsumer;  // benchmark does not write frames
+	}
+	if (m_screenshotRequested) {
+		consumers |= m_screenshotConsumer;
+	}
+	if (consumers == 0) {
+		return 0;
+	}
+
+	// headless frames must not be dropped, so oldest copy is waited for when every buffer is busy
+	// (buffers that recorder holds are given back by its converter threads, frame writer gives them back when files are written)
+	while (m_config.headless && !m_readback.CanRecord()) {
+		uint64_t value = m_readback.GetOldestPendingValue();
+		if (value == 0) {
+			// completions of frame writer are delivered here, recorder releases buffers from its threads
+			if (m_frameWriter.GetInFlight() != 0) {
+				m_frameWriter.Poll(true);
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+			continue;
+		}
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_frameTimeline;
+		waitInfo.pValues = &value;
+		VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+		m_readback.Poll(value);
+	}
+
+	// in window mode frame is rendered without copy, screenshot is taken by one of next frames
+	return m_readback.CanRecord() ? consumers : 0;
+}
+
+
+void VulkanEngine::WriteFrameOutput(const ReadbackImage &image, const char *name) {
+	// path and converted pixels are frame data, so writing frame does not allocate once arena has grown
+	size_t pathSize = m_config.outputDir.size() + 48;
+	char *path = m_frameArena.Allocate<char>(pathSize);
+	bool exr = m_config.frameFormat == FrameFileFormat::Exr;
+	bool raw = m_config.frameFormat == FrameFileFormat::Raw;
+	*fmt::format_to_n(path, pathSize - 1, "{}/{}_{:05}.{}", m_config.outputDir, name, image.frameNumber, exr ? "exr" : raw ? "raw" : "ppm").out = '\0';
+
+	// staging buffer is written as it is in background, it is held until its file is complete
+	if (raw) {
+		m_readback.Retain(image.buffer);
+		uint64_t tag = (static_cast<uint64_t>(image.frameNumber) << 32) | image.buffer;
+		if (!m_frameWriter.Submit(path, image.pixels, image.rowPitch * image.height, image.bufferSize, image.buffer, tag)) {
+			m_readback.Release(image.buffer);
+			spdlog::error("failed to write frame: {}", path);
+		}
+		return;
+	}
+
+	// half floats go to file as rendered, straight from staging buffer
+	if (exr) {
+		if (!m_exrWriter.Write(path, image.pixels, image.width, image.height, image.rowPitch, m_config.exrCompression, *m_exportWorkers)) {
+			spdlog::error("failed to write frame: {}", path);
+		}
+		return;
+	}
+
+	uint8_t *row = m_frameArena.Allocate<uint8_t>(static_cast<size_t>(image.width) * 3);
+	uint8_t *pixels = m_frameArena.Allocate<uint8_t>(vkutils::GetConvertedSize(vkutils::PixelFormat::Rgba8, image.width, image.height));
+
+	vkutils::PixelConversion conversion{vkutils::PixelFormat::Rgba8, m_config.exportSrgb, vkutils::GetBestConvertKernel()};
+	vkutils::ConvertPixels(conversion, image.pixels, image.rowPitch, pixels, image.width, image.height, *m_exportWorkers);
+
+	if (!vkutils::WriteFramePPM(path, pixels, image.width, image.height, row)) {
+		spdlog::error("failed to write frame: {}", path);
+	}
+}
+
+
+void VulkanEngine::InitImgui() {
+	std::vector<VkDescriptorPoolSize> poolSizes{
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
+		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	poolInfo.maxSets = 1000;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool imguiPool;
+	VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &imguiPool));
+
+	// 2: initialize imgui library
+
+	// this initializes the core structures of imgui
+	// its allocations go through operator new, so they are counted in frames too
+	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions([](size_t size, void *) { return ::operator new(size); }, [](void *ptr, void *) { ::operator delete(ptr); });
+	ImGui::CreateContext();
+
+	// this initializes imgui for SDL
+	ImGui_ImplSDL2_InitForVulkan(m_window);
+
+	// this initializes imgui for Vulkan
+	ImGui_ImplVulkan_InitInfo init_info = {};
+	init_info.Instance = m_instance;
+	init_info.PhysicalDevice = m_physicalDevice;
+	init_info.Device = m_device;
+	init_info.Queue = m_graphicsQueue;
+	init_info.DescriptorPool = imguiPool;
+	init_info.PipelineCache = m_pipelineCache.Get();
+	init_info.MinImageCount = 3;
+	init_info.ImageCount = 3;
+	init_info.UseDynamicRendering = true;
+
+	//dynamic rendering parameters for imgui to use
+	VkPipelineRenderingCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+
+	init_info.PipelineRenderingCreateInfo = pipelineInfo;
+	init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+	init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &m_swapChainImageFormat;
+
+
+	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+
+	ImGui_ImplVulkan_Init(&init_info);
+
+	ImGui_ImplVulkan_CreateFontsTexture();
+
+	// add the destroy the imgui created structures
+	m_mainDeletionQueue.PushFunction([=]() {
+		ImGui_ImplVulkan_Shutdown();
+		ImGui_ImplSDL2_Shutdown();
+		ImGui::DestroyContext();
+		vkDestroyDescriptorPool(m_device, imguiPool, nullptr);
+	});
+}
+
+
+void VulkanEngine::DrawPresentPass(VkCommandBuffer cmd, uint32_t imageIndex, uint32_t frameSlot, VkImage source, VkDescriptorSet sourceDescriptors) {
+	bool resolve = source != VK_NULL_HANDLE;
+
+	VkRenderingAttachmentInfo colorAttachment = vkinit::AttachmentInfo(m_swapChainImageViews[imageIndex], nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	if (resolve) {
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;  // every pixel is overwritten
+	}
+	VkRenderingInfo renderInfo = vkinit::RenderingInfo(m_swapChainExtent, &colorAttachment, nullptr);
+
+	vkCmdBeginRendering(cmd, &renderInfo);
+
+	if (resolve) {
+		m_barriers.Check(source, ImageUsage::FragmentSample);
+	}
+	m_barriers.Check(m_swapChainImages[imageIndex], ImageUsage::ColorAttachment);
+
+	if (resolve) {
+		// rendered part of render image is stretched over whole swapchain image, scaling and format conversion are done by sampler
+		m_gpuProfiler.BeginPhase(cmd, frameSlot, GpuPhase::Resolve);
+
+		VkViewport viewport{};
+		viewport.width = static_cast<float>(m_swapChainExtent.width);
+		viewport.height = static_cast<float>(m_swapChainExtent.height);
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{};
+		scissor.extent = m_swapChainExtent;
+
+		// uv is clamped half texel inside rendered part, so linear filter does not read stale pixels around it
+		float imageWidth = static_cast<float>(m_renderImage.imageExtent.width);
+		float imageHeight = static_cast<float>(m_renderImage.imageExtent.height);
+		float uvParams[4] = {
+			m_renderExtent.width / imageWidth,
+			m_renderExtent.height / imageHeight,
+			(m_renderExtent.width - 0.5f) / imageWidth,
+			(m_renderExtent.height - 0.5f) / imageHeight,
+		};
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_resolvePipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_resolveLayout, 0, 1, &sourceDescriptors, 0, nullptr);
+		vkCmdPushConstants(cmd, m_resolveLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uvParams), uvParams);
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+		vkCmdDraw(cmd, 3, 1, 0, 0);
+
+		m_gpuProfiler.EndPhase(cmd, frameSlot, GpuPhase::Resolve);
+	}
+
+	if (m_showImgui) {
+		// overlay is drawn in same pass, swapchain image is written once
+		m_gpuProfiler.BeginPhase(cmd, frameSlot, GpuPhase::Imgui);
+		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+		m_gpuProfiler.EndPhase(cmd, frameSlot, GpuPhase::Imgui);
+	}
+
+	vkCmdEndRendering(cmd);
+}
+
+
+int VulkanEngine::Run() {
+	if (m_config.autotune) {
+		RunAutotune();
+		return 0;
+	}
+
+	if (m_config.benchmark) {
+		return RunBenchmark();
+	}
+
+	if (m_config.headless) {
+		return RunHeadless();
+	}
+
+	SDL_Event e;
+	bool bQuit = false;
 
 	while (!bQuit) {
 		while (SDL_PollEvent(&e) != 0) {
@@ -543,39 +2083,511 @@ void VulkanEngine::Run() {
 				}
 			}
 
-			if (e.type == SDL_KEYDOWN) {
-				if (e.key.keysym.scancode == SDL_SCANCODE_F11) {
-					SDL_SetWindowFullscreen(m_window, m_isFullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP);
-					m_isFullscreen = !m_isFullscreen;
-				}
+			if (e.type == SDL_KEYDOWN) {
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11) {
+					SDL_SetWindowFullscreen(m_window, m_isFullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP);
+					m_isFullscreen = !m_isFullscreen;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12) {
+					m_screenshotRequested = true;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_SPACE) {
+					m_showImgui = !m_showImgui;
+					RestartSteadyState();  // frames without overlay take other path
+				}
+			}
+
+			if (e.type == SDL_MOUSEMOTION) {
+				SDL_GetMouseState(&m_mouseX, &m_mouseY);
+			}
+
+			// send SDL event to imgui for handling
+			ImGui_ImplSDL2_ProcessEvent(&e);
+		}
+
+		if (m_stopRendering) {
+            // throttle the speed to avoid the endless spinning
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+		if (m_resizeRequested) {
+			RecreateSwapChain();
+		}
+
+		if (m_hotReload) {
+			PollShaderChanges();
+		}
+
+		UpdateTime();
+		UpdateDynamicResolution();
+		AddImguiWindows();
+
+		// checkpoint pipeline cache, so it survives crashes (written in background, frame does not wait for it)
+		if (m_totalTime - m_lastCacheCheckpoint > m_config.pipelineCacheCheckpoint) {
+			m_pipelineCache.SaveAsync();
+			m_lastCacheCheckpoint = m_totalTime;
+		}
+
+        Draw();
+	}
+
+	return GetAllocationCheckResult();
+}
+
+
+void VulkanEngine::EndFrameAllocations() {
+	m_frameArena.Reset();
+
+	uint64_t count = vkutils::GetThreadAllocationCount();
+	m_frameAllocations = static_cast<uint32_t>(count - m_allocationCount);
+	m_allocationCount = count;
+
+	if (m_frameNumber < m_steadyStateFrame || m_frameAllocations == 0) {
+		return;
+	}
+
+	m_peakFrameAllocations = std::max(m_peakFrameAllocations, m_frameAllocations);
+	m_allocatingFrames++;
+
+	// first ones are enough to find what allocates (break on operator new in debugger)
+	if (m_config.checkAllocations && m_allocatingFrames <= 10) {
+		spdlog::error("Allocation check: frame {} made {} heap allocations", m_frameNumber, m_frameAllocations);
+	}
+}
+
+
+void VulkanEngine::RestartSteadyState() {
+	m_steadyStateFrame = std::max(m_steadyStateFrame, m_frameNumber + STEADY_STATE_FRAMES);
+}
+
+
+int VulkanEngine::GetAllocationCheckResult() const {
+	if (!m_config.checkAllocations) {
+		return 0;
+	}
+
+	if (m_allocatingFrames > 0) {
+		spdlog::error("Allocation check failed: {} steady state frames allocated (at most {} allocations in one frame)", m_allocatingFrames, m_peakFrameAllocations);
+		return 3;
+	}
+	spdlog::info("Allocation check passed: steady state frames made no heap allocations");
+	return 0;
+}
+
+
+int VulkanEngine::RunHeadless() {
+	std::filesystem::create_directories(m_config.outputDir);
+
+	spdlog::info("Rendering {} frames of effect \"{}\" to {}", m_config.frameCount, m_computeEffects[m_currentComputeEffect].name, m_config.outputDir);
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i != m_config.frameCount; ++i) {
+		// fixed time step, so output does not depend on how fast device is
+		m_totalTime = i * m_config.timeStep;
+
+		Draw();
+	}
+
+	// write frames that are still in flight
+	vkDeviceWaitIdle(m_device);
+	m_readback.Poll(m_submittedValue);
+	m_frameWriter.Flush();
+
+	float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	spdlog::info("Rendered {} frames in {:.3f}s ({:.1f} FPS)", m_config.frameCount, seconds, m_config.frameCount / seconds);
+
+	// last frames in flight are not included, their slots are not reused
+	for (uint32_t p = 0; p != static_cast<uint32_t>(GpuPhase::Count); ++p) {
+		GpuPhaseStats stats = m_gpuProfiler.GetStats(static_cast<GpuPhase>(p));
+		if (stats.samples > 0) {
+			spdlog::info("GPU {}: min {:.3f}ms, avg {:.3f}ms, p99 {:.3f}ms", GpuProfiler::PhaseName(static_cast<GpuPhase>(p)), stats.minMs, stats.avgMs, stats.p99Ms);
+		}
+	}
+
+	return GetAllocationCheckResult();
+}
+
+
+int VulkanEngine::RunBenchmark() {
+	// all effects have to be built before they can be measured
+	m_compileThreads->WaitIdle();
+	InstallFinishedPipelines();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+	BenchmarkReport report;
+	report.device = properties.deviceName;
+	report.driver = fmt::format("{:#x}", properties.driverVersion);
+
+	if (!m_gpuProfiler.IsEnabled()) {
+		spdlog::warn("Device has no timestamps, only wall time is measured");
+	}
+
+	// statistics have to cover every measured frame
+	m_gpuProfiler.SetHistorySize(m_config.benchmarkFrames);
+
+	spdlog::info("Benchmark: {} warmup and {} measured frames per effect", m_config.benchmarkWarmupFrames, m_config.benchmarkFrames);
+	// host side code is also checked here, exit code is 4 if it gave wrong results
+	bool hostChecksPassed = true;
+	if (m_config.benchmarkHost) {
+		vkutils::BenchmarkDeletionQueues(m_device, m_allocator, 4096, report);
+		hostChecksPassed &= vkutils::BenchmarkPixelConversion(1920, 1080, *m_exportWorkers, report);
+		hostChecksPassed &= vkutils::BenchmarkExrCompression(m_config.outputDir, 1920, 1080, *m_exportWorkers, report);
+	}
+	if (m_config.benchmarkWriters) {
+		hostChecksPassed &= vkutils::BenchmarkFrameWriters(m_config.outputDir, 1920 * 1080 * 4 * sizeof(uint16_t), 32, m_config.writeThreads, report);
+	}
+
+	for (auto &resolution : m_config.benchmarkResolutions) {
+		ResizeRenderImage({resolution.width, resolution.height, 1});
+		m_windowExtent = {resolution.width, resolution.height};
+		m_swapChainExtent = m_windowExtent;
+
+		for (size_t i = 0; i != m_computeEffects.size(); ++i) {
+			const ComputeEffect &effect = m_computeEffects[i];
+			if (!m_config.effectName.empty() && effect.name != m_config.effectName) {
+				continue;
+			}
+			if (effect.pipeline == VK_NULL_HANDLE) {
+				spdlog::warn("Skipping \"{}\": pipeline was not built", effect.name);
+				continue;
+			}
+
+			// same effect with every pacing mode, so they are compared on same workload
+			for (FramePacing pacing : m_config.benchmarkPacing) {
+				SetFramePacing(pacing, m_config.framesInFlight);
+
+				BenchmarkResult result = MeasureEffect(i, resolution.width, resolution.height);
+				result.pacing = FramePacingName(pacing);
+				result.framesInFlight = m_framesInFlight;
+				spdlog::info("{} {}x{} {}: gpu {:.3f}ms (min {:.3f}, p99 {:.3f}), submit {:.3f}ms, frame {:.3f}ms, {:.1f} Mpixels/s, {:.1f} allocations/frame",
+					result.effect, result.width, result.height, result.pacing, result.gpuAvgMs, result.gpuMinMs, result.gpuP99Ms, result.cpuSubmitMs, result.frameMs, result.mpixelsPerSecond, result.allocationsPerFrame);
+				report.results.push_back(result);
+			}
+		}
+	}
+
+	if (!vkutils::WriteBenchmarkReport(m_config.benchmarkOutputPath, report)) {
+		spdlog::error("failed to write benchmark report: {}", m_config.benchmarkOutputPath);
+		return 1;
+	}
+	spdlog::info("Benchmark report written to {}", m_config.benchmarkOutputPath);
+
+	if (!hostChecksPassed) {
+		spdlog::error("Host side checks failed, see errors above");
+		return 4;
+	}
+
+	if (m_config.benchmarkBaselinePath.empty()) {
+		return GetAllocationCheckResult();
+	}
+
+	BenchmarkReport baseline;
+	if (!vkutils::ReadBenchmarkReport(m_config.benchmarkBaselinePath, baseline)) {
+		spdlog::error("failed to read benchmark baseline: {}", m_config.benchmarkBaselinePath);
+		return 1;
+	}
+
+	uint32_t regressions = vkutils::CompareBenchmarkReports(baseline, report, m_config.benchmarkTolerance);
+	if (regressions > 0) {
+		spdlog::error("{} results are slower than baseline by more than {:.0f}%", regressions, m_config.benchmarkTolerance * 100.0f);
+		return 2;
+	}
+	return GetAllocationCheckResult();
+}
+
+
+BenchmarkResult VulkanEngine::MeasureEffect(size_t effectIndex, uint32_t width, uint32_t height) {
+	m_currentComputeEffect = static_cast<int>(effectIndex);
+
+	// every effect gets same time values, so workload is same in every run
+	for (uint32_t i = 0; i != m_config.benchmarkWarmupFrames; ++i) {
+		m_totalTime = i * m_config.timeStep;
+		Draw();
+	}
+
+	// timings of warmup frames are not counted
+	vkDeviceWaitIdle(m_device);
+	m_gpuProfiler.ReadPending();
+	m_gpuProfiler.ResetStats();
+
+	// warmup frames let containers grow, measured frames are checked for allocations
+	m_steadyStateFrame = m_frameNumber;
+
+	float submitMs = 0.0f;
+	uint64_t allocations = 0;
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i != m_config.benchmarkFrames; ++i) {
+		m_totalTime = (m_config.benchmarkWarmupFrames + i) * m_config.timeStep;
+		Draw();
+		submitMs += m_cpuSubmitMs;
+		allocations += m_frameAllocations;
+	}
+
+	vkDeviceWaitIdle(m_device);
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	m_gpuProfiler.ReadPending();
+
+	GpuPhaseStats stats = m_gpuProfiler.GetStats(GpuPhase::Compute);
+
+	BenchmarkResult result;
+	result.effect = m_computeEffects[effectIndex].name;
+	result.width = width;
+	result.height = height;
+	result.frames = m_config.benchmarkFrames;
+	result.gpuMinMs = stats.minMs;
+	result.gpuAvgMs = stats.avgMs;
+	result.gpuP99Ms = stats.p99Ms;
+	result.cpuSubmitMs = submitMs / m_config.benchmarkFrames;
+	result.frameMs = ms / m_config.benchmarkFrames;
+	result.allocationsPerFrame = static_cast<float>(allocations) / m_config.benchmarkFrames;
+
+	// throughput of dispatch itself when timestamps are available
+	float pixelMs = stats.samples > 0 && stats.avgMs > 0.0f ? stats.avgMs : result.frameMs;
+	result.mpixelsPerSecond = static_cast<float>(width) * height / (pixelMs * 1000.0f);
+	return result;
+}
+
+
+// workgroup shapes tried by autotune, ones that device does not support are skipped
+static const uint32_t WORKGROUP_SHAPES[][2] = {
+	{8, 8}, {16, 16}, {32, 32}, {16, 8}, {8, 16}, {32, 8}, {8, 32}, {32, 16}, {16, 32},
+	{64, 1}, {128, 1}, {256, 1}, {64, 4}, {4, 4}, {4, 16},
+};
+
+
+void VulkanEngine::RunAutotune() {
+	// all effects have to be built before they can be measured
+	m_compileThreads->WaitIdle();
+	InstallFinishedPipelines();
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	if (queueFamilies[m_graphicsQueueFamily].timestampValidBits == 0) {
+		spdlog::critical("Graphics queue does not support timestamps, workgroup sizes cannot be measured");
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+	const VkPhysicalDeviceLimits &limits = properties.limits;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2;
+
+	VkQueryPool queryPool;
+	VK_CHECK(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &queryPool));
+
+	spdlog::info("Measuring workgroup sizes at {}x{} on {}", m_renderExtent.width, m_renderExtent.height, properties.deviceName);
+
+	for (size_t i = 0; i != m_computeEffects.size(); ++i) {
+		ComputeEffect &effect = m_computeEffects[i];
+		const uint32_t *specIds = effect.reflection.localSizeSpecIds;
+
+		if (effect.pipeline == VK_NULL_HANDLE) {
+			spdlog::warn("Skipping \"{}\": pipeline was not built", effect.name);
+			continue;
+		}
+		if (specIds[0] == ~0u || specIds[1] == ~0u) {
+			spdlog::info("Skipping \"{}\": workgroup size is not specialization constant", effect.name);
+			continue;
+		}
+
+		float bestTime = std::numeric_limits<float>::max();
+		uint32_t best[2] = {0, 0};
+
+		for (auto &shape : WORKGROUP_SHAPES) {
+			uint32_t x = shape[0];
+			uint32_t y = shape[1];
+			if (x * y > limits.maxComputeWorkGroupInvocations || x > limits.maxComputeWorkGroupSize[0] || y > limits.maxComputeWorkGroupSize[1]) {
+				continue;
+			}
+
+			// other constants keep values that effect normally runs with
+			std::map<uint32_t, uint32_t> specOverrides = GetSpecOverrides(effect, effect.specValues);
+			specOverrides[specIds[0]] = x;
+			specOverrides[specIds[1]] = y;
+
+			EffectBuild build{};
+			build.effectIndex = i;
+			build.pipeline = VK_NULL_HANDLE;
+			build.generation = effect.buildGeneration;
+			build.variant = true;
+			build.spirv = effect.spirv;
+
+			if (!CreateComputePipeline(specOverrides, build)) {
+				spdlog::warn("  {:>3}x{:<3} failed: {}", x, y, build.error);
+				continue;
+			}
+
+			float ms = MeasureDispatch(effect, build.pipeline, x, y, queryPool, limits.timestampPeriod);
+			vkDestroyPipeline(m_device, build.pipeline, nullptr);
+
+			spdlog::info("  {:>3}x{:<3} {:.3f}ms", x, y, ms);
+			if (ms < bestTime) {
+				bestTime = ms;
+				best[0] = x;
+				best[1] = y;
+			}
+		}
+
+		if (best[0] == 0) {
+			continue;
+		}
+
+		spdlog::info("Effect \"{}\": best workgroup size {}x{} ({:.3f}ms)", effect.name, best[0], best[1], bestTime);
+		m_workgroupTuning.Set(effect.name, best[0], best[1]);
+	}
+
+	vkDestroyQueryPool(m_device, queryPool, nullptr);
 
-				if (e.key.keysym.scancode == SDL_SCANCODE_SPACE) {
-					m_showImgui = !m_showImgui;
+	if (!m_workgroupTuning.Save()) {
+		spdlog::error("failed to save workgroup sizes to {}", m_config.workgroupSizesPath);
+	}
+}
+
+
+float VulkanEngine::MeasureDispatch(ComputeEffect &effect, VkPipeline pipeline, uint32_t localSizeX, uint32_t localSizeY, VkQueryPool queryPool, float timestampPeriod) {
+	const uint32_t warmupDispatches = 4;   // first dispatches include cache misses and clock ramp up
+	const uint32_t timedDispatches = 32;
+	const uint32_t repeats = 3;            // best of few runs, so other work on device does not spoil result
+
+	uint32_t groupsX = (m_renderExtent.width + localSizeX - 1) / localSizeX;
+	uint32_t groupsY = (m_renderExtent.height + localSizeY - 1) / localSizeY;
+
+	// dispatches write same image, so they run one after another like real frames
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+
+	VkDependencyInfo dependency{};
+	dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency.memoryBarrierCount = 1;
+	dependency.pMemoryBarriers = &barrier;
+
+	float best = std::numeric_limits<float>::max();
+	for (uint32_t r = 0; r != repeats; ++r) {
+		ImmediateSubmit([&](VkCommandBuffer cmd) {
+			vkCmdResetQueryPool(cmd, queryPool, 0, 2);
+			m_barriers.Transition(m_renderImage.image, ImageUsage::ComputeStorage, true);
+			m_barriers.Flush(cmd);
+			// previous submit was waited, and blocks of installed effect fit in empty part, so they always get address
+			m_parameterRing.BeginFrame(0);
+			BindComputeEffect(cmd, effect, pipeline, m_renderImageDescriptors);
+
+			for (uint32_t d = 0; d != warmupDispatches + timedDispatches; ++d) {
+				if (d == warmupDispatches) {
+					vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 0);
 				}
+				vkCmdDispatch(cmd, groupsX, groupsY, 1);
+				vkCmdPipelineBarrier2(cmd, &dependency);
 			}
 
-			if (e.type == SDL_MOUSEMOTION) {
-				SDL_GetMouseState(&m_mouseX, &m_mouseY);
+			vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 1);
+		});
+
+		uint64_t timestamps[2];
+		VK_CHECK(vkGetQueryPoolResults(m_device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+		// timestamps are in device ticks, period is nanoseconds per tick
+		float ms = static_cast<float>(timestamps[1] - timestamps[0]) * timestampPeriod / 1e6f / timedDispatches;
+		best = std::min(best, ms);
+	}
+	return best;
+}
+
+
+// workgroup size of pipeline with given specialization values
+static void GetLocalSize(const ComputeEffect &effect, const std::vector<uint32_t> &values, uint32_t localSize[3]) {
+	const ShaderReflection &reflection = effect.reflection;
+	for (int i = 0; i != 3; ++i) {
+		localSize[i] = reflection.localSize[i];
+		for (size_t c = 0; c < values.size() && c < reflection.specConstants.size(); ++c) {
+			if (reflection.specConstants[c].id == reflection.localSizeSpecIds[i]) {
+				localSize[i] = std::max(values[c], 1u);
 			}
+		}
+	}
+}
 
-			// send SDL event to imgui for handling
-			ImGui_ImplSDL2_ProcessEvent(&e);
+
+static bool IsLocalSizeConstant(const ShaderReflection &reflection, uint32_t id) {
+	return std::find(std::begin(reflection.localSizeSpecIds), std::end(reflection.localSizeSpecIds), id) != std::end(reflection.localSizeSpecIds);
+}
+
+
+// variant name for overlay, for example "OCTAVES=6 DETAIL=true" (text lives until end of frame)
+static const char *FormatSpecValues(FrameArena &arena, const ComputeEffect &effect, const std::vector<uint32_t> &values) {
+	const size_t capacity = 256;
+	char *text = arena.Allocate<char>(capacity);
+	char *end = text;
+	char *last = text + capacity - 1;  // room for terminator
+
+	for (size_t i = 0; i < values.size() && i < effect.reflection.specConstants.size() && end != last; ++i) {
+		const SpecializationConstant &constant = effect.reflection.specConstants[i];
+		if (end != text) {
+			*end++ = ' ';
 		}
 
-		if (m_stopRendering) {
-            // throttle the speed to avoid the endless spinning
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
-        }
+		float floatValue;
+		std::memcpy(&floatValue, &values[i], sizeof(floatValue));
 
-		if (m_resizeRequested) {
-			RecreateSwapChain();
+		size_t room = last - end;
+		switch (constant.scalar) {
+			case ReflectedScalar::Bool:  end = fmt::format_to_n(end, room, "{}={}", constant.name, values[i] != 0).out; break;
+			case ReflectedScalar::Float: end = fmt::format_to_n(end, room, "{}={:.2f}", constant.name, floatValue).out; break;
+			case ReflectedScalar::Int:   end = fmt::format_to_n(end, room, "{}={}", constant.name, static_cast<int32_t>(values[i])).out; break;
+			default:                     end = fmt::format_to_n(end, room, "{}={}", constant.name, values[i]).out; break;
 		}
+	}
+	*end = '\0';
+	return text;
+}
 
-		UpdateTime();
-		AddImguiWindows();
 
-        Draw();
+// edits member of raw parameter bytes, arrays get control per element
+static void DrawParameterControl(const PushConstantMember &member, std::vector<uint8_t> &data) {
+	if (member.offset + member.size > data.size()) {
+		return;
+	}
+
+	for (uint32_t i = 0; i != member.count; ++i) {
+		void *value = data.data() + member.offset + i * member.stride;
+
+		// label is formatted on stack, overlay runs every frame
+		char label[128];
+		if (member.count > 1) {
+			*fmt::format_to_n(label, sizeof(label) - 1, "{}[{}]", member.name, i).out = '\0';
+		} else {
+			*fmt::format_to_n(label, sizeof(label) - 1, "{}", member.name).out = '\0';
+		}
+
+		if (member.scalar == ReflectedScalar::Float && member.components == 4) {
+			ImGui::ColorEdit4(label, static_cast<float*>(value));
+		} else if (member.scalar == ReflectedScalar::Float && member.components > 0) {
+			ImGui::DragScalarN(label, ImGuiDataType_Float, value, member.components, 0.01f);
+		} else if (member.scalar == ReflectedScalar::Int && member.components > 0) {
+			ImGui::DragScalarN(label, ImGuiDataType_S32, value, member.components);
+		} else if (member.scalar == ReflectedScalar::Uint && member.components > 0) {
+			ImGui::DragScalarN(label, ImGuiDataType_U32, value, member.components);
+		} else {
+			ImGui::Text("%s (%u bytes)", member.name.c_str(), member.size);
+			return;
+		}
 	}
 }
 
@@ -592,15 +2604,195 @@ void VulkanEngine::AddImguiWindows() {
 
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
 
-		ImGui::Text(effect.name.c_str());
+		// gpu time of frame phases over last frames (framerate above is capped by present)
+		if (m_gpuProfiler.IsEnabled() && ImGui::BeginTable("GPU time", 4)) {
+			ImGui::TableSetupColumn("GPU ms");
+			ImGui::TableSetupColumn("min");
+			ImGui::TableSetupColumn("avg");
+			ImGui::TableSetupColumn("p99");
+			ImGui::TableHeadersRow();
+
+			for (uint32_t p = 0; p != static_cast<uint32_t>(GpuPhase::Count); ++p) {
+				GpuPhaseStats stats = m_gpuProfiler.GetStats(static_cast<GpuPhase>(p));
+				if (stats.samples == 0) {
+					continue;
+				}
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(GpuProfiler::PhaseName(static_cast<GpuPhase>(p)));
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.minMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.avgMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.p99Ms);
+			}
+			ImGui::EndTable();
+		}
+
+		if (effect.pipeline == VK_NULL_HANDLE && effect.compileError.empty()) {
+			ImGui::Text("%s (compiling...)", effect.name.c_str());
+		} else {
+			ImGui::Text("%s", effect.name.c_str());
+		}
+
+		if (!effect.compileError.empty()) {
+			ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+			ImGui::TextWrapped("%s", effect.compileError.c_str());
+			ImGui::PopStyleColor();
+		}
+
+		if (ImGui::SliderInt("Effect Index", &m_currentComputeEffect, 0, m_computeEffects.size() - 1)) {
+			// move selected effect to the front of build queue
+			if (m_computeEffects[m_currentComputeEffect].pipeline == VK_NULL_HANDLE) {
+				RequestComputeEffect(m_currentComputeEffect, true);
+			}
+		}
+
+		if (m_pendingBuilds > 0) {
+			ImGui::Text("Building pipelines: %u left", m_pendingBuilds);
+		}
+
+		ImGui::Text("Resolution %ux%u (render image %ux%u)", m_renderExtent.width, m_renderExtent.height, m_renderImage.imageExtent.width, m_renderImage.imageExtent.height);
+		ImGui::Text("Output: %s", m_directOutput ? "swapchain (direct)" : "render image + resolve");
+
+		// global sets and sets of current frame slot
+		const DescriptorAllocator::Stats &globalStats = m_globalDescriptorAllocator.GetStats();
+		const DescriptorAllocator::Stats &frameStats = m_frameDescriptors[m_frameNumber % m_framesInFlight].GetStats();
+		ImGui::Text("Descriptor sets: %u/%u in %u pools, frame %u/%u (%u pools grown)", globalStats.sets, globalStats.capacity, globalStats.pools,
+			frameStats.sets, frameStats.capacity, globalStats.grown + frameStats.grown);
+
+		const ReadbackRing::Stats readbackStats = m_readback.GetStats();
+		ImGui::Text("Readback: %u buffers, %u pending, %llu delivered, %llu dropped", readbackStats.buffers, readbackStats.pending,
+			static_cast<unsigned long long>(readbackStats.delivered), static_cast<unsigned long long>(readbackStats.dropped));
+		if (m_recorder.IsRecording()) {
+			const FrameRecorder::Stats recordStats = m_recorder.GetStats();
+			ImGui::Text("Recording: convert %u/%u, write %u/%u, %llu written, %llu dropped, %llu late", recordStats.convertQueued, recordStats.queueCapacity,
+				recordStats.writeQueued, recordStats.queueCapacity, static_cast<unsigned long long>(recordStats.written),
+				static_cast<unsigned long long>(recordStats.dropped), static_cast<unsigned long long>(recordStats.late));
+		}
+		if (m_frameWriter.IsInitialized()) {
+			const FrameWriter::Stats writeStats = m_frameWriter.GetStats();
+			ImGui::Text("Frame writer: %s%s, %u/%u in flight, %llu files, %llu failed", WriteBackendName(m_frameWriter.GetBackend()),
+				m_frameWriter.IsDirect() ? " (direct)" : "", writeStats.inFlight, writeStats.capacity,
+				static_cast<unsigned long long>(writeStats.files), static_cast<unsigned long long>(writeStats.failed));
+		}
+
+		// heap allocations of main thread, steady state frames should not have any
+		ImGui::Text("CPU allocations: %u last frame, %u frames allocated (peak %u), arena %zu/%zu KiB", m_frameAllocations, m_allocatingFrames,
+			m_peakFrameAllocations, m_frameArena.GetPeakUsed() / 1024, m_frameArena.GetCapacity() / 1024);
+		if (m_computeQueue != VK_NULL_HANDLE) {
+			bool async = !m_directOutput && CanRunAsync(m_computeEffects[m_displayedComputeEffect]);
+			ImGui::Text("Dispatch: %s", async ? "async compute queue" : "graphics queue");
+		}
+
+		// latency against throughput, applied between frames
+		int framesInFlight = static_cast<int>(m_framesInFlight);
+		int pacing = static_cast<int>(m_framePacing);
+		bool pacingChanged = ImGui::SliderInt("Frames in flight", &framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+		pacingChanged |= ImGui::Combo("Frame pacing", &pacing, "timeline\0fence\0");
+		if (pacingChanged) {
+			SetFramePacing(static_cast<FramePacing>(pacing), static_cast<uint32_t>(framesInFlight));
+		}
+		if (m_gpuProfiler.IsEnabled()) {
+			ImGui::SliderFloat("Frame budget (ms)", &m_config.frameBudgetMs, 0.0f, 33.0f, m_config.frameBudgetMs > 0.0f ? "%.1f" : "off");
+		}
+
+		// controls for push constant members that engine does not fill
+		for (auto &member : effect.reflection.pushConstants) {
+			bool engineInput = std::any_of(effect.inputs.begin(), effect.inputs.end(), [&](const EngineInputSlot &slot) { return slot.offset == member.offset; });
+			bool blockAddress = std::any_of(effect.reflection.parameterBlocks.begin(), effect.reflection.parameterBlocks.end(), [&](const ParameterBlock &block) { return block.offset == member.offset; });
+			bool handle = GetBindlessHandle(effect.reflection, member) != BindlessHandle::None;
+			if (!engineInput && !blockAddress && !handle) {
+				DrawParameterControl(member, effect.pushData);
+			}
+		}
+
+		// parameter blocks, one tree node each
+		for (size_t b = 0; b != effect.parameterData.size(); ++b) {
+			const ParameterBlock &block = effect.reflection.parameterBlocks[b];
+			if (ImGui::TreeNode(block.name.c_str(), "%s (%u bytes)", block.name.c_str(), block.size)) {
+				for (auto &member : block.members) {
+					DrawParameterControl(member, effect.parameterData[b]);
+				}
+				ImGui::TreePop();
+			}
+		}
+
+		// specialization constants, every combination of values is its own pipeline
+		if (!effect.reflection.specConstants.empty() && effect.specValues.size() == effect.reflection.specConstants.size()) {
+			ImGui::Separator();
+
+			// edited copy of values is frame data, vector is made only when variant changes
+			size_t valueCount = effect.specValues.size();
+			uint32_t *values = m_frameArena.Allocate<uint32_t>(valueCount);
+			std::copy(effect.specValues.begin(), effect.specValues.end(), values);
+			bool changed = false;
+			const uint32_t step = 1;
+			const uint32_t stepFast = 10;
+
+			uint32_t localSize[3];
+			GetLocalSize(effect, effect.activeValues, localSize);
+			ImGui::Text("Workgroup size %ux%ux%u", localSize[0], localSize[1], localSize[2]);
+
+			for (size_t i = 0; i != valueCount; ++i) {
+				const SpecializationConstant &constant = effect.reflection.specConstants[i];
+				const char *label = constant.name.c_str();
+				if (IsLocalSizeConstant(effect.reflection, constant.id)) {
+					continue;  // chosen by autotune
+				}
+
+				// values are applied on enter or step buttons, so typing does not build a variant per key
+				switch (constant.scalar) {
+					case ReflectedScalar::Bool: {
+						bool value = values[i] != 0;
+						if (ImGui::Checkbox(label, &value)) {
+							values[i] = value ? 1 : 0;
+							changed = true;
+						}
+						break;
+					}
+					case ReflectedScalar::Float: {
+						float value;
+						std::memcpy(&value, &values[i], sizeof(value));
+						if (ImGui::InputFloat(label, &value, 0.1f, 1.0f, "%.2f", ImGuiInputTextFlags_EnterReturnsTrue)) {
+							std::memcpy(&values[i], &value, sizeof(value));
+							changed = true;
+						}
+						break;
+					}
+					case ReflectedScalar::Int:
+						changed |= ImGui::InputScalar(label, ImGuiDataType_S32, &values[i], &step, &stepFast, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+						break;
+					default:
+						changed |= ImGui::InputScalar(label, ImGuiDataType_U32, &values[i], &step, &stepFast, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+						break;
+				}
+			}
+
+			if (changed) {
+				SelectEffectVariant(m_currentComputeEffect, std::vector<uint32_t>(values, values + valueCount));
+			}
+
+			if (!effect.variantsBuilding.empty()) {
+				ImGui::Text("Building %zu variants...", effect.variantsBuilding.size());
+			}
 
-		ImGui::SliderInt("Effect Index", &m_currentComputeEffect, 0, m_computeEffects.size() - 1);
+			// variants that are already built can be switched without waiting
+			if (effect.variants.size() > 1 && ImGui::BeginCombo("Variants", FormatSpecValues(m_frameArena, effect, effect.specValues))) {
+				const std::vector<uint32_t> *selected = nullptr;
+				for (auto &[variantValues, pipeline] : effect.variants) {
+					if (ImGui::Selectable(FormatSpecValues(m_frameArena, effect, variantValues), variantValues == effect.specValues)) {
+						selected = &variantValues;
+					}
+				}
+				ImGui::EndCombo();
 
-		ImGui::ColorEdit4("data 2", (float*)&effect.data.data2);
-		ImGui::ColorEdit4("data 3", (float*)&effect.data.data3);
-		ImGui::ColorEdit4("data 4", (float*)&effect.data.data4);
+				if (selected) {
+					SelectEffectVariant(m_currentComputeEffect, *selected);
+				}
+			}
+		}
 
 		ImGui::Text("Press F11 for fullscreen mode");
+		ImGui::Text("Press F12 to save screenshot to %s", m_config.outputDir.c_str());
 		ImGui::Text("Press SPACE to hide this window");
 	}
 	ImGui::End();
@@ -620,96 +2812,176 @@ void VulkanEngine::UpdateTime() {
 }
 
 
+void VulkanEngine::UpdateDynamicResolution() {
+	if (m_config.frameBudgetMs <= 0.0f) {
+		m_dynamicScale = 1.0f;
+		return;
+	}
+
+	// timings arrive one or two frames late, every frame is used once
+	uint32_t frame;
+	float gpuMs = m_gpuProfiler.GetLatestFrameMs(frame);
+	if (gpuMs <= 0.0f || frame == m_lastScaledFrame) {
+		return;
+	}
+	m_lastScaledFrame = frame;
+
+	// cost grows with pixel count, that is with square of scale
+	// controller moves only part of the way, so noise and late timings do not make it oscillate
+	float target = m_dynamicScale * std::sqrt(m_config.frameBudgetMs / gpuMs);
+	m_dynamicScale = std::clamp(m_dynamicScale + (target - m_dynamicScale) * 0.2f, m_config.minRenderScale, 1.0f);
+}
+
+
 void VulkanEngine::Draw() {
-	// wait untill gpu has finished rendering the last frame
-	// we can wait no more than 1 second
-	VK_CHECK(vkWaitForFences(m_device, 1, &GetCurrentFrame().renderFence, true, 1000000000));
+	FrameData &frame = GetCurrentFrame();
 
-	// delete per frame objects from previous frame
-	GetCurrentFrame().deletionQueue.flush();
+	// wait untill gpu has finished frame that used this slot last time
+	WaitForFrame(frame);
 
-	// reset fence so that we can wait for it in next frame
-	VK_CHECK(vkResetFences(m_device, 1, &GetCurrentFrame().renderFence));
+	// delete objects that no unfinished frame can use
+	uint64_t completedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_frameTimeline, &completedValue));
+	m_retiredObjects.Flush(completedValue);
 
-	// get image index from swapchain
-	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(m_device, m_swapChain, 1000000000, GetCurrentFrame().swapchainSemaphore, nullptr, &imageIndex);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		m_resizeRequested = true;
+	// pick up pipelines that were built in background
+	InstallFinishedPipelines();
+
+	// copies of finished frames go to their consumers (headless output, screenshots), written raw files give their buffers back
+	m_readback.Poll(completedValue);
+	m_frameWriter.Poll(false);
+
+	// reset fence so that we can wait for it in next frame
+	VkFence submitFence = VK_NULL_HANDLE;
+	if (m_framePacing == FramePacing::Fence) {
+		VK_CHECK(vkResetFences(m_device, 1, &frame.renderFence));
+		submitFence = frame.renderFence;
+	}
+	frame.timelineValue = ++m_submittedValue;
+	uint32_t frameSlot = m_frameNumber % m_framesInFlight;
+	m_parameterRing.BeginFrame(frameSlot);
+	m_frameDescriptors[frameSlot].ClearPools(m_device);
+
+	// keep showing previous effect until selected one is built
+	if (m_computeEffects[m_currentComputeEffect].pipeline != VK_NULL_HANDLE && m_displayedComputeEffect != m_currentComputeEffect) {
+		m_displayedComputeEffect = m_currentComputeEffect;
+		RestartSteadyState();
 	}
+	ComputeEffect &effect = m_computeEffects[m_displayedComputeEffect];
 
-	// reset command buffer (copy because it is just pointer)
-	VkCommandBuffer commandBuffer = GetCurrentFrame().mainCommandBuffer;
-	VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
+	// configure render image extent (compute pass can use only part of it)
+	m_renderExtent = GetRenderExtent(effect);
 
-	// begin recording
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &cmdBeginInfo));
+	// frame that is read back renders to render image on graphics queue and is recorded as usual
+	uint32_t readbackConsumers = GetReadbackConsumers();
+	if (readbackConsumers & m_screenshotConsumer) {
+		m_screenshotRequested = false;
+	}
 
-	// configure render image extent
-	m_renderExtent.width = m_renderImage.imageExtent.width;
-	m_renderExtent.height = m_renderImage.imageExtent.height;
+	// effect writes swapchain image itself when nothing has to be scaled, so there is no copy at all
+	m_directOutput = !m_config.headless && readbackConsumers == 0 && CanWriteSwapChain(effect);
 
-	// transition render image to writable layout
-	// we dont care about previous layout
-	vkutils::TransitionImageLayout(commandBuffer, m_renderImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+	// recording and submit are timed for benchmark (waits for fence and swapchain are not included)
+	auto submitStart = std::chrono::high_resolution_clock::now();
 
+	// prerecorded frame is one command buffer on graphics queue
+	bool prerecorded = readbackConsumers == 0 && CanPrerecord(effect);
 
+	// dispatch is submitted to compute queue before acquire, so it runs while graphics queue presents previous frame
+	// render targets alternate, so dispatch does not wait for resolve of previous frame
+	bool asyncCompute = !prerecorded && !m_directOutput && readbackConsumers == 0 && CanRunAsync(effect);
+	uint32_t target = 0;
+	if (asyncCompute) {
+		m_asyncTarget ^= 1;
+		target = m_asyncTarget;
+		SubmitAsyncCompute(frame, effect, frameSlot, target);
+	}
+	float computeSubmitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
 
-	// use compute shader pipeline
-	ComputeEffect &effect = m_computeEffects[m_currentComputeEffect];
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
+	// get image index from swapchain
+	uint32_t imageIndex = 0;
+	if (!m_config.headless) {
+		VkResult result = vkAcquireNextImageKHR(m_device, m_swapChain, 1000000000, frame.swapchainSemaphore, nullptr, &imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+			m_resizeRequested = true;
+		}
+	}
 
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.layout, 0, 1, &m_renderImageDescriptors, 0, nullptr);
+	submitStart = std::chrono::high_resolution_clock::now();
 
-	// push constants
-	effect.data.data1.x = m_totalTime;                                                                          // total time in seconds
-	effect.data.data1.y = static_cast<float>(m_swapChainExtent.width) / m_swapChainExtent.height;               // aspect ratio of window
-	effect.data.data1.z = std::clamp(static_cast<float>(m_mouseX) / m_windowExtent.width, 0.0f, 1.0f);          // mouse position x
-	effect.data.data1.w = std::clamp(1.0f - static_cast<float>(m_mouseY) / m_windowExtent.height, 0.0f, 1.0f);  // mouse position y
-	vkCmdPushConstants(commandBuffer, effect.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &effect.data);
+	// compute has to wait for acquire too when it writes swapchain image
+	VkPipelineStageFlags2 waitStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	if (m_directOutput) {
+		waitStage |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	}
 
-	// execute command pipeline
-	vkCmdDispatch(commandBuffer, std::ceil(m_renderExtent.width / 16.0), std::ceil(m_renderExtent.height / 16.0), 1);
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (prerecorded) {
+		commandBuffer = GetRecordedFrame(frame, effect, imageIndex, frameSlot, waitStage);
+	}
+	if (commandBuffer == VK_NULL_HANDLE) {
+		// reset command buffer (copy because it is just pointer)
+		commandBuffer = frame.mainCommandBuffer;
+		VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
 
+		// begin recording
+		VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &cmdBeginInfo));
 
+		RecordFrame(commandBuffer, effect, imageIndex, frameSlot, waitStage, asyncCompute, target, false, readbackConsumers);
 
-	// transition render image and swapchain image to correct layouts for transfer
-	vkutils::TransitionImageLayout(commandBuffer, m_renderImage.image,           VK_IMAGE_LAYOUT_GENERAL,   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	vkutils::TransitionImageLayout(commandBuffer, m_swapChainImages[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		// end recording
+		VK_CHECK(vkEndCommandBuffer(commandBuffer));
+	}
 
-	// copy render image to swapchain image
-	vkutils::CopyImageToImage(commandBuffer, m_renderImage.image, m_swapChainImages[imageIndex], m_renderExtent, m_swapChainExtent);
+	if (m_config.headless) {
+		VkCommandBufferSubmitInfo cmdInfo = vkinit::CommandBufferSubmitInfo(commandBuffer);
+		VkSemaphoreSubmitInfo timelineInfo = vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_frameTimeline);
+		timelineInfo.value = frame.timelineValue;
 
+		VkSubmitInfo2 submit = vkinit::SubmitInfo(&cmdInfo, &timelineInfo, nullptr);
+		VK_CHECK(vkQueueSubmit2(m_graphicsQueue, 1, &submit, submitFence));
+		m_cpuSubmitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
 
-	// transition swapchain image layout to render to it
-	vkutils::TransitionImageLayout(commandBuffer, m_swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	if (m_showImgui) {
-		// draw imgui into swapchain image
-		DrawImgui(commandBuffer, m_swapChainImageViews[imageIndex]);
+		EndFrameAllocations();
+		m_frameNumber++;
+		return;
 	}
-	// transition swap chain image to presentable layout
-	vkutils::TransitionImageLayout(commandBuffer, m_swapChainImages[imageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-
-	// end recording
-	VK_CHECK(vkEndCommandBuffer(commandBuffer));
+	// resolve of this frame samples render target
+	if (!m_directOutput) {
+		m_renderTargetLastUse[target] = frame.timelineValue;
+	}
 
 	// submit command buffer to queue
 	VkCommandBufferSubmitInfo cmdInfo = vkinit::CommandBufferSubmitInfo(commandBuffer);
 
-	VkSemaphoreSubmitInfo waitInfo = vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, GetCurrentFrame().swapchainSemaphore);
-	VkSemaphoreSubmitInfo signalInfo = vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame().renderSemaphore);
+	// present barrier has no destination stage, so semaphore covers all commands (last one can be compute)
+	// async frame also waits for its dispatch before resolve
+	VkSemaphoreSubmitInfo waitInfos[2] = {
+		vkinit::SemaphoreSubmitInfo(waitStage, frame.swapchainSemaphore),
+		vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, m_computeTimeline),
+	};
+	waitInfos[1].value = frame.timelineValue;
+
+	VkSemaphoreSubmitInfo signalInfos[2] = {
+		vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.renderSemaphore),
+		vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_frameTimeline),
+	};
+	signalInfos[1].value = frame.timelineValue;
 
-	VkSubmitInfo2 submit = vkinit::SubmitInfo(&cmdInfo, &signalInfo, &waitInfo);
-	VK_CHECK(vkQueueSubmit2(m_graphicsQueue, 1, &submit, GetCurrentFrame().renderFence));
+	VkSubmitInfo2 submit = vkinit::SubmitInfo(&cmdInfo, signalInfos, waitInfos);
+	submit.signalSemaphoreInfoCount = 2;
+	submit.waitSemaphoreInfoCount = asyncCompute ? 2 : 1;
+	VK_CHECK(vkQueueSubmit2(m_graphicsQueue, 1, &submit, submitFence));
+	m_cpuSubmitMs = computeSubmitMs + std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
 
 	// present rendered image
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.pSwapchains = &m_swapChain;
 	presentInfo.swapchainCount = 1;
-	presentInfo.pWaitSemaphores = &GetCurrentFrame().renderSemaphore;
+	presentInfo.pWaitSemaphores = &frame.renderSemaphore;
 	presentInfo.waitSemaphoreCount = 1;
 	presentInfo.pImageIndices = &imageIndex;
 
@@ -719,5 +2991,412 @@ void VulkanEngine::Draw() {
 	}
 
 	// increase number of frames
+	EndFrameAllocations();
 	m_frameNumber++;
+}
+
+
+// commands of one frame on graphics queue, from compute (unless it runs on compute queue) to present barrier
+// recorded frames read effect parameters from buffer, so command buffer can be submitted again
+void VulkanEngine::RecordFrame(VkCommandBuffer commandBuffer, ComputeEffect &effect, uint32_t imageIndex, uint32_t frameSlot, VkPipelineStageFlags2 waitStage, bool asyncCompute, uint32_t target, bool recorded, uint32_t readbackConsumers) {
+	const AllocatedImage &renderTarget = target == 0 ? m_renderImage : m_asyncRenderImage;
+
+	// timings of previous frame in this slot are ready, because its fence was waited
+	// (async frame did this before recording compute command buffer)
+	if (!asyncCompute) {
+		m_gpuProfiler.BeginFrame(frameSlot, m_frameNumber);
+	}
+
+	// acquired image has no contents, its first barrier waits for stage where acquire semaphore is waited
+	VkImage swapChainImage = m_config.headless ? VK_NULL_HANDLE : m_swapChainImages[imageIndex];
+	if (!m_config.headless) {
+		m_barriers.Track(swapChainImage, ImageUsage::Undefined, waitStage);
+	}
+
+	if (m_directOutput) {
+		m_barriers.Transition(swapChainImage, ImageUsage::ComputeStorage);
+		m_barriers.Flush(commandBuffer);
+		m_barriers.Check(swapChainImage, ImageUsage::ComputeStorage);
+
+		m_gpuProfiler.BeginPhase(commandBuffer, frameSlot, GpuPhase::Compute);
+		DrawCompute(commandBuffer, effect, m_swapChainDescriptors[imageIndex], recorded, frameSlot);
+		m_gpuProfiler.EndPhase(commandBuffer, frameSlot, GpuPhase::Compute);
+	} else if (asyncCompute) {
+		// compute queue wrote render target, semaphore wait before fragment stage orders it before resolve
+		m_barriers.Track(renderTarget.image, ImageUsage::ComputeStorage, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+	} else {
+		// previous contents are not needed, but previous frame can still be reading render image
+		m_barriers.Transition(m_renderImage.image, ImageUsage::ComputeStorage, true);
+		m_barriers.Flush(commandBuffer);
+		m_barriers.Check(m_renderImage.image, ImageUsage::ComputeStorage);
+
+		m_gpuProfiler.BeginPhase(commandBuffer, frameSlot, GpuPhase::Compute);
+		DrawCompute(commandBuffer, effect, m_renderImageDescriptors, recorded, frameSlot);
+		m_gpuProfiler.EndPhase(commandBuffer, frameSlot, GpuPhase::Compute);
+	}
+
+	// copy render image to staging buffer, consumers get it when frame is finished
+	// (frames with readback do not run async, so render target is render image)
+	if (readbackConsumers != 0) {
+		m_gpuProfiler.BeginPhase(commandBuffer, frameSlot, GpuPhase::Readback);
+		m_barriers.Transition(m_renderImage.image, ImageUsage::TransferSrc);
+		m_barriers.Flush(commandBuffer);
+		m_barriers.Check(m_renderImage.image, ImageUsage::TransferSrc);
+		m_readback.Record(commandBuffer, m_renderImage.image, m_renderImage.imageFormat, 4 * sizeof(uint16_t), m_renderExtent, m_frameNumber, m_frames[frameSlot].timelineValue, readbackConsumers);
+		m_gpuProfiler.EndPhase(commandBuffer, frameSlot, GpuPhase::Readback);
+	}
+
+	if (m_config.headless) {
+		return;
+	}
+
+	bool resolve = !m_directOutput;
+	if (resolve || m_showImgui) {
+		// render image is sampled by resolve pass, swapchain image is written only as color attachment
+		if (resolve) {
+			m_barriers.Transition(renderTarget.image, ImageUsage::FragmentSample);
+		}
+		m_barriers.Transition(swapChainImage, ImageUsage::ColorAttachment);
+		m_barriers.Flush(commandBuffer);
+
+		if (resolve) {
+			DrawPresentPass(commandBuffer, imageIndex, frameSlot, renderTarget.image, target == 0 ? m_resolveDescriptors : m_asyncResolveDescriptors);
+		} else {
+			DrawPresentPass(commandBuffer, imageIndex, frameSlot, VK_NULL_HANDLE, VK_NULL_HANDLE);
+		}
+	}
+
+	m_barriers.Transition(swapChainImage, ImageUsage::Present);
+	m_barriers.Flush(commandBuffer);
+}
+
+
+VkExtent2D VulkanEngine::GetRenderExtent(const ComputeEffect &effect) const {
+	VkExtent2D extent = {m_renderImage.imageExtent.width, m_renderImage.imageExtent.height};
+
+	// scaled resolution needs effect to know its size, effects that read imageSize() render whole image
+	bool knowsResolution = std::any_of(effect.inputs.begin(), effect.inputs.end(), [](const EngineInputSlot &slot) { return slot.input == EngineInput::Resolution; });
+	if (knowsResolution && m_dynamicScale < 1.0f) {
+		extent.width = std::max(static_cast<uint32_t>(extent.width * m_dynamicScale + 0.5f), 1u);
+		extent.height = std::max(static_cast<uint32_t>(extent.height * m_dynamicScale + 0.5f), 1u);
+	}
+	return extent;
+}
+
+
+bool VulkanEngine::CanWriteSwapChain(const ComputeEffect &effect) const {
+	// effects with their own descriptor sets have render image in them
+	if (!m_swapChainStorage || effect.pipeline == VK_NULL_HANDLE || !effect.resources.descriptorSets.empty()) {
+		return false;
+	}
+
+	// output is copied 1:1, scaling needs resolve pass
+	if (m_renderExtent.width != m_swapChainExtent.width || m_renderExtent.height != m_swapChainExtent.height) {
+		return false;
+	}
+
+	// swapchain format differs from render image, so shader must not declare format of output image
+	return std::none_of(effect.reflection.bindings.begin(), effect.reflection.bindings.end(), [](const DescriptorBinding &binding) {
+		return IsRenderImageBinding(binding) && binding.imageFormat != VK_FORMAT_UNDEFINED;
+	});
+}
+
+
+
+bool VulkanEngine::CanRunAsync(const ComputeEffect &effect) const {
+	// effects with own descriptor sets have render image (target 0) in them, own images are not shared with compute queue
+	return m_computeQueue != VK_NULL_HANDLE && effect.pipeline != VK_NULL_HANDLE && !HasResources(effect.resources);
+}
+
+
+void VulkanEngine::SubmitAsyncCompute(FrameData &frame, ComputeEffect &effect, uint32_t frameSlot, uint32_t target) {
+	const AllocatedImage &image = target == 0 ? m_renderImage : m_asyncRenderImage;
+
+	// profiler queries of slot are reset on host, so compute and graphics queue only write them
+	m_gpuProfiler.BeginFrame(frameSlot, m_frameNumber);
+
+	VkCommandBuffer cmd = frame.computeCommandBuffer;
+	VK_CHECK(vkResetCommandBuffer(cmd, 0));
+
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	// contents are not needed, frame that sampled image last time is waited by semaphore at compute stage
+	m_barriers.Track(image.image, ImageUsage::Undefined, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+	m_barriers.Transition(image.image, ImageUsage::ComputeStorage, true);
+	m_barriers.Flush(cmd);
+	m_barriers.Check(image.image, ImageUsage::ComputeStorage);
+
+	if (m_computeTimestamps) {
+		m_gpuProfiler.BeginPhase(cmd, frameSlot, GpuPhase::Compute);
+	}
+	DrawCompute(cmd, effect, target == 0 ? m_renderImageDescriptors : m_asyncRenderImageDescriptors);
+	if (m_computeTimestamps) {
+		m_gpuProfiler.EndPhase(cmd, frameSlot, GpuPhase::Compute);
+	}
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	VkCommandBufferSubmitInfo cmdInfo = vkinit::CommandBufferSubmitInfo(cmd);
+	VkSemaphoreSubmitInfo waitInfo = vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, m_frameTimeline);
+	waitInfo.value = m_renderTargetLastUse[target];
+	VkSemaphoreSubmitInfo signalInfo = vkinit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_computeTimeline);
+	signalInfo.value = frame.timelineValue;
+
+	VkSubmitInfo2 submit = vkinit::SubmitInfo(&cmdInfo, &signalInfo, m_renderTargetLastUse[target] > 0 ? &waitInfo : nullptr);
+	VK_CHECK(vkQueueSubmit2(m_computeQueue, 1, &submit, VK_NULL_HANDLE));
+}
+
+bool VulkanEngine::CanPrerecord(ComputeEffect &effect) {
+	// overlay changes every frame, so frames with it are recorded as usual
+	if (!m_config.prerecordedFrames || (!m_config.headless && m_showImgui) || effect.pipeline == VK_NULL_HANDLE) {
+		return false;
+	}
+	return PrepareRecordedPipeline(effect);
+}
+
+
+bool VulkanEngine::PrepareRecordedPipeline(ComputeEffect &effect) {
+	if (effect.recordedSource == effect.pipeline) {
+		return effect.recordedPipeline != VK_NULL_HANDLE;
+	}
+
+	// running pipeline changed (variant was selected), frames recorded with old copy are recorded again
+	RetireRecordedPipeline(effect);
+	effect.recordedSource = effect.pipeline;
+
+	if (effect.reflection.pushConstantSize == 0) {
+		effect.recordedPipeline = effect.pipeline;
+		effect.recordedLayout = effect.layout;
+		return true;
+	}
+
+	// uniform buffer has std140 layout, it places only scalars, vectors, buffer references
+	// and arrays with 16 byte stride at same offsets as push constants
+	for (auto &member : effect.reflection.pushConstants) {
+		bool blockAddress = std::any_of(effect.reflection.parameterBlocks.begin(), effect.reflection.parameterBlocks.end(), [&](const ParameterBlock &block) { return block.offset == member.offset; });
+		if (!blockAddress && (member.components == 0 || (member.count > 1 && member.stride % 16 != 0))) {
+			spdlog::info("Effect \"{}\" is recorded every frame: push constant \"{}\" has no std140 equivalent", effect.name, member.name);
+			return false;
+		}
+	}
+
+	uint32_t paramsSet = static_cast<uint32_t>(effect.setLayouts.size());
+	std::vector<uint32_t> spirv;
+	std::string error;
+	if (!vkutils::PushConstantsToUniformBuffer(*effect.spirv, paramsSet, 0, spirv, error)) {
+		spdlog::error("Effect \"{}\" is recorded every frame: {}", effect.name, error);
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts = effect.setLayouts;
+	setLayouts.push_back(m_paramsDescriptorLayout);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.pSetLayouts = setLayouts.data();
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	VK_CHECK(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &effect.recordedLayout));
+
+	effect.recordedPipeline = CreatePipeline(m_device, m_pipelineCache.Get(), spirv, effect.recordedLayout, effect.reflection, effect.activeValues, error);
+	if (effect.recordedPipeline == VK_NULL_HANDLE) {
+		spdlog::error("Effect \"{}\" is recorded every frame: {}", effect.name, error);
+		vkDestroyPipelineLayout(m_device, effect.recordedLayout, nullptr);
+		effect.recordedLayout = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+
+void VulkanEngine::RetireRecordedPipeline(ComputeEffect &effect) {
+	// copy is owned by effect, running pipeline is not
+	if (effect.recordedPipeline != VK_NULL_HANDLE && effect.recordedPipeline != effect.recordedSource) {
+		RetireHandleAfterFrame(effect.recordedPipeline);
+		RetireHandleAfterFrame(effect.recordedLayout);
+	}
+
+	effect.recordedPipeline = VK_NULL_HANDLE;
+	effect.recordedLayout = VK_NULL_HANDLE;
+	effect.recordedSource = VK_NULL_HANDLE;
+	m_recordedGeneration++;
+}
+
+
+VkCommandBuffer VulkanEngine::GetRecordedFrame(FrameData &frame, ComputeEffect &effect, uint32_t imageIndex, uint32_t frameSlot, VkPipelineStageFlags2 waitStage) {
+	// parameters are the only thing that changes between submits
+	// without them frame is recorded as usual, so dispatch is skipped
+	if (!WriteFrameParams(effect, frameSlot)) {
+		return VK_NULL_HANDLE;
+	}
+
+	size_t imageCount = m_config.headless ? 1 : m_swapChainImages.size();
+	frame.recordedFrames.resize(m_computeEffects.size() * imageCount);
+	RecordedFrame &recorded = frame.recordedFrames[m_displayedComputeEffect * imageCount + imageIndex];
+
+	// recorded frame does not know what ran before it, so render image is waited for at all stages
+	m_barriers.Track(m_renderImage.image, ImageUsage::ComputeStorage, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+	bool valid = recorded.commandBuffer != VK_NULL_HANDLE && recorded.generation == m_recordedGeneration && recorded.directOutput == m_directOutput &&
+	             recorded.extent.width == m_renderExtent.width && recorded.extent.height == m_renderExtent.height;
+
+	if (valid) {
+		m_gpuProfiler.BeginRecordedFrame(frameSlot, m_frameNumber, recorded.gpuPhases);
+	} else {
+		// last submit of this slot is finished, so its command buffer can be recorded again
+		if (recorded.commandBuffer == VK_NULL_HANDLE) {
+			VkCommandBufferAllocateInfo commandBufferInfo = vkinit::CommandBufferAllocateInfo(frame.commandPool);
+			VK_CHECK(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &recorded.commandBuffer));
+		} else {
+			VK_CHECK(vkResetCommandBuffer(recorded.commandBuffer, 0));
+		}
+
+		VkCommandBufferBeginInfo cmdBeginInfo = vkinit::CommandBufferBeginInfo(0);
+		VK_CHECK(vkBeginCommandBuffer(recorded.commandBuffer, &cmdBeginInfo));
+		RecordFrame(recorded.commandBuffer, effect, imageIndex, frameSlot, waitStage, false, 0, true, 0);
+		VK_CHECK(vkEndCommandBuffer(recorded.commandBuffer));
+
+		recorded.generation = m_recordedGeneration;
+		recorded.directOutput = m_directOutput;
+		recorded.extent = m_renderExtent;
+		recorded.gpuPhases = m_gpuProfiler.GetWrittenPhases(frameSlot);
+	}
+
+	m_barriers.Track(m_renderImage.image, ImageUsage::ComputeStorage, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+	return recorded.commandBuffer;
+}
+
+
+bool VulkanEngine::WriteFrameParams(ComputeEffect &effect, uint32_t frameSlot) {
+	if (!UpdateEngineInputs(effect)) {
+		return false;
+	}
+	if (effect.pushData.empty()) {
+		return true;
+	}
+
+	// previous frame of this slot is finished, so its part of buffer is not read anymore
+	VkDeviceSize offset = frameSlot * m_paramsStride;
+	std::memcpy(static_cast<uint8_t*>(m_paramsBuffer.info.pMappedData) + offset, effect.pushData.data(), effect.pushData.size());
+	VK_CHECK(vmaFlushAllocation(m_allocator, m_paramsBuffer.allocation, offset, effect.pushData.size()));
+	return true;
+}
+
+
+void VulkanEngine::FreeRecordedFrames() {
+	for (auto &frame : m_frames) {
+		for (auto &recorded : frame.recordedFrames) {
+			if (recorded.commandBuffer != VK_NULL_HANDLE) {
+				vkFreeCommandBuffers(m_device, frame.commandPool, 1, &recorded.commandBuffer);
+			}
+		}
+		frame.recordedFrames.clear();
+	}
+}
+
+void VulkanEngine::DrawCompute(VkCommandBuffer commandBuffer, ComputeEffect &effect, VkDescriptorSet outputDescriptors, bool recorded, uint32_t frameSlot) {
+	if (effect.pipeline == VK_NULL_HANDLE) {
+		return;  // nothing was built yet
+	}
+
+	if (recorded) {
+		BindRecordedEffect(commandBuffer, effect, outputDescriptors, frameSlot);
+	} else if (!BindComputeEffect(commandBuffer, effect, effect.pipeline, outputDescriptors)) {
+		return;  // shader would read parameters through null address
+	}
+
+	// execute command pipeline, one invocation per pixel
+	uint32_t localSize[3];
+	GetLocalSize(effect, effect.activeValues, localSize);
+	vkCmdDispatch(commandBuffer, (m_renderExtent.width + localSize[0] - 1) / localSize[0], (m_renderExtent.height + localSize[1] - 1) / localSize[1], 1);
+}
+
+
+bool VulkanEngine::BindComputeEffect(VkCommandBuffer commandBuffer, ComputeEffect &effect, VkPipeline pipeline, VkDescriptorSet outputDescriptors) {
+	// use compute shader pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	BindEffectDescriptors(commandBuffer, effect, effect.layout, outputDescriptors);
+
+	// push constants
+	if (!UpdateEngineInputs(effect)) {
+		return false;
+	}
+	if (!effect.pushData.empty()) {
+		vkCmdPushConstants(commandBuffer, effect.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(effect.pushData.size()), effect.pushData.data());
+	}
+	return true;
+}
+
+
+void VulkanEngine::BindRecordedEffect(VkCommandBuffer commandBuffer, ComputeEffect &effect, VkDescriptorSet outputDescriptors, uint32_t frameSlot) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.recordedPipeline);
+
+	// same sets as running pipeline, parameter buffer is bound after them
+	BindEffectDescriptors(commandBuffer, effect, effect.recordedLayout, outputDescriptors);
+
+	if (effect.recordedPipeline != effect.recordedSource) {
+		uint32_t offset = static_cast<uint32_t>(frameSlot * m_paramsStride);
+		uint32_t paramsSet = static_cast<uint32_t>(effect.setLayouts.size());
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.recordedLayout, paramsSet, 1, &m_paramsDescriptors, 1, &offset);
+	}
+}
+
+
+void VulkanEngine::BindEffectDescriptors(VkCommandBuffer commandBuffer, ComputeEffect &effect, VkPipelineLayout layout, VkDescriptorSet outputDescriptors) {
+	// effects with their own resources have their own sets (render image and bindless table are in them too)
+	if (!effect.resources.descriptorSets.empty()) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, static_cast<uint32_t>(effect.resources.descriptorSets.size()), effect.resources.descriptorSets.data(), 0, nullptr);
+		return;
+	}
+
+	const std::vector<DescriptorBinding> &bindings = effect.reflection.bindings;
+	if (std::any_of(bindings.begin(), bindings.end(), IsRenderImageBinding)) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &outputDescriptors, 0, nullptr);
+	}
+	if (UsesBindlessTable(effect.reflection)) {
+		VkDescriptorSet table = m_bindless.GetSet();
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, BindlessTable::SET, 1, &table, 0, nullptr);
+	}
+}
+
+
+bool VulkanEngine::UpdateEngineInputs(ComputeEffect &effect) {
+	float time = m_totalTime;                                                                            // total time in seconds
+	float aspect = static_cast<float>(m_swapChainExtent.width) / m_swapChainExtent.height;               // aspect ratio of window
+	glm::vec2 mouse(std::clamp(static_cast<float>(m_mouseX) / m_windowExtent.width, 0.0f, 1.0f),         // mouse position
+	                std::clamp(1.0f - static_cast<float>(m_mouseY) / m_windowExtent.height, 0.0f, 1.0f));
+
+	for (auto &slot : effect.inputs) {
+		uint8_t *dst = effect.pushData.data() + slot.offset;
+		switch (slot.input) {
+			case EngineInput::Data1: {
+				glm::vec4 data1(time, aspect, mouse.x, mouse.y);
+				std::memcpy(dst, &data1, sizeof(data1));
+				break;
+			}
+			case EngineInput::Time:   std::memcpy(dst, &time, sizeof(time)); break;
+			case EngineInput::Aspect: std::memcpy(dst, &aspect, sizeof(aspect)); break;
+			case EngineInput::Mouse:  std::memcpy(dst, &mouse, sizeof(mouse)); break;
+			case EngineInput::Resolution: {
+				glm::vec2 resolution(m_renderExtent.width, m_renderExtent.height);
+				std::memcpy(dst, &resolution, sizeof(resolution));
+				break;
+			}
+		}
+	}
+
+	// parameter blocks are copied to ring, shader gets their addresses
+	// when ring part is full (other effects pushed in same frame), address of last frame is kept, its parameters are only older
+	bool addressed = true;
+	for (size_t b = 0; b != effect.parameterData.size(); ++b) {
+		const ParameterBlock &block = effect.reflection.parameterBlocks[b];
+		VkDeviceAddress address = m_parameterRing.Push(effect.parameterData[b].data(), effect.parameterData[b].size());
+		if (address != 0) {
+			std::memcpy(effect.pushData.data() + block.offset, &address, sizeof(address));
+			continue;
+		}
+		std::memcpy(&address, effect.pushData.data() + block.offset, sizeof(address));
+		addressed &= address != 0;
+	}
+	return addressed;
 }
\ No newline at end of file
@@ -2,31 +2,115 @@
 
 #include <vk-types.hpp>
 #include <vk-descriptors.hpp>
+#include <vk-barriers.hpp>
+#include <vk-config.hpp>
+#include <vk-pipeline-cache.hpp>
+#include <vk-gpu-profiler.hpp>
+#include <vk-benchmark.hpp>
+#include <vk-thread-pool.hpp>
+#include <vk-shader-watcher.hpp>
+#include <vk-workgroup-tuning.hpp>
+#include <vk-parameter-ring.hpp>
+#include <vk-bindless.hpp>
+#include <vk-deletion-queue.hpp>
+#include <vk-frame-memory.hpp>
+#include <vk-readback.hpp>
+#include <vk-recorder.hpp>
+#include <vk-exr.hpp>
+#include <vk-frame-writer.hpp>
 
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 
-const uint32_t FRAMES_IN_FLIGHT = 2;
 
 struct SDL_Window;
 
 namespace vr {
 	class VulkanEngine final {
 	public:
-		VulkanEngine();
+		explicit VulkanEngine(const EngineConfig &config = EngineConfig{});
 		~VulkanEngine();
 
-		void Run();
+		// returns process exit code
+		int Run();
+
+	private:
+		// pipeline building on worker threads
+		// finished pipelines are put into effects at frame boundary
+		struct EffectBuild {
+			size_t      effectIndex;
+			VkPipeline  pipeline;    // VK_NULL_HANDLE if build failed
+			uint32_t    generation;  // 0 for first build, hot reloads count up
+			bool        variant;     // other specialization of already installed code
+			std::string error;
+
+			std::shared_ptr<const std::vector<uint32_t>> spirv;
+			std::vector<uint32_t>                        specValues;
+			std::array<uint32_t, 2>                      tunedLocalSize = {0, 0};  // used if shader size is specialization constant
+
+			// interface of built shader
+			ShaderReflection                   reflection;
+			VkPipelineLayout                   layout = VK_NULL_HANDLE;
+			std::vector<VkDescriptorSetLayout> setLayouts;
+		};
+
+		// pipeline layout shared by effects with same interface
+		struct InterfaceLayout {
+			VkPipelineLayout                   layout;
+			std::vector<VkDescriptorSetLayout> setLayouts;  // one for every set index
+		};
 
 	private:
 		void Init();
 		void Draw();
+		void RecordFrame(VkCommandBuffer cmd, ComputeEffect &effect, uint32_t imageIndex, uint32_t frameSlot, VkPipelineStageFlags2 waitStage, bool asyncCompute, uint32_t target, bool recorded, uint32_t readbackConsumers);
+		void DrawCompute(VkCommandBuffer cmd, ComputeEffect &effect, VkDescriptorSet outputDescriptors, bool recorded = false, uint32_t frameSlot = 0);  // recorded reads parameters from buffer
+		void DrawPresentPass(VkCommandBuffer cmd, uint32_t imageIndex, uint32_t frameSlot, VkImage source, VkDescriptorSet sourceDescriptors);  // resolve (if source is given) and imgui in one rendering pass
+		VkExtent2D GetRenderExtent(const ComputeEffect &effect) const;
+		bool CanWriteSwapChain(const ComputeEffect &effect) const;
+		bool CanRunAsync(const ComputeEffect &effect) const;
+		void SubmitAsyncCompute(FrameData &frame, ComputeEffect &effect, uint32_t frameSlot, uint32_t target);
+
+		// prerecorded frames (see --prerecorded-frames)
+		bool CanPrerecord(ComputeEffect &effect);
+		bool PrepareRecordedPipeline(ComputeEffect &effect);  // creates pipeline that reads parameter buffer
+		void RetireRecordedPipeline(ComputeEffect &effect);
+		VkCommandBuffer GetRecordedFrame(FrameData &frame, ComputeEffect &effect, uint32_t imageIndex, uint32_t frameSlot, VkPipelineStageFlags2 waitStage);
+		bool WriteFrameParams(ComputeEffect &effect, uint32_t frameSlot);
+		void FreeRecordedFrames();  // device has to be idle
 		void Cleanup();
 
+		// heap allocations of frames (see --check-allocations)
+		void EndFrameAllocations();   // counts allocations of frame that ends and resets frame arena
+		void RestartSteadyState();    // frames right after change can allocate while containers grow, they are not checked
+		int  GetAllocationCheckResult() const;
+
+		// headless rendering (no window, frames are written to disk)
+		int  RunHeadless();
+
+		// render image copies to host (headless frames and screenshots)
+		void InitReadback();
+		uint32_t GetReadbackConsumers();  // consumers that want frame that is recorded now
+		void WriteFrameOutput(const ReadbackImage &image, const char *name);
+
+		// benchmark (every effect at every resolution, report is written to disk)
+		int RunBenchmark();
+		BenchmarkResult MeasureEffect(size_t effectIndex, uint32_t width, uint32_t height);
+
 		// sdl window creation
 		void CreateSDLWindow();
 
 		// vulkan initialization
 		void InitVulkan();
 		void InitSwapchain();
+		void CreateRenderImage(VkExtent3D extent);
+		void ResizeRenderImage(VkExtent3D extent);  // waits for device
+		VkExtent3D GetWindowRenderExtent() const;   // swapchain size times render scale
+		void UpdateDynamicResolution();
+		void UpdateRenderImageDescriptors();
+		void UpdateSwapChainDescriptors();
 		void CreateSwapChain(uint32_t width, uint32_t height);
 		void DestroySwapChain();
 		void RecreateSwapChain();
@@ -34,31 +118,86 @@ namespace vr {
 		void InitSyncStructures();
 
 		// frames in flight
-		FrameData &GetCurrentFrame() { return m_frames[m_frameNumber % FRAMES_IN_FLIGHT]; }
+		FrameData &GetCurrentFrame() { return m_frames[m_frameNumber % m_framesInFlight]; }
+		void WaitForFrame(FrameData &frame);
+		void SetFramePacing(FramePacing pacing, uint32_t framesInFlight);  // waits for device
+		// frame that is being recorded signals next value, object is destroyed when frames that can use it are finished
+		template<typename Handle>
+		void RetireHandleAfterFrame(const Handle &handle) { m_retiredObjects.Push(m_submittedValue + 1, handle); }
 
 		// descriptors
 		void InitDescriptors();
 
+		// render image to swapchain image (used when effect cannot write swapchain directly)
+		void InitResolvePass();
+
 		// pipelines
 		void InitPipelines();
+		void RequestComputeEffect(size_t effectIndex, bool urgent);
+		void BuildComputeEffect(size_t effectIndex, const std::string &shaderPath, std::array<uint32_t, 2> tunedLocalSize);  // runs on worker threads
+		bool CreateComputePipeline(const std::map<uint32_t, uint32_t> &specOverrides, EffectBuild &build);  // thread safe
+		bool DeclareOutputFormat(std::vector<uint32_t> &spirv, std::string &error) const;  // thread safe
+		bool GetInterfaceLayout(const ShaderReflection &reflection, InterfaceLayout &layout, std::string &error);  // thread safe
+		void InstallFinishedPipelines();
+		void InstallEffectInterface(ComputeEffect &effect, const EffectBuild &build);
+		void CreateEffectResources(ComputeEffect &effect);
+		void RetireEffectResources(ComputeEffect &effect);
+		void DestroyEffectResources(const EffectResources &resources);
+
+		// hot reload
+		void PollShaderChanges();
+		void ReloadComputeEffect(size_t effectIndex);
+		void CompileComputeEffect(size_t effectIndex, const std::string &sourcePath, const std::string &shaderPath, uint32_t generation, const std::map<uint32_t, uint32_t> &specOverrides, std::array<uint32_t, 2> tunedLocalSize);  // runs on worker threads
+
+		// specialization variants
+		std::map<uint32_t, uint32_t> GetSpecOverrides(const ComputeEffect &effect, const std::vector<uint32_t> &values) const;
+		void SelectEffectVariant(size_t effectIndex, const std::vector<uint32_t> &values);
+		void RetireEffectPipelines(ComputeEffect &effect);
+
+		// workgroup size autotune
+		std::array<uint32_t, 2> GetTunedLocalSize(const ComputeEffect &effect) const;
+		void RunAutotune();
+		float MeasureDispatch(ComputeEffect &effect, VkPipeline pipeline, uint32_t localSizeX, uint32_t localSizeY, VkQueryPool queryPool, float timestampPeriod);
+		bool BindComputeEffect(VkCommandBuffer cmd, ComputeEffect &effect, VkPipeline pipeline, VkDescriptorSet outputDescriptors);
+		void BindRecordedEffect(VkCommandBuffer cmd, ComputeEffect &effect, VkDescriptorSet outputDescriptors, uint32_t frameSlot);
+		void BindEffectDescriptors(VkCommandBuffer cmd, ComputeEffect &effect, VkPipelineLayout layout, VkDescriptorSet outputDescriptors);
+		bool UpdateEngineInputs(ComputeEffect &effect);  // false if some parameter block has no address
+		void DestroyComputeEffects();
 
 		// immediate command that are submitted outside of main render loop
 		void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)> &&function);
 
+		// buffers and images
+		AllocatedBuffer CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+		void DestroyBuffer(const AllocatedBuffer &buffer);
+		AllocatedImage CreateImage(VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, bool sharedWithCompute = false);
+		void DestroyImage(const AllocatedImage &image);
+
 		// imgui
 		void InitImgui();
 		void AddImguiWindows();
-		void DrawImgui(VkCommandBuffer cmd, VkImageView targetImageView);
 
 		// time
 		void UpdateTime();
 
 	private:
+		EngineConfig    m_config;
 		bool            m_isInitialized;
 		uint32_t        m_frameNumber;
 		bool            m_stopRendering;
 		VkExtent2D      m_windowExtent;
 
+		// cpu time of recording and submitting last frame
+		float m_cpuSubmitMs = 0;
+
+		// transient cpu data of frame and heap allocations of main thread per frame
+		FrameArena m_frameArena;
+		uint64_t   m_allocationCount = 0;       // allocations of thread at end of last frame
+		uint32_t   m_frameAllocations = 0;      // allocations of last frame
+		uint32_t   m_peakFrameAllocations = 0;  // most allocations of one steady state frame
+		uint32_t   m_steadyStateFrame = 0;      // first frame that is expected not to allocate
+		uint32_t   m_allocatingFrames = 0;      // steady state frames that allocated
+
 		// time
 		float m_totalTime = 0;
 		float m_lastFrameTime = 0;
@@ -83,13 +222,28 @@ namespace vr {
 		std::vector<VkImageView> m_swapChainImageViews;
 		VkExtent2D               m_swapChainExtent;
 		bool                     m_resizeRequested = false;
+		bool                     m_swapChainStorage = false;  // swapchain images can be written by compute
+		bool                     m_writeWithoutFormat = false;  // shaders can write storage images that declare no format
+		bool                     m_directOutput = false;      // last frame was written to swapchain image by effect
 
 		// queues stuff
 		VkQueue  m_graphicsQueue;
 		uint32_t m_graphicsQueueFamily;
 
+		// async compute (null queue when device has no separate compute family or it is disabled)
+		VkQueue     m_computeQueue = VK_NULL_HANDLE;
+		uint32_t    m_computeQueueFamily = 0;
+		bool        m_computeTimestamps = false;          // compute family supports timestamp queries
+		VkSemaphore m_computeTimeline = VK_NULL_HANDLE;   // compute submit of frame signals frame timeline value
+
 		// frames in flight stuff
-		FrameData m_frames[FRAMES_IN_FLIGHT];
+		// every submit signals next value of frame timeline, deferred deletion waits for timeline values
+		FrameData             m_frames[MAX_FRAMES_IN_FLIGHT];
+		uint32_t              m_framesInFlight = 2;
+		FramePacing           m_framePacing = FramePacing::Timeline;
+		VkSemaphore           m_frameTimeline = VK_NULL_HANDLE;
+		uint64_t              m_submittedValue = 0;
+		HandleDeletionQueue   m_retiredObjects;
 
 		// deletion
 		DeletionQueue m_mainDeletionQueue;
@@ -97,18 +251,92 @@ namespace vr {
 		// allocation
 		VmaAllocator m_allocator;
 
+		// layouts and last accesses of render image and swapchain images
+		BarrierBuilder m_barriers;
+
 		// render image
 		AllocatedImage m_renderImage;
-		VkExtent2D     m_renderExtent;
+		VkExtent2D     m_renderExtent;           // part of render image that is rendered this frame
+
+		// async frames alternate between render image (target 0) and this one, so next dispatch does not wait for resolve
+		AllocatedImage m_asyncRenderImage{};
+		uint32_t       m_asyncTarget = 0;
+		uint64_t       m_renderTargetLastUse[2] = {0, 0};  // frame timeline value of last frame that sampled target
+		float          m_dynamicScale = 1.0f;    // fraction of render image size, set by frame budget controller
+		uint32_t       m_lastScaledFrame = 0;    // frame whose gpu time was last used by controller
 
 		// descriptors
 		DescriptorAllocator   m_globalDescriptorAllocator;
+		std::array<DescriptorAllocator, MAX_FRAMES_IN_FLIGHT> m_frameDescriptors;  // cleared when frame slot is reused
 		VkDescriptorSet       m_renderImageDescriptors;
+		VkDescriptorSet       m_asyncRenderImageDescriptors = VK_NULL_HANDLE;
 		VkDescriptorSetLayout m_renderImageDescriptorLayout;
+		std::vector<VkDescriptorSet> m_swapChainDescriptors;  // same layout as render image set, one per swapchain image
+
+		// parameters of prerecorded frames, push constants of displayed effect are copied to part of frame slot
+		AllocatedBuffer       m_paramsBuffer{};
+		VkDeviceSize          m_paramsStride = 0;
+		VkDescriptorSetLayout m_paramsDescriptorLayout = VK_NULL_HANDLE;
+		VkDescriptorSet       m_paramsDescriptors = VK_NULL_HANDLE;  // dynamic uniform buffer, offset selects frame slot
+		uint64_t              m_recordedGeneration = 1;            // increased when recorded frames use objects that changed
+
+		// staging buffers for render image copies, consumers get them when copy is finished
+		ReadbackRing          m_readback;
+		uint32_t              m_frameOutputConsumer = 0;  // headless frames
+		uint32_t              m_screenshotConsumer = 0;
+		uint32_t              m_recordConsumer = 0;
+		FrameRecorder         m_recorder;
+		std::unique_ptr<ParallelWorkers> m_exportWorkers;  // convert and compress frame files and screenshots
+		ExrWriter             m_exrWriter;
+		FrameWriter           m_frameWriter;  // raw frame files, straight from staging buffers
+		bool                  m_screenshotRequested = false;
+
+		// parameter blocks of effects, copied every frame and passed to shaders as buffer references
+		ParameterRing         m_parameterRing;
+
+		// shared descriptor set with arrays of images and buffers, effects index them with handles
+		BindlessTable         m_bindless;
+
+		// resolve pass
+		VkDescriptorSetLayout m_resolveDescriptorLayout = VK_NULL_HANDLE;
+		VkDescriptorSet       m_resolveDescriptors = VK_NULL_HANDLE;
+		VkDescriptorSet       m_asyncResolveDescriptors = VK_NULL_HANDLE;
+		VkSampler             m_resolveSampler = VK_NULL_HANDLE;
+		VkPipelineLayout      m_resolveLayout = VK_NULL_HANDLE;
+		VkPipeline            m_resolvePipeline = VK_NULL_HANDLE;
 
 		// pipelines (this struct holds pipeline layout and pipeline)
 		std::vector<ComputeEffect> m_computeEffects;
 		int m_currentComputeEffect;
+		int m_displayedComputeEffect = 0;  // differs from current while selected effect is being built
+
+		// layouts are created from shader reflection and live until cleanup
+		std::mutex                                             m_layoutMutex;
+		std::unordered_map<std::string, InterfaceLayout>       m_interfaceLayouts;  // guarded by m_layoutMutex
+		std::unordered_map<std::string, VkDescriptorSetLayout> m_setLayouts;        // guarded by m_layoutMutex
+		uint32_t                                               m_maxPushConstantsSize = 128;
+
+		std::unique_ptr<ThreadPool> m_compileThreads;
+		std::mutex                  m_buildMutex;
+		std::vector<bool>           m_buildStarted;    // guarded by m_buildMutex
+		std::vector<EffectBuild>    m_finishedBuilds;  // guarded by m_buildMutex
+		uint32_t                    m_pendingBuilds = 0;
+		std::chrono::high_resolution_clock::time_point m_buildStartTime;
+
+		// hot reload (shader sources are watched only in windowed mode)
+		std::string   m_shadersPath;
+		ShaderWatcher m_shaderWatcher;
+		bool          m_hotReload = false;
+
+		// best workgroup sizes for this device
+		WorkgroupTuning m_workgroupTuning;
+
+		// pipeline cache that persists between runs
+		PipelineCache m_pipelineCache;
+
+		// gpu time of frame phases
+		GpuProfiler m_gpuProfiler;
+		float         m_lastCacheCheckpoint = 0;
 
 		// immediate command that are submitted outside of main render loop
 		VkFence         m_immFence;
@@ -119,7 +347,7 @@ namespace vr {
 		bool m_showImgui = true;
 
 		// mouse
-		int m_mouseX;
-		int m_mouseY;
+		int m_mouseX = 0;
+		int m_mouseY = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,1068 @@
+#include <vk-exr.hpp>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+using namespace vr;
+
+
+// hosts are little endian like EXR, so values are written as they are in memory
+
+static const uint32_t EXR_MAGIC = 20000630;
+static const uint32_t EXR_VERSION = 2;  // single part scanline file
+
+
+// every line of block has all values of A, then B, G and R (channels are sorted by name)
+static void DeinterleaveRows(const uint8_t *pixels, size_t rowPitch, uint32_t width, uint32_t rowBegin, uint32_t rowEnd, uint8_t *out) {
+	uint16_t *dst = reinterpret_cast<uint16_t*>(out);
+	for (uint32_t y = rowBegin; y != rowEnd; ++y) {
+		const uint16_t *src = reinterpret_cast<const uint16_t*>(pixels + y * rowPitch);
+		for (uint32_t channel : {3u, 2u, 1u, 0u}) {
+			for (uint32_t x = 0; x != width; ++x) {
+				*dst++ = src[x * 4 + channel];
+			}
+		}
+	}
+}
+
+
+// preprocessing of RLE and ZIP blocks: low bytes of halves, then high bytes, stored as differences to previous byte
+static void PredictBytes(const uint8_t *src, size_t size, uint8_t *dst) {
+	uint8_t *low = dst;
+	uint8_t *high = dst + (size + 1) / 2;
+	for (size_t i = 0; i < size; i += 2) {
+		*low++ = src[i];
+		if (i + 1 < size) {
+			*high++ = src[i + 1];
+		}
+	}
+
+	int previous = dst[0];
+	for (size_t i = 1; i < size; ++i) {
+		int value = dst[i];
+		dst[i] = static_cast<uint8_t>(value - previous + 128 + 256);
+		previous = value;
+	}
+}
+
+
+size_t vkutils::CompressExrRle(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+	// runs of at least 3 equal bytes are count - 1 and byte, other bytes are negative count and bytes
+	const size_t minRun = 3;
+	const size_t maxRun = 127;
+	const uint8_t *end = src + size;
+	const uint8_t *runStart = src;
+	const uint8_t *runEnd = src + 1;
+	size_t written = 0;
+
+	while (runStart < end) {
+		while (runEnd < end && *runStart == *runEnd && static_cast<size_t>(runEnd - runStart - 1) < maxRun) {
+			++runEnd;
+		}
+
+		if (static_cast<size_t>(runEnd - runStart) >= minRun) {
+			if (written + 2 > capacity) {
+				return 0;
+			}
+			dst[written++] = static_cast<uint8_t>(runEnd - runStart - 1);
+			dst[written++] = *runStart;
+			runStart = runEnd;
+		} else {
+			while (runEnd < end &&
+				((runEnd + 1 >= end || *runEnd != *(runEnd + 1)) || (runEnd + 2 >= end || *(runEnd + 1) != *(runEnd + 2))) &&
+				static_cast<size_t>(runEnd - runStart) < maxRun) {
+				++runEnd;
+			}
+
+			size_t count = runEnd - runStart;
+			if (written + 1 + count > capacity) {
+				return 0;
+			}
+			dst[written++] = static_cast<uint8_t>(-static_cast<int>(count));
+			std::memcpy(dst + written, runStart, count);
+			written += count;
+			runStart = runEnd;
+		}
+		++runEnd;
+	}
+	return written;
+}
+
+
+// deflate with one dynamic Huffman block, matches are found greedily with one candidate per hash
+namespace {
+	const uint32_t HASH_BITS = 14;
+	const uint32_t WINDOW_SIZE = 32768;
+	const uint32_t MIN_MATCH = 3;
+	const uint32_t MAX_MATCH = 258;
+
+	const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+	const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	struct DeflateTables {
+		uint8_t lengthCode[MAX_MATCH + 1];
+		uint8_t distanceCode[512];  // distance - 1 below 256, then (distance - 1) >> 7
+	};
+
+	const DeflateTables &GetDeflateTables() {
+		static const DeflateTables tables = []() {
+			DeflateTables t{};
+			for (uint32_t code = 0; code != 29; ++code) {
+				for (uint32_t length = LENGTH_BASE[code]; length < LENGTH_BASE[code] + (1u << LENGTH_EXTRA[code]) && length <= MAX_MATCH; ++length) {
+					t.lengthCode[length] = static_cast<uint8_t>(code);
+				}
+			}
+			for (uint32_t code = 0; code != 30; ++code) {
+				for (uint32_t distance = DISTANCE_BASE[code]; distance < DISTANCE_BASE[code] + (1u << DISTANCE_EXTRA[code]); ++distance) {
+					uint32_t d = distance - 1;
+					t.distanceCode[d < 256 ? d : 256 + (d >> 7)] = static_cast<uint8_t>(code);
+				}
+			}
+			return t;
+		}();
+		return tables;
+	}
+
+	uint32_t DistanceCode(const DeflateTables &tables, uint32_t distance) {
+		uint32_t d = distance - 1;
+		return tables.distanceCode[d < 256 ? d : 256 + (d >> 7)];
+	}
+
+	// bits are written from least significant bit, stops writing when buffer is full
+	struct BitWriter {
+		uint8_t *out;
+		size_t   capacity;
+		size_t   size = 0;
+		uint64_t bits = 0;
+		uint32_t count = 0;
+		bool     overflow = false;
+
+		void Put(uint32_t value, uint32_t bitCount) {
+			bits |= static_cast<uint64_t>(value) << count;
+			count += bitCount;
+			while (count >= 8) {
+				PutByte(static_cast<uint8_t>(bits));
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+
+		void Flush() {
+			if (count > 0) {
+				PutByte(static_cast<uint8_t>(bits));
+			}
+			bits = 0;
+			count = 0;
+		}
+
+		void PutByte(uint8_t byte) {
+			if (size == capacity) {
+				overflow = true;
+				return;
+			}
+			out[size++] = byte;
+		}
+	};
+
+	uint32_t Hash(const uint8_t *p) {
+		uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+		return (v * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// calls literal(byte) or match(length, distance), stops when one returns false
+	template <typename Literal, typename Match>
+	void FindMatches(const uint8_t *src, size_t size, int32_t *head, Literal &&literal, Match &&match) {
+		std::fill(head, head + (1u << HASH_BITS), -1);
+
+		size_t i = 0;
+		while (i < size) {
+			uint32_t length = 0;
+			size_t candidate = 0;
+			if (i + MIN_MATCH <= size) {
+				uint32_t h = Hash(src + i);
+				int32_t previous = head[h];
+				head[h] = static_cast<int32_t>(i);
+				if (previous >= 0 && i - previous <= WINDOW_SIZE) {
+					candidate = static_cast<size_t>(previous);
+					uint32_t maxLength = static_cast<uint32_t>(std::min<size_t>(MAX_MATCH, size - i));
+					while (length < maxLength && src[candidate + length] == src[i + length]) {
+						++length;
+					}
+				}
+			}
+
+			if (length >= MIN_MATCH) {
+				if (!match(length, static_cast<uint32_t>(i - candidate))) {
+					return;
+				}
+				for (size_t j = i + 1; j < i + length && j + MIN_MATCH <= size; ++j) {
+					head[Hash(src + j)] = static_cast<int32_t>(j);
+				}
+				i += length;
+			} else {
+				if (!literal(src[i])) {
+					return;
+				}
+				++i;
+			}
+		}
+	}
+
+	// code lengths of prefix code limited to maxLength bits, symbols with zero frequency get no code
+	void BuildCodeLengths(const uint32_t *frequencies, uint32_t symbolCount, uint32_t maxLength, uint8_t *lengths) {
+		const uint32_t MAX_SYMBOLS = 288;
+		uint32_t freq[MAX_SYMBOLS];
+		std::copy(frequencies, frequencies + symbolCount, freq);
+
+		while (true) {
+			uint32_t order[MAX_SYMBOLS];
+			uint32_t leafCount = 0;
+			for (uint32_t s = 0; s != symbolCount; ++s) {
+				lengths[s] = 0;
+				if (freq[s] != 0) {
+					order[leafCount++] = s;
+				}
+			}
+			if (leafCount < 2) {
+				if (leafCount == 1) {
+					lengths[order[0]] = 1;
+				}
+				return;
+			}
+			std::sort(order, order + leafCount, [&](uint32_t a, uint32_t b) { return freq[a] < freq[b]; });
+
+			// leaves are sorted and merged nodes are created in increasing weight, so two queues replace heap
+			uint32_t weight[MAX_SYMBOLS * 2];
+			uint32_t parent[MAX_SYMBOLS * 2];
+			uint32_t depth[MAX_SYMBOLS * 2];
+			for (uint32_t i = 0; i != leafCount; ++i) {
+				weight[i] = freq[order[i]];
+			}
+			uint32_t nextLeaf = 0;
+			uint32_t nextNode = leafCount;
+			uint32_t nodeEnd = leafCount;
+			auto pick = [&]() {
+				if (nextLeaf < leafCount && (nextNode == nodeEnd || weight[nextLeaf] <= weight[nextNode])) {
+					return nextLeaf++;
+				}
+				return nextNode++;
+			};
+			for (uint32_t i = 1; i != leafCount; ++i) {
+				uint32_t a = pick();
+				uint32_t b = pick();
+				weight[nodeEnd] = weight[a] + weight[b];
+				parent[a] = nodeEnd;
+				parent[b] = nodeEnd;
+				nodeEnd++;
+			}
+
+			// parents come after their children
+			uint32_t longest = 0;
+			depth[nodeEnd - 1] = 0;
+			for (uint32_t i = nodeEnd - 1; i-- != 0;) {
+				depth[i] = depth[parent[i]] + 1;
+			}
+			for (uint32_t i = 0; i != leafCount; ++i) {
+				lengths[order[i]] = static_cast<uint8_t>(depth[i]);
+				longest = std::max(longest, depth[i]);
+			}
+			if (longest <= maxLength) {
+				return;
+			}
+
+			// flatter frequencies give shorter longest code
+			for (uint32_t s = 0; s != symbolCount; ++s) {
+				if (freq[s] != 0) {
+					freq[s] = (freq[s] >> 1) | 1;
+				}
+			}
+		}
+	}
+
+	// canonical codes, bit reversed because deflate writes Huffman codes from most significant bit
+	void BuildCodes(const uint8_t *lengths, uint32_t symbolCount, uint16_t *codes) {
+		uint32_t lengthCount[16] = {};
+		for (uint32_t s = 0; s != symbolCount; ++s) {
+			lengthCount[lengths[s]]++;
+		}
+		lengthCount[0] = 0;
+
+		uint32_t nextCode[16] = {};
+		uint32_t code = 0;
+		for (uint32_t bits = 1; bits != 16; ++bits) {
+			code = (code + lengthCount[bits - 1]) << 1;
+			nextCode[bits] = code;
+		}
+
+		for (uint32_t s = 0; s != symbolCount; ++s) {
+			uint32_t length = lengths[s];
+			if (length == 0) {
+				continue;
+			}
+			uint32_t c = nextCode[length]++;
+			uint32_t reversed = 0;
+			for (uint32_t b = 0; b != length; ++b) {
+				reversed |= ((c >> b) & 1) << (length - 1 - b);
+			}
+			codes[s] = static_cast<uint16_t>(reversed);
+		}
+	}
+
+	uint32_t Adler32(const uint8_t *data, size_t size) {
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0) {
+			// largest count before sums can overflow
+			size_t count = std::min<size_t>(size, 5552);
+			size -= count;
+			for (size_t i = 0; i != count; ++i) {
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+}
+
+
+size_t vkutils::CompressZlib(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+	if (capacity < 8) {
+		return 0;
+	}
+
+	const DeflateTables &tables = GetDeflateTables();
+	int32_t head[1u << HASH_BITS];
+
+	// first pass counts symbols, second one writes them with codes built from counts
+	uint32_t literalFrequencies[286] = {};
+	uint32_t distanceFrequencies[30] = {};
+	FindMatches(src, size, head,
+		[&](uint8_t byte) { literalFrequencies[byte]++; return true; },
+		[&](uint32_t length, uint32_t distance) {
+			literalFrequencies[257 + tables.lengthCode[length]]++;
+			distanceFrequencies[DistanceCode(tables, distance)]++;
+			return true;
+		});
+	literalFrequencies[256] = 1;
+
+	// one used distance code would make incomplete code that some decoders reject
+	uint32_t usedDistances = 0;
+	for (uint32_t frequency : distanceFrequencies) {
+		usedDistances += frequency != 0;
+	}
+	if (usedDistances < 2) {
+		distanceFrequencies[0] = std::max(distanceFrequencies[0], 1u);
+		distanceFrequencies[1] = std::max(distanceFrequencies[1], 1u);
+	}
+
+	uint8_t literalLengths[286];
+	uint8_t distanceLengths[30];
+	uint16_t literalCodes[286] = {};
+	uint16_t distanceCodes[30] = {};
+	BuildCodeLengths(literalFrequencies, 286, 15, literalLengths);
+	BuildCodeLengths(distanceFrequencies, 30, 15, distanceLengths);
+	BuildCodes(literalLengths, 286, literalCodes);
+	BuildCodes(distanceLengths, 30, distanceCodes);
+
+	uint32_t literalCount = 286;
+	while (literalCount > 257 && literalLengths[literalCount - 1] == 0) {
+		literalCount--;
+	}
+	uint32_t distanceCount = 30;
+	while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) {
+		distanceCount--;
+	}
+
+	// code lengths of both codes are one sequence, runs are written with repeat symbols 16, 17 and 18
+	uint8_t sequence[286 + 30];
+	uint32_t sequenceSize = 0;
+	std::copy(literalLengths, literalLengths + literalCount, sequence);
+	std::copy(distanceLengths, distanceLengths + distanceCount, sequence + literalCount);
+	sequenceSize = literalCount + distanceCount;
+
+	uint8_t symbols[286 + 30];
+	uint8_t extras[286 + 30];
+	uint32_t symbolCount = 0;
+	uint32_t codeLengthFrequencies[19] = {};
+	auto addSymbol = [&](uint8_t symbol, uint8_t extra) {
+		symbols[symbolCount] = symbol;
+		extras[symbolCount] = extra;
+		symbolCount++;
+		codeLengthFrequencies[symbol]++;
+	};
+	for (uint32_t i = 0; i < sequenceSize;) {
+		uint8_t value = sequence[i];
+		uint32_t run = 1;
+		while (i + run < sequenceSize && sequence[i + run] == value) {
+			run++;
+		}
+
+		if (value == 0 && run >= 3) {
+			uint32_t n = std::min(run, 138u);
+			if (n >= 11) {
+				addSymbol(18, static_cast<uint8_t>(n - 11));
+			} else {
+				addSymbol(17, static_cast<uint8_t>(n - 3));
+			}
+			i += n;
+		} else {
+			addSymbol(value, 0);
+			i++;
+			run--;
+			while (run >= 3) {
+				uint32_t n = std::min(run, 6u);
+				addSymbol(16, static_cast<uint8_t>(n - 3));
+				i += n;
+				run -= n;
+			}
+		}
+	}
+
+	uint8_t codeLengthLengths[19];
+	uint16_t codeLengthCodes[19] = {};
+	BuildCodeLengths(codeLengthFrequencies, 19, 7, codeLengthLengths);
+	BuildCodes(codeLengthLengths, 19, codeLengthCodes);
+	uint32_t codeLengthCount = 19;
+	while (codeLengthCount > 4 && codeLengthLengths[CODE_LENGTH_ORDER[codeLengthCount - 1]] == 0) {
+		codeLengthCount--;
+	}
+
+	// zlib header (deflate, 32K window, no dictionary), adler checksum goes after deflate data
+	BitWriter writer{dst, capacity - 4};
+	writer.Put(0x78, 8);
+	writer.Put(0x01, 8);
+
+	writer.Put(1, 1);  // last block
+	writer.Put(2, 2);  // dynamic Huffman codes
+	writer.Put(literalCount - 257, 5);
+	writer.Put(distanceCount - 1, 5);
+	writer.Put(codeLengthCount - 4, 4);
+	for (uint32_t i = 0; i != codeLengthCount; ++i) {
+		writer.Put(codeLengthLengths[CODE_LENGTH_ORDER[i]], 3);
+	}
+	for (uint32_t i = 0; i != symbolCount; ++i) {
+		uint8_t symbol = symbols[i];
+		writer.Put(codeLengthCodes[symbol], codeLengthLengths[symbol]);
+		if (symbol == 16) {
+			writer.Put(extras[i], 2);
+		} else if (symbol == 17) {
+			writer.Put(extras[i], 3);
+		} else if (symbol == 18) {
+			writer.Put(extras[i], 7);
+		}
+	}
+
+	FindMatches(src, size, head,
+		[&](uint8_t byte) {
+			writer.Put(literalCodes[byte], literalLengths[byte]);
+			return !writer.overflow;
+		},
+		[&](uint32_t length, uint32_t distance) {
+			uint32_t lengthCode = tables.lengthCode[length];
+			writer.Put(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+			writer.Put(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+			uint32_t distanceCode = DistanceCode(tables, distance);
+			writer.Put(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+			writer.Put(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+			return !writer.overflow;
+		});
+	writer.Put(literalCodes[256], literalLengths[256]);
+	writer.Flush();
+	if (writer.overflow) {
+		return 0;
+	}
+
+	uint32_t adler = Adler32(src, size);
+	size_t written = writer.size;
+	dst[written++] = static_cast<uint8_t>(adler >> 24);
+	dst[written++] = static_cast<uint8_t>(adler >> 16);
+	dst[written++] = static_cast<uint8_t>(adler >> 8);
+	dst[written++] = static_cast<uint8_t>(adler);
+	return written;
+}
+
+
+// decoders of what compressors write, only used to check them
+namespace {
+	// bits are read from least significant bit, reading past end gives zeros and sets overrun
+	struct BitReader {
+		const uint8_t *in;
+		size_t         size;
+		size_t         position = 0;
+		uint64_t       bits = 0;
+		uint32_t       count = 0;
+		bool           overrun = false;
+
+		uint32_t Get(uint32_t bitCount) {
+			while (count < bitCount) {
+				if (position == size) {
+					overrun = true;
+					return 0;
+				}
+				bits |= static_cast<uint64_t>(in[position++]) << count;
+				count += 8;
+			}
+			uint32_t value = static_cast<uint32_t>(bits & ((1ull << bitCount) - 1));
+			bits >>= bitCount;
+			count -= bitCount;
+			return value;
+		}
+
+		void AlignToByte() {
+			bits >>= count % 8;
+			count -= count % 8;
+		}
+	};
+
+	// canonical code as number of codes of every length and symbols sorted by code
+	struct HuffmanDecoder {
+		uint16_t count[16];
+		uint16_t symbol[288];
+	};
+
+	bool BuildDecoder(const uint8_t *lengths, uint32_t symbolCount, HuffmanDecoder &decoder) {
+		std::fill(decoder.count, decoder.count + 16, 0);
+		for (uint32_t s = 0; s != symbolCount; ++s) {
+			decoder.count[lengths[s]]++;
+		}
+
+		uint16_t offsets[16] = {};
+		for (uint32_t length = 1; length != 15; ++length) {
+			offsets[length + 1] = offsets[length] + decoder.count[length];
+		}
+		for (uint32_t s = 0; s != symbolCount; ++s) {
+			if (lengths[s] != 0) {
+				decoder.symbol[offsets[lengths[s]]++] = static_cast<uint16_t>(s);
+			}
+		}
+
+		// more codes of some length than there is room for
+		int left = 1;
+		for (uint32_t length = 1; length != 16; ++length) {
+			left = (left << 1) - decoder.count[length];
+			if (left < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// returns -1 for code that is not in decoder
+	int DecodeSymbol(BitReader &reader, const HuffmanDecoder &decoder) {
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (uint32_t length = 1; length != 16; ++length) {
+			code |= static_cast<int>(reader.Get(1));
+			int count = decoder.count[length];
+			if (code - count < first) {
+				return decoder.symbol[index + (code - first)];
+			}
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	// whole zlib stream into exactly size bytes, false if stream is broken, has other size or other checksum
+	bool Inflate(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t size) {
+		if (srcSize < 6 || (src[0] & 0x0f) != 8 || ((src[0] << 8) | src[1]) % 31 != 0 || (src[1] & 0x20) != 0) {
+			return false;
+		}
+
+		BitReader reader{src + 2, srcSize - 6};
+		size_t written = 0;
+		uint32_t last = 0;
+		while (last == 0) {
+			last = reader.Get(1);
+			uint32_t type = reader.Get(2);
+			if (type == 0) {
+				reader.AlignToByte();
+				uint32_t length = reader.Get(16);
+				uint32_t inverse = reader.Get(16);
+				if (length != (~inverse & 0xffff) || written + length > size) {
+					return false;
+				}
+				for (uint32_t i = 0; i != length; ++i) {
+					dst[written++] = static_cast<uint8_t>(reader.Get(8));
+				}
+				continue;
+			}
+			if (type == 3) {
+				return false;
+			}
+
+			uint8_t lengths[288 + 30] = {};
+			uint32_t literalCount = 288;
+			uint32_t distanceCount = 30;
+			if (type == 1) {
+				std::fill(lengths, lengths + 144, 8);
+				std::fill(lengths + 144, lengths + 256, 9);
+				std::fill(lengths + 256, lengths + 280, 7);
+				std::fill(lengths + 280, lengths + 288, 8);
+				std::fill(lengths + 288, lengths + 288 + 30, 5);
+			} else {
+				literalCount = reader.Get(5) + 257;
+				distanceCount = reader.Get(5) + 1;
+				uint32_t codeLengthCount = reader.Get(4) + 4;
+				if (literalCount > 286 || distanceCount > 30) {
+					return false;
+				}
+
+				uint8_t codeLengthLengths[19] = {};
+				for (uint32_t i = 0; i != codeLengthCount; ++i) {
+					codeLengthLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.Get(3));
+				}
+				HuffmanDecoder codeLengths;
+				if (!BuildDecoder(codeLengthLengths, 19, codeLengths)) {
+					return false;
+				}
+
+				// literal lengths go straight into distance lengths, so read them as one sequence and move distances after
+				uint32_t sequenceSize = literalCount + distanceCount;
+				uint8_t sequence[286 + 30] = {};
+				for (uint32_t i = 0; i < sequenceSize;) {
+					int symbol = DecodeSymbol(reader, codeLengths);
+					if (symbol < 0 || reader.overrun) {
+						return false;
+					}
+					if (symbol < 16) {
+						sequence[i++] = static_cast<uint8_t>(symbol);
+						continue;
+					}
+
+					uint8_t value = 0;
+					uint32_t repeat = 0;
+					if (symbol == 16) {
+						if (i == 0) {
+							return false;
+						}
+						value = sequence[i - 1];
+						repeat = 3 + reader.Get(2);
+					} else if (symbol == 17) {
+						repeat = 3 + reader.Get(3);
+					} else {
+						repeat = 11 + reader.Get(7);
+					}
+					if (i + repeat > sequenceSize) {
+						return false;
+					}
+					std::fill(sequence + i, sequence + i + repeat, value);
+					i += repeat;
+				}
+				std::copy(sequence, sequence + literalCount, lengths);
+				std::copy(sequence + literalCount, sequence + sequenceSize, lengths + 288);
+				if (lengths[256] == 0) {
+					return false;
+				}
+			}
+
+			HuffmanDecoder literals;
+			HuffmanDecoder distances;
+			if (!BuildDecoder(lengths, literalCount, literals) || !BuildDecoder(lengths + 288, distanceCount, distances)) {
+				return false;
+			}
+
+			while (true) {
+				int symbol = DecodeSymbol(reader, literals);
+				if (symbol < 0 || reader.overrun) {
+					return false;
+				}
+				if (symbol < 256) {
+					if (written == size) {
+						return false;
+					}
+					dst[written++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				if (symbol == 256) {
+					break;
+				}
+
+				uint32_t lengthCode = static_cast<uint32_t>(symbol - 257);
+				if (lengthCode >= 29) {
+					return false;
+				}
+				uint32_t length = LENGTH_BASE[lengthCode] + reader.Get(LENGTH_EXTRA[lengthCode]);
+				int distanceCode = DecodeSymbol(reader, distances);
+				if (distanceCode < 0 || distanceCode >= 30) {
+					return false;
+				}
+				uint32_t distance = DISTANCE_BASE[distanceCode] + reader.Get(DISTANCE_EXTRA[distanceCode]);
+				if (distance > written || written + length > size) {
+					return false;
+				}
+				for (uint32_t i = 0; i != length; ++i, ++written) {
+					dst[written] = dst[written - distance];
+				}
+			}
+		}
+
+		// deflate data has to end right before checksum
+		if (reader.overrun || reader.position != reader.size || written != size) {
+			return false;
+		}
+		const uint8_t *checksum = src + srcSize - 4;
+		uint32_t adler = (static_cast<uint32_t>(checksum[0]) << 24) | (checksum[1] << 16) | (checksum[2] << 8) | checksum[3];
+		return adler == Adler32(dst, size);
+	}
+
+	bool ExpandExrRle(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t size) {
+		size_t read = 0;
+		size_t written = 0;
+		while (read < srcSize) {
+			int count = static_cast<int8_t>(src[read++]);
+			if (count < 0) {
+				size_t n = static_cast<size_t>(-count);
+				if (read + n > srcSize || written + n > size) {
+					return false;
+				}
+				std::memcpy(dst + written, src + read, n);
+				read += n;
+				written += n;
+			} else {
+				size_t n = static_cast<size_t>(count) + 1;
+				if (read == srcSize || written + n > size) {
+					return false;
+				}
+				std::memset(dst + written, src[read++], n);
+				written += n;
+			}
+		}
+		return written == size;
+	}
+
+	// reverses PredictBytes, src is changed
+	void UnpredictBytes(uint8_t *src, size_t size, uint8_t *dst) {
+		for (size_t i = 1; i < size; ++i) {
+			src[i] = static_cast<uint8_t>(src[i - 1] + src[i] - 128);
+		}
+		const uint8_t *low = src;
+		const uint8_t *high = src + (size + 1) / 2;
+		for (size_t i = 0; i < size; i += 2) {
+			dst[i] = *low++;
+			if (i + 1 < size) {
+				dst[i + 1] = *high++;
+			}
+		}
+	}
+}
+
+
+uint32_t ExrWriter::GetBlockLines(ExrCompression compression) {
+	return compression == ExrCompression::Zip ? 16 : 1;
+}
+
+
+void ExrWriter::WriteBlock(Block &block, const uint8_t *pixels, uint32_t width, uint32_t rowBegin, uint32_t rowEnd, size_t rowPitch, ExrCompression compression) {
+	size_t rawSize = static_cast<size_t>(width) * (rowEnd - rowBegin) * 4 * sizeof(uint16_t);
+	block.data.resize(rawSize);
+	block.size = static_cast<uint32_t>(rawSize);
+	DeinterleaveRows(pixels, rowPitch, width, rowBegin, rowEnd, block.data.data());
+	if (compression == ExrCompression::None) {
+		return;
+	}
+
+	// readers take block of full size as uncompressed, so compressed one must be smaller
+	block.scratch.resize(rawSize);
+	PredictBytes(block.data.data(), rawSize, block.scratch.data());
+	size_t packed = compression == ExrCompression::Rle ?
+		vkutils::CompressExrRle(block.scratch.data(), rawSize, block.data.data(), rawSize - 1) :
+		vkutils::CompressZlib(block.scratch.data(), rawSize, block.data.data(), rawSize - 1);
+
+	if (packed != 0) {
+		block.size = static_cast<uint32_t>(packed);
+	} else {
+		// compressor wrote over lines, so they are taken from pixels again
+		DeinterleaveRows(pixels, rowPitch, width, rowBegin, rowEnd, block.data.data());
+	}
+}
+
+
+bool ExrWriter::Write(const char *path, const void *pixels, uint32_t width, uint32_t height, size_t rowPitch, ExrCompression compression, ParallelWorkers &workers) {
+	uint32_t blockLines = GetBlockLines(compression);
+	uint32_t blockCount = (height + blockLines - 1) / blockLines;
+	if (m_blocks.size() < blockCount) {
+		m_blocks.resize(blockCount);
+	}
+	m_offsets.resize(blockCount);
+
+	// blocks are read straight from mapped pixels
+	workers.Run(blockCount, [&](uint32_t b) {
+		uint32_t rowBegin = b * blockLines;
+		WriteBlock(m_blocks[b], static_cast<const uint8_t*>(pixels), width, rowBegin, std::min(rowBegin + blockLines, height), rowPitch, compression);
+	});
+
+	uint8_t header[512];
+	size_t headerSize = 0;
+	auto append = [&](const void *data, size_t size) {
+		std::memcpy(header + headerSize, data, size);
+		headerSize += size;
+	};
+	auto attribute = [&](const char *name, const char *type, const void *value, uint32_t size) {
+		append(name, std::strlen(name) + 1);
+		append(type, std::strlen(type) + 1);
+		append(&size, sizeof(size));
+		append(value, size);
+	};
+
+	append(&EXR_MAGIC, sizeof(EXR_MAGIC));
+	append(&EXR_VERSION, sizeof(EXR_VERSION));
+
+	// name, half type, not linear, reserved and sampling of every channel
+	uint8_t channels[4 * 18 + 1] = {};
+	const char *names = "ABGR";
+	for (uint32_t c = 0; c != 4; ++c) {
+		uint8_t *channel = channels + c * 18;
+		const int32_t halfType = 1;
+		const int32_t sampling = 1;
+		channel[0] = static_cast<uint8_t>(names[c]);
+		std::memcpy(channel + 2, &halfType, 4);
+		std::memcpy(channel + 10, &sampling, 4);
+		std::memcpy(channel + 14, &sampling, 4);
+	}
+	attribute("channels", "chlist", channels, sizeof(channels));
+
+	const uint8_t compressionValue = compression == ExrCompression::Zip ? 3 : compression == ExrCompression::Rle ? 1 : 0;
+	attribute("compression", "compression", &compressionValue, 1);
+
+	const int32_t window[4] = {0, 0, static_cast<int32_t>(width) - 1, static_cast<int32_t>(height) - 1};
+	attribute("dataWindow", "box2i", window, sizeof(window));
+	attribute("displayWindow", "box2i", window, sizeof(window));
+
+	const uint8_t lineOrder = 0;  // increasing y
+	const float aspectRatio = 1.0f;
+	const float screenCenter[2] = {0.0f, 0.0f};
+	const float screenWidth = 1.0f;
+	attribute("lineOrder", "lineOrder", &lineOrder, 1);
+	attribute("pixelAspectRatio", "float", &aspectRatio, sizeof(aspectRatio));
+	attribute("screenWindowCenter", "v2f", screenCenter, sizeof(screenCenter));
+	attribute("screenWindowWidth", "float", &screenWidth, sizeof(screenWidth));
+	append("", 1);
+
+	// offset table points at every block, blocks start with their first line and size
+	uint64_t offset = headerSize + sizeof(uint64_t) * blockCount;
+	for (uint32_t b = 0; b != blockCount; ++b) {
+		m_offsets[b] = offset;
+		offset += sizeof(int32_t) * 2 + m_blocks[b].size;
+	}
+
+	std::FILE *file = std::fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+
+	bool ok = std::fwrite(header, 1, headerSize, file) == headerSize;
+	ok = ok && std::fwrite(m_offsets.data(), sizeof(uint64_t), blockCount, file) == blockCount;
+	for (uint32_t b = 0; b < blockCount && ok; ++b) {
+		const int32_t blockHeader[2] = {static_cast<int32_t>(b * blockLines), static_cast<int32_t>(m_blocks[b].size)};
+		ok = std::fwrite(blockHeader, sizeof(blockHeader), 1, file) == 1;
+		ok = ok && std::fwrite(m_blocks[b].data.data(), 1, m_blocks[b].size, file) == m_blocks[b].size;
+	}
+
+	return std::fclose(file) == 0 && ok;
+}
+
+
+// reads file back and compares every block with pixels it was written from
+static bool VerifyExrFile(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height, size_t rowPitch, ExrCompression compression) {
+	std::vector<uint8_t> file;
+	if (std::FILE *f = std::fopen(path, "rb")) {
+		uint8_t chunk[65536];
+		size_t read = 0;
+		while ((read = std::fread(chunk, 1, sizeof(chunk), f)) != 0) {
+			file.insert(file.end(), chunk, chunk + read);
+		}
+		std::fclose(f);
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	if (file.size() >= 8) {
+		std::memcpy(&magic, file.data(), sizeof(magic));
+		std::memcpy(&version, file.data() + 4, sizeof(version));
+	}
+	if (magic != EXR_MAGIC || version != EXR_VERSION) {
+		spdlog::error("EXR check: {} is not EXR file", path);
+		return false;
+	}
+
+	// attributes are name, type, size and value, header ends with empty name
+	size_t position = 8;
+	int32_t compressionValue = -1;
+	int32_t window[4] = {};
+	while (position < file.size() && file[position] != 0) {
+		const char *name = reinterpret_cast<const char*>(file.data() + position);
+		position += std::strlen(name) + 1;
+		position += std::strlen(reinterpret_cast<const char*>(file.data() + position)) + 1;
+		uint32_t size = 0;
+		std::memcpy(&size, file.data() + position, sizeof(size));
+		position += sizeof(size);
+		if (std::strcmp(name, "compression") == 0) {
+			compressionValue = file[position];
+		} else if (std::strcmp(name, "dataWindow") == 0) {
+			std::memcpy(window, file.data() + position, sizeof(window));
+		}
+		position += size;
+	}
+	position++;
+
+	const int32_t expectedCompression = compression == ExrCompression::Zip ? 3 : compression == ExrCompression::Rle ? 1 : 0;
+	if (compressionValue != expectedCompression || window[2] != static_cast<int32_t>(width) - 1 || window[3] != static_cast<int32_t>(height) - 1) {
+		spdlog::error("EXR check: header of {} does not match frame", path);
+		return false;
+	}
+
+	uint32_t blockLines = ExrWriter::GetBlockLines(compression);
+	uint32_t blockCount = (height + blockLines - 1) / blockLines;
+	if (position + sizeof(uint64_t) * blockCount > file.size()) {
+		spdlog::error("EXR check: offset table of {} is cut", path);
+		return false;
+	}
+
+	std::vector<uint8_t> packed;
+	std::vector<uint8_t> lines;
+	for (uint32_t b = 0; b != blockCount; ++b) {
+		uint64_t offset = 0;
+		std::memcpy(&offset, file.data() + position + b * sizeof(uint64_t), sizeof(offset));
+		int32_t blockHeader[2] = {-1, -1};
+		if (offset + sizeof(blockHeader) <= file.size()) {
+			std::memcpy(blockHeader, file.data() + offset, sizeof(blockHeader));
+		}
+		if (blockHeader[0] != static_cast<int32_t>(b * blockLines) || blockHeader[1] < 0 || offset + sizeof(blockHeader) + blockHeader[1] > file.size()) {
+			spdlog::error("EXR check: block {} of {} has wrong offset or header", b, path);
+			return false;
+		}
+
+		uint32_t rowBegin = b * blockLines;
+		uint32_t rowEnd = std::min(rowBegin + blockLines, height);
+		size_t rawSize = static_cast<size_t>(width) * (rowEnd - rowBegin) * 4 * sizeof(uint16_t);
+		size_t size = static_cast<size_t>(blockHeader[1]);
+		const uint8_t *data = file.data() + offset + sizeof(blockHeader);
+
+		lines.resize(rawSize);
+		if (size == rawSize) {
+			std::memcpy(lines.data(), data, rawSize);
+		} else {
+			packed.resize(rawSize);
+			bool expanded = compression == ExrCompression::Rle ? ExpandExrRle(data, size, packed.data(), rawSize) :
+				compression == ExrCompression::Zip && Inflate(data, size, packed.data(), rawSize);
+			if (!expanded) {
+				spdlog::error("EXR check: block {} of {} cannot be decompressed", b, path);
+				return false;
+			}
+			UnpredictBytes(packed.data(), rawSize, lines.data());
+		}
+
+		// lines have all values of A, then B, G and R
+		const uint8_t *value = lines.data();
+		for (uint32_t y = rowBegin; y != rowEnd; ++y) {
+			for (uint32_t channel : {3u, 2u, 1u, 0u}) {
+				for (uint32_t x = 0; x != width; ++x, value += sizeof(uint16_t)) {
+					if (std::memcmp(value, pixels + y * rowPitch + (x * 4 + channel) * sizeof(uint16_t), sizeof(uint16_t)) != 0) {
+						spdlog::error("EXR check: pixel {}x{} of {} differs from frame", x, y, path);
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+bool vkutils::BenchmarkExrCompression(const std::string &directory, uint32_t width, uint32_t height, ParallelWorkers &workers, BenchmarkReport &report) {
+	bool matches = true;
+
+	// compressors alone with data that is easy and hard for them, decompressed result must be what was compressed
+	std::vector<uint8_t> source(65536);
+	std::vector<uint8_t> packed(source.size() * 2 + 64);
+	std::vector<uint8_t> unpacked(source.size());
+	uint32_t random = 1;
+	auto nextRandom = [&random]() {
+		random = random * 1664525u + 1013904223u;
+		return static_cast<uint8_t>(random >> 24);
+	};
+	const char *patterns[] = {"zeros", "random", "ramp", "runs"};
+	for (uint32_t pattern = 0; pattern != 4; ++pattern) {
+		for (size_t i = 0; i != source.size(); ++i) {
+			source[i] = pattern == 0 ? 0 : pattern == 1 ? nextRandom() : pattern == 2 ? static_cast<uint8_t>(i / 7) : static_cast<uint8_t>((i / 200) % 3 == 0 ? nextRandom() : 5);
+		}
+		for (size_t size : {size_t(1), size_t(2), size_t(3), size_t(130), size_t(4099), source.size()}) {
+			size_t rleSize = CompressExrRle(source.data(), size, packed.data(), packed.size());
+			if (rleSize == 0 || !ExpandExrRle(packed.data(), rleSize, unpacked.data(), size) || std::memcmp(unpacked.data(), source.data(), size) != 0) {
+				spdlog::error("EXR check: RLE of {} {} bytes does not give them back", size, patterns[pattern]);
+				matches = false;
+			}
+			size_t zipSize = CompressZlib(source.data(), size, packed.data(), packed.size());
+			if (zipSize == 0 || !Inflate(packed.data(), zipSize, unpacked.data(), size) || std::memcmp(unpacked.data(), source.data(), size) != 0) {
+				spdlog::error("EXR check: zlib of {} {} bytes does not give them back", size, patterns[pattern]);
+				matches = false;
+			}
+		}
+	}
+
+	// frame of smooth halves with noisy low bits, with band of random bytes (stored uncompressed) and black band
+	size_t rowPitch = static_cast<size_t>(width) * 4 * sizeof(uint16_t) + 256;
+	std::vector<uint8_t> pixels(rowPitch * height);
+	for (uint32_t y = 0; y != height; ++y) {
+		uint16_t *row = reinterpret_cast<uint16_t*>(pixels.data() + y * rowPitch);
+		for (uint32_t x = 0; x != width * 4; ++x) {
+			uint32_t channel = x % 4;
+			uint16_t value = static_cast<uint16_t>(0x3800 + (((x / 4) * (channel + 1) + y * 3) >> 2) % 0x400);
+			value = static_cast<uint16_t>((value & ~3u) | (nextRandom() & 3));
+			if (y >= height / 4 && y < height / 4 + 16) {
+				value = static_cast<uint16_t>(nextRandom() | (nextRandom() << 8));
+			} else if (y >= height - 16) {
+				value = 0;
+			} else if (channel == 3) {
+				value = 0x3c00;
+			}
+			row[x] = value;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	std::string path = directory + "/exr_benchmark.exr";
+	double rawSize = static_cast<double>(width) * height * 4 * sizeof(uint16_t);
+	ExrWriter writer;
+	for (ExrCompression compression : {ExrCompression::None, ExrCompression::Rle, ExrCompression::Zip}) {
+		double bestMs = 0.0;
+		bool written = true;
+		for (uint32_t run = 0; run != 3 && written; ++run) {
+			auto start = std::chrono::steady_clock::now();
+			written = writer.Write(path.c_str(), pixels.data(), width, height, rowPitch, compression, workers);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			bestMs = run == 0 ? ms : std::min(bestMs, ms);
+		}
+		if (!written) {
+			spdlog::error("EXR check: {} could not be written", path);
+			matches = false;
+			break;
+		}
+
+		double fileSize = static_cast<double>(std::filesystem::file_size(path, error));
+		matches &= VerifyExrFile(path.c_str(), pixels.data(), width, height, rowPitch, compression);
+
+		std::string name = fmt::format("exr.{}", ExrCompressionName(compression));
+		report.host.push_back({name + ".write", static_cast<float>(bestMs), "ms"});
+		report.host.push_back({name + ".ratio", static_cast<float>(rawSize / fileSize), "x"});
+		spdlog::info("EXR {}x{} {}: {:.2f} ms, {:.2f}x smaller, {} threads", width, height, ExrCompressionName(compression), bestMs, rawSize / fileSize,
+			workers.GetThreadCount());
+	}
+	std::filesystem::remove(path, error);
+	return matches;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vk-config.hpp>
+#include <vk-thread-pool.hpp>
+#include <vk-benchmark.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vr {
+	// scanline OpenEXR writer for RGBA16F frames, channels stay half float, so nothing is lost
+	// blocks are converted from mapped pixels and compressed in parallel, then written in order
+	// buffers of blocks are kept, so frames of same size do not allocate
+	class ExrWriter final {
+	public:
+		bool Write(const char *path, const void *pixels, uint32_t width, uint32_t height, size_t rowPitch, ExrCompression compression, ParallelWorkers &workers);
+
+		// scanlines in one block of compression
+		static uint32_t GetBlockLines(ExrCompression compression);
+
+	private:
+		struct Block {
+			std::vector<uint8_t> data;     // what is written, compressed if that was smaller
+			std::vector<uint8_t> scratch;  // predicted bytes that are compressed
+			uint32_t             size = 0;
+		};
+
+		void WriteBlock(Block &block, const uint8_t *pixels, uint32_t width, uint32_t rowBegin, uint32_t rowEnd, size_t rowPitch, ExrCompression compression);
+
+	private:
+		std::vector<Block>    m_blocks;
+		std::vector<uint64_t> m_offsets;
+	};
+}
+
+namespace vkutils {
+	// compressors of EXR blocks (without predictor), return compressed size or 0 if it would not fit in capacity
+	size_t CompressExrRle(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+	size_t CompressZlib(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+	// compresses buffers with both compressors and writes frame with every compression to directory,
+	// decodes them again and adds write times and ratios to report
+	// returns false (and logs error) if anything decoded differs from what was written
+	bool BenchmarkExrCompression(const std::string &directory, uint32_t width, uint32_t height, vr::ParallelWorkers &workers, vr::BenchmarkReport &report);
+}
@@ -0,0 +1,27 @@
+#include <vk-frame-io.hpp>
+
+#include <cstdio>
+
+
+bool vkutils::WriteFramePPM(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height, uint8_t *row) {
+	std::FILE *file = std::fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+
+	bool ok = std::fprintf(file, "P6\n%u %u\n255\n", width, height) > 0;
+
+	// pack one row at a time
+	size_t rowSize = static_cast<size_t>(width) * 3;
+	for (uint32_t y = 0; y < height && ok; ++y) {
+		const uint8_t *src = pixels + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; ++x) {
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		ok = std::fwrite(row, 1, rowSize, file) == rowSize;
+	}
+
+	return std::fclose(file) == 0 && ok;
+}
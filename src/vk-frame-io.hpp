@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vkutils {
+	// writes tightly packed RGBA8 pixels as binary PPM (alpha is dropped)
+	// row is scratch for one packed row (width * 3 bytes), so writer does not allocate
+	bool WriteFramePPM(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height, uint8_t *row);
+}
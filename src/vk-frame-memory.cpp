@@ -0,0 +1,116 @@
+#include <vk-frame-memory.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace vr;
+
+
+FrameArena::Block FrameArena::AllocateBlock(size_t size, size_t alignment) {
+	return Block(static_cast<uint8_t*>(::operator new[](std::max<size_t>(size, 1), std::align_val_t(alignment))), BlockDelete{alignment});
+}
+
+
+void FrameArena::Init(size_t capacity) {
+	m_memory = AllocateBlock(capacity, BLOCK_ALIGNMENT);
+	m_capacity = capacity;
+	m_offset = 0;
+}
+
+
+void *FrameArena::Allocate(size_t size, size_t alignment) {
+	// aligned by address, so alignment above that of block works too
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_memory.get());
+	size_t offset = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+	if (offset + size <= m_capacity) {
+		m_offset = offset + size;
+		return m_memory.get() + offset;
+	}
+
+	m_overflow.push_back(AllocateBlock(size, std::max(alignment, BLOCK_ALIGNMENT)));
+	m_overflowSize += size;
+	return m_overflow.back().get();
+}
+
+
+void FrameArena::Reset() {
+	m_peakUsed = std::max(m_peakUsed, m_offset + m_overflowSize);
+
+	// next frames get everything this one needed in one block
+	if (!m_overflow.empty()) {
+		m_overflow.clear();
+		Init(std::max(m_capacity * 2, m_capacity + m_overflowSize));
+	}
+
+	m_offset = 0;
+	m_overflowSize = 0;
+}
+
+
+// counter is per thread, so background pipeline builds are not counted in frames of main thread
+static thread_local uint64_t t_allocationCount = 0;
+
+uint64_t vkutils::GetThreadAllocationCount() {
+	return t_allocationCount;
+}
+
+
+static void *CountedAllocate(size_t size) {
+	t_allocationCount++;
+	void *ptr = std::malloc(size != 0 ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+static void *CountedAllocate(size_t size, std::align_val_t alignment) {
+	t_allocationCount++;
+	size_t align = static_cast<size_t>(alignment);
+	size = (std::max<size_t>(size, 1) + align - 1) & ~(align - 1);
+#ifdef _WIN32
+	void *ptr = _aligned_malloc(size, align);
+#else
+	void *ptr = std::aligned_alloc(align, size);
+#endif
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+static void AlignedFree(void *ptr) {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+
+void *operator new(size_t size) { return CountedAllocate(size); }
+void *operator new[](size_t size) { return CountedAllocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return CountedAllocate(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return CountedAllocate(size, alignment); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	t_allocationCount++;
+	return std::malloc(size != 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	t_allocationCount++;
+	return std::malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { AlignedFree(ptr); }
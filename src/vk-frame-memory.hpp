@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace vr {
+	// linear allocator for cpu data that lives until end of frame (overlay labels, copies of small arrays)
+	// allocation only moves offset, reset frees everything at once
+	// when frame needs more than capacity, extra blocks come from heap and capacity grows at next reset
+	class FrameArena final {
+	public:
+		void Init(size_t capacity);
+
+		// alignment is power of two, over-aligned types (alignas above 16) are supported too
+		void *Allocate(size_t size, size_t alignment);
+
+		// destructors are never called, so only trivial types can be stored
+		template<typename T>
+		T *Allocate(size_t count) {
+			static_assert(std::is_trivially_destructible_v<T>, "frame arena does not call destructors");
+			return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		void Reset();
+
+		size_t GetCapacity() const { return m_capacity; }
+		size_t GetPeakUsed() const { return m_peakUsed; }
+
+		// blocks start at cache line at least, so allocations do not share line with other data
+		static constexpr size_t BLOCK_ALIGNMENT = 64;
+
+	private:
+		// blocks come from aligned new, so they are freed with its alignment
+		struct BlockDelete {
+			size_t alignment;
+			void operator()(uint8_t *block) const { ::operator delete[](block, std::align_val_t(alignment)); }
+		};
+		using Block = std::unique_ptr<uint8_t[], BlockDelete>;
+
+		static Block AllocateBlock(size_t size, size_t alignment);
+
+	private:
+		Block              m_memory;
+		size_t             m_capacity = 0;
+		size_t             m_offset = 0;
+		std::vector<Block> m_overflow;  // blocks of this frame that did not fit
+		size_t             m_overflowSize = 0;
+		size_t             m_peakUsed = 0;
+	};
+}
+
+namespace vkutils {
+	// number of heap allocations (operator new) made by calling thread since it started
+	// global operator new and delete are replaced in vk-frame-memory.cpp to count them
+	uint64_t GetThreadAllocationCount();
+}
@@ -0,0 +1,650 @@
+#include <vk-frame-writer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef VR_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+using namespace vr;
+
+
+// linux writes at most about 2 GiB per call, larger files are written in parts
+static const size_t MAX_WRITE = size_t(1) << 30;
+
+
+static size_t AlignUp(size_t size, size_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+
+static void CloseFile(int fd) {
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+
+bool FrameWriter::Init(WriteBackend backend, bool directIo, uint32_t threadCount, uint32_t capacity, uint32_t slotCount, Completion &&completion) {
+	m_capacity = std::max(capacity, 1u);
+	m_requests.assign(m_capacity, Request{});
+	m_freeRequests.clear();
+	for (uint32_t i = m_capacity; i != 0; --i) {
+		m_freeRequests.push_back(i - 1);
+	}
+	m_slots.assign(slotCount, Slot{});
+	m_completion = std::move(completion);
+	m_files = 0;
+	m_bytes = 0;
+	m_failed = 0;
+
+#ifdef __linux__
+	m_directIo = directIo;
+#else
+	m_directIo = false;
+	if (directIo) {
+		spdlog::warn("Direct io is only supported on linux, files are written through cache");
+	}
+#endif
+
+	m_backend = WriteBackend::Pwrite;
+#ifdef VR_HAS_IO_URING
+	if (backend != WriteBackend::Pwrite) {
+		if (InitRing(slotCount)) {
+			m_backend = WriteBackend::IoUring;
+		} else if (backend == WriteBackend::IoUring) {
+			spdlog::warn("io_uring is not available ({}), files are written by pwrite threads", std::strerror(errno));
+		}
+	}
+#else
+	if (backend == WriteBackend::IoUring) {
+		spdlog::warn("io_uring is only available on linux, files are written by pwrite threads");
+	}
+#endif
+
+	if (m_backend == WriteBackend::Pwrite) {
+		m_queued.assign(m_capacity, 0);
+		m_finished.assign(m_capacity, 0);
+		m_queuedHead = m_queuedCount = 0;
+		m_finishedHead = m_finishedCount = 0;
+		m_stopping = false;
+		for (uint32_t i = 0; i != std::max(threadCount, 1u); ++i) {
+			m_threads.emplace_back(&FrameWriter::WriteLoop, this);
+		}
+	}
+
+	m_initialized = true;
+	return true;
+}
+
+
+void FrameWriter::Destroy() {
+	if (!m_initialized) {
+		return;
+	}
+	Flush();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_queuedAvailable.notify_all();
+	for (auto &thread : m_threads) {
+		thread.join();
+	}
+	m_threads.clear();
+
+#ifdef VR_HAS_IO_URING
+	DestroyRing();
+#endif
+
+	m_requests.clear();
+	m_freeRequests.clear();
+	m_slots.clear();
+	m_completion = nullptr;
+	m_capacity = 0;
+	m_initialized = false;
+}
+
+
+bool FrameWriter::Submit(const char *path, const void *data, size_t size, size_t readable, uint32_t slot, uint64_t tag) {
+	if (m_freeRequests.empty()) {
+		return false;
+	}
+
+	bool direct = false;
+	int fd = OpenFile(path, size, readable, data, direct);
+	if (fd < 0) {
+		return false;
+	}
+
+	uint32_t index = m_freeRequests.back();
+	m_freeRequests.pop_back();
+
+	Request &request = m_requests[index];
+	request.fd = fd;
+	request.data = static_cast<const uint8_t *>(data);
+	request.size = size;
+	request.writeSize = direct ? AlignUp(size, DIRECT_ALIGNMENT) : size;
+	request.written = 0;
+	request.slot = slot;
+	request.tag = tag;
+	request.direct = direct;
+	request.preallocated = direct;
+	request.directFailed = false;
+	request.ok = false;
+
+#ifdef VR_HAS_IO_URING
+	if (m_backend == WriteBackend::IoUring) {
+		// staging buffer was created again (bigger), its slot points to old memory
+		if (slot < m_slots.size() && (m_slots[slot].data != data || m_slots[slot].size != readable)) {
+			RegisterSlot(slot, data, readable);
+		}
+		QueueWrite(index);
+		return true;
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued[(m_queuedHead + m_queuedCount) % m_capacity] = index;
+		m_queuedCount++;
+	}
+	m_queuedAvailable.notify_one();
+	return true;
+}
+
+
+uint32_t FrameWriter::Poll(bool wait) {
+	if (!m_initialized) {
+		return 0;
+	}
+
+#ifdef VR_HAS_IO_URING
+	if (m_backend == WriteBackend::IoUring) {
+		return ReapRing(wait);
+	}
+#endif
+
+	uint32_t delivered = 0;
+	for (;;) {
+		uint32_t index = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (wait && delivered == 0 && GetInFlight() != 0) {
+				m_finishedAvailable.wait(lock, [this]() { return m_finishedCount != 0; });
+			}
+			if (m_finishedCount == 0) {
+				break;
+			}
+			index = m_finished[m_finishedHead];
+			m_finishedHead = (m_finishedHead + 1) % m_capacity;
+			m_finishedCount--;
+		}
+		Complete(index);
+		delivered++;
+	}
+	return delivered;
+}
+
+
+void FrameWriter::Flush() {
+	while (m_initialized && GetInFlight() != 0) {
+		Poll(true);
+	}
+}
+
+
+FrameWriter::Stats FrameWriter::GetStats() const {
+	Stats stats;
+	stats.files = m_files;
+	stats.bytes = m_bytes;
+	stats.failed = m_failed;
+	stats.inFlight = GetInFlight();
+	stats.capacity = m_capacity;
+	return stats;
+}
+
+
+int FrameWriter::OpenFile(const char *path, size_t size, size_t readable, const void *data, bool &direct) {
+	direct = false;
+
+#ifdef _WIN32
+	(void)size;
+	(void)readable;
+	(void)data;
+	return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+#ifdef __linux__
+	// direct writes need aligned memory and whole blocks, so part after data is written too and cut off later
+	size_t writeSize = AlignUp(size, DIRECT_ALIGNMENT);
+	if (m_directIo && reinterpret_cast<uintptr_t>(data) % DIRECT_ALIGNMENT == 0 && writeSize <= readable) {
+		int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+		if (fd >= 0) {
+			// blocks are allocated up front, so writes do not extend file (file systems without fallocate extend it as usual)
+			if (fallocate(fd, 0, 0, static_cast<off_t>(writeSize)) != 0 && errno != EOPNOTSUPP) {
+				spdlog::warn("failed to preallocate {}: {}", path, std::strerror(errno));
+			}
+			direct = true;
+			return fd;
+		}
+		if (errno != EINVAL) {
+			return -1;
+		}
+
+		// file system does not support O_DIRECT (tmpfs)
+		spdlog::warn("Direct io is not supported in directory of {}, files are written through page cache", path);
+		m_directIo = false;
+	}
+#else
+	(void)readable;
+	(void)data;
+#endif
+	(void)size;
+	return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+
+void FrameWriter::FinishFile(Request &request) {
+#ifdef __linux__
+	if (request.ok && request.preallocated && ftruncate(request.fd, static_cast<off_t>(request.size)) != 0) {
+		request.ok = false;
+	}
+#endif
+	CloseFile(request.fd);
+	request.fd = -1;
+}
+
+
+void FrameWriter::Complete(uint32_t index) {
+	Request &request = m_requests[index];
+	if (request.directFailed && m_directIo) {
+		// same memory and file system are used for next files, so they would fail again
+		spdlog::warn("Direct write was refused, next files are written through page cache");
+		m_directIo = false;
+	}
+	if (request.ok) {
+		m_files++;
+		m_bytes += request.size;
+	} else {
+		m_failed++;
+	}
+	m_freeRequests.push_back(index);
+	m_completion(request.tag, request.ok);
+}
+
+
+void FrameWriter::WriteLoop() {
+	for (;;) {
+		uint32_t index = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queuedAvailable.wait(lock, [this]() { return m_queuedCount != 0 || m_stopping; });
+			if (m_queuedCount == 0) {
+				return;
+			}
+			index = m_queued[m_queuedHead];
+			m_queuedHead = (m_queuedHead + 1) % m_capacity;
+			m_queuedCount--;
+		}
+
+		Request &request = m_requests[index];
+		request.ok = WriteFile(request);
+		FinishFile(request);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finished[(m_finishedHead + m_finishedCount) % m_capacity] = index;
+			m_finishedCount++;
+		}
+		m_finishedAvailable.notify_one();
+	}
+}
+
+
+bool FrameWriter::WriteFile(Request &request) {
+	while (request.written < request.writeSize) {
+		size_t part = std::min(request.writeSize - request.written, MAX_WRITE);
+	#ifdef _WIN32
+		int result = _write(request.fd, request.data + request.written, static_cast<unsigned int>(part));
+	#else
+		ssize_t result = pwrite(request.fd, request.data + request.written, part, static_cast<off_t>(request.written));
+	#endif
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+	#ifdef __linux__
+		// memory that cannot be pinned (some driver mappings) or file system that refuses direct write, rest goes through cache
+		if (result < 0 && request.direct && (errno == EINVAL || errno == EFAULT)) {
+			fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) & ~O_DIRECT);
+			request.direct = false;
+			request.directFailed = true;
+			request.writeSize = request.size;
+			continue;
+		}
+	#endif
+		if (result <= 0) {
+			return false;
+		}
+		request.written += static_cast<size_t>(result);
+	}
+	return true;
+}
+
+
+#ifdef VR_HAS_IO_URING
+
+bool FrameWriter::InitRing(uint32_t slotCount) {
+	io_uring_params params{};
+	m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, m_capacity, &params));
+	if (m_ringFd < 0) {
+		return false;
+	}
+
+	// rings share one mapping on kernels that support it
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMap) {
+		m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+	}
+
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+	m_cqRing = singleMap ? m_sqRing : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+	if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || m_sqes == MAP_FAILED) {
+		int error = errno;
+		DestroyRing();
+		errno = error;
+		return false;
+	}
+
+	uint8_t *sq = static_cast<uint8_t *>(m_sqRing);
+	uint8_t *cq = static_cast<uint8_t *>(m_cqRing);
+	m_sqHead = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+	m_sqTail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+	m_sqMask = reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+	m_sqArray = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+	m_cqHead = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+	m_cqTail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+	m_cqMask = reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+	m_cqes = cq + params.cq_off.cqes;
+
+	// empty table of fixed buffers, slots are filled when their memory is first written (needs linux 5.19)
+	m_fixedBuffers = false;
+#ifdef IORING_RSRC_REGISTER_SPARSE
+	if (slotCount != 0) {
+		io_uring_rsrc_register table{};
+		table.nr = slotCount;
+		table.flags = IORING_RSRC_REGISTER_SPARSE;
+		m_fixedBuffers = syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS2, &table, sizeof(table)) == 0;
+	}
+#endif
+	if (slotCount != 0 && !m_fixedBuffers) {
+		spdlog::warn("io_uring cannot register buffers, files are written without fixed buffers");
+	}
+	return true;
+}
+
+
+void FrameWriter::DestroyRing() {
+	if (m_sqes && m_sqes != MAP_FAILED) {
+		munmap(m_sqes, m_sqesSize);
+	}
+	if (m_cqRing && m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+		munmap(m_cqRing, m_cqRingSize);
+	}
+	if (m_sqRing && m_sqRing != MAP_FAILED) {
+		munmap(m_sqRing, m_sqRingSize);
+	}
+	m_sqes = m_cqRing = m_sqRing = nullptr;
+
+	// registered buffers are released with ring
+	if (m_ringFd >= 0) {
+		close(m_ringFd);
+		m_ringFd = -1;
+	}
+	m_fixedBuffers = false;
+}
+
+
+void FrameWriter::RegisterSlot(uint32_t slot, const void *data, size_t size) {
+	Slot &target = m_slots[slot];
+	target.data = data;
+	target.size = size;
+	target.registered = false;
+	if (!m_fixedBuffers) {
+		return;
+	}
+
+	// writes in flight keep memory they were queued with, slot can be replaced under them
+#ifdef IORING_RSRC_REGISTER_SPARSE
+	iovec memory{const_cast<void *>(data), size};
+	io_uring_rsrc_update2 update{};
+	update.offset = slot;
+	update.data = reinterpret_cast<uint64_t>(&memory);
+	update.nr = 1;
+	target.registered = syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == 1;
+#endif
+	if (!target.registered) {
+		// mapping that cannot be pinned or locked memory limit, kernel copies from it for every write instead
+		spdlog::warn("Buffer {} cannot be registered for io_uring ({}), it is written without fixed buffer", slot, std::strerror(errno));
+	}
+}
+
+
+void FrameWriter::QueueWrite(uint32_t index) {
+	Request &request = m_requests[index];
+	size_t part = std::min(request.writeSize - request.written, MAX_WRITE);
+	const uint8_t *data = request.data + request.written;
+
+	// fixed write only when whole part is inside registered memory
+	bool fixed = false;
+	if (request.slot < m_slots.size() && m_slots[request.slot].registered) {
+		const uint8_t *begin = static_cast<const uint8_t *>(m_slots[request.slot].data);
+		fixed = data >= begin && data + part <= begin + m_slots[request.slot].size;
+	}
+
+	// only this thread writes tail, kernel reads entries after it sees new tail
+	uint32_t tail = *m_sqTail;
+	uint32_t entry = tail & *m_sqMask;
+	io_uring_sqe &sqe = static_cast<io_uring_sqe *>(m_sqes)[entry];
+	std::memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	sqe.fd = request.fd;
+	sqe.addr = reinterpret_cast<uint64_t>(data);
+	sqe.len = static_cast<uint32_t>(part);
+	sqe.off = request.written;
+	sqe.buf_index = fixed ? static_cast<uint16_t>(request.slot) : 0;
+	sqe.user_data = index;
+	m_sqArray[entry] = entry;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	// submitted right away, so kernel writes while next frames render
+	// entry that was not submitted stays in ring and goes with next enter
+	uint32_t pending = tail + 1 - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+	while (syscall(__NR_io_uring_enter, m_ringFd, pending, 0, 0, nullptr, 0) < 0 && errno == EINTR) {
+	}
+}
+
+
+uint32_t FrameWriter::ReapRing(bool wait) {
+	io_uring_cqe *cqes = static_cast<io_uring_cqe *>(m_cqes);
+	uint32_t delivered = 0;
+	for (;;) {
+		uint32_t head = *m_cqHead;
+		if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+			if (!wait || delivered != 0 || GetInFlight() == 0) {
+				break;
+			}
+			uint32_t pending = *m_sqTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+			if (syscall(__NR_io_uring_enter, m_ringFd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+				spdlog::error("io_uring wait failed: {}", std::strerror(errno));
+				break;
+			}
+			continue;
+		}
+
+		io_uring_cqe &cqe = cqes[head & *m_cqMask];
+		uint32_t index = static_cast<uint32_t>(cqe.user_data);
+		int result = cqe.res;
+		__atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+
+		Request &request = m_requests[index];
+		if (result == -EINTR || result == -EAGAIN) {
+			QueueWrite(index);
+			continue;
+		}
+		if (result < 0 && request.direct && (result == -EINVAL || result == -EFAULT)) {
+			// same fallback as pwrite backend, rest of file goes through page cache
+			fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) & ~O_DIRECT);
+			request.direct = false;
+			request.directFailed = true;
+			request.writeSize = request.size;
+			QueueWrite(index);
+			continue;
+		}
+		if (result > 0) {
+			request.written += static_cast<size_t>(result);
+			if (request.written < request.writeSize) {
+				QueueWrite(index);  // short write, rest is queued again
+				continue;
+			}
+		}
+
+		request.ok = result >= 0 && request.written >= request.writeSize;
+		FinishFile(request);
+		Complete(index);
+		delivered++;
+	}
+	return delivered;
+}
+
+#endif
+
+
+bool vkutils::BenchmarkFrameWriters(const std::string &directory, size_t frameSize, uint32_t frameCount, uint32_t threadCount, BenchmarkReport &report) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// aligned like mapped staging buffers, so direct io can be used
+	const uint32_t bufferCount = 4;
+	size_t readable = AlignUp(frameSize, FrameWriter::DIRECT_ALIGNMENT);
+	std::vector<uint8_t *> buffers(bufferCount);
+	for (uint32_t b = 0; b != bufferCount; ++b) {
+		buffers[b] = static_cast<uint8_t *>(::operator new(readable, std::align_val_t(FrameWriter::DIRECT_ALIGNMENT)));
+		for (size_t i = 0; i != readable; ++i) {
+			buffers[b][i] = static_cast<uint8_t>(i * 31 + b);
+		}
+	}
+
+	std::vector<std::string> paths(frameCount);
+	for (uint32_t f = 0; f != frameCount; ++f) {
+		paths[f] = fmt::format("{}/writer_benchmark_{:03}.raw", directory, f);
+	}
+
+	struct Variant {
+		vr::WriteBackend backend;
+		bool             direct;
+	};
+	const Variant variants[] = {
+		{vr::WriteBackend::Pwrite, false},
+		{vr::WriteBackend::Pwrite, true},
+		{vr::WriteBackend::IoUring, false},
+		{vr::WriteBackend::IoUring, true},
+	};
+
+	bool written = true;
+	for (const Variant &variant : variants) {
+		bool busy[bufferCount] = {};
+		bool ok = true;
+		FrameWriter writer;
+		writer.Init(variant.backend, variant.direct, threadCount, bufferCount, bufferCount, [&](uint64_t tag, bool fileOk) {
+			busy[tag] = false;
+			ok &= fileOk;
+		});
+		if (writer.GetBackend() != variant.backend || writer.IsDirect() != variant.direct) {
+			writer.Destroy();
+			continue;  // fallback was logged
+		}
+
+		// every buffer is written again when its previous file is done, like readback buffers
+		auto start = std::chrono::steady_clock::now();
+		uint32_t submitted = 0;
+		for (; submitted != frameCount && ok; ++submitted) {
+			uint32_t b = submitted % bufferCount;
+			while (busy[b]) {
+				writer.Poll(true);
+			}
+			busy[b] = true;
+			if (!writer.Submit(paths[submitted].c_str(), buffers[b], frameSize, readable, b, b)) {
+				busy[b] = false;
+				ok = false;
+			}
+		}
+		writer.Flush();
+		double writtenSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		bool direct = writer.IsDirect();
+		writer.Destroy();
+
+		// cached writes can still be in page cache, time until they reach disk is what disk sustains
+	#ifndef _WIN32
+		for (uint32_t f = 0; f != submitted; ++f) {
+			int fd = open(paths[f].c_str(), O_WRONLY | O_CLOEXEC);
+			if (fd >= 0) {
+				fsync(fd);
+				close(fd);
+			}
+		}
+	#endif
+		double syncedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (uint32_t f = 0; f != submitted; ++f) {
+			std::filesystem::remove(paths[f], error);
+		}
+
+		if (!ok) {
+			spdlog::error("Frame writer {}: failed to write benchmark files to {}", WriteBackendName(variant.backend), directory);
+			written = false;
+			continue;
+		}
+		if (direct != variant.direct) {
+			continue;  // file system does not support direct io, same as cached writes
+		}
+		double bytes = static_cast<double>(frameSize) * submitted;
+		std::string name = fmt::format("frame_writer.{}{}", WriteBackendName(variant.backend), direct ? "_direct" : "");
+		report.host.push_back({name + ".written", static_cast<float>(bytes / writtenSeconds / 1e9), "GB/s"});
+		report.host.push_back({name + ".disk", static_cast<float>(bytes / syncedSeconds / 1e9), "GB/s"});
+		spdlog::info("Frame writer {}{}: {} files of {:.1f} MB, {:.2f} GB/s written, {:.2f} GB/s on disk", WriteBackendName(variant.backend),
+			direct ? " (direct)" : "", submitted, frameSize / 1e6, bytes / writtenSeconds / 1e9, bytes / syncedSeconds / 1e9);
+	}
+
+	for (uint8_t *buffer : buffers) {
+		::operator delete(buffer, std::align_val_t(FrameWriter::DIRECT_ALIGNMENT));
+	}
+	return written;
+}
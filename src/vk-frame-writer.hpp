@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vk-config.hpp>
+#include <vk-benchmark.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define VR_HAS_IO_URING
+#endif
+#endif
+
+namespace vr {
+	// writes whole files from memory in background, memory has to stay valid until completion of its file
+	// io_uring backend (linux) queues writes to kernel from calling thread, memory of slots is registered once,
+	// so kernel does not map pages again for every write; pwrite backend writes on its own threads
+	// files are opened on calling thread, completions are delivered by Poll on calling thread
+	class FrameWriter final {
+	public:
+		// tag of submitted file and whether all of it was written
+		using Completion = std::function<void(uint64_t tag, bool ok)>;
+
+		struct Stats {
+			uint64_t files = 0;
+			uint64_t bytes = 0;
+			uint64_t failed = 0;
+			uint32_t inFlight = 0;
+			uint32_t capacity = 0;
+		};
+
+		static constexpr uint32_t NO_SLOT = ~0u;
+		static constexpr size_t   DIRECT_ALIGNMENT = 4096;  // of memory and size of O_DIRECT writes
+
+		// capacity is largest number of files in flight, slots are buffers that are written many times (readback buffers)
+		// io_uring falls back to pwrite when kernel does not allow it, direct io falls back to cached writes
+		// (for all later files once direct write of memory fails)
+		bool Init(WriteBackend backend, bool directIo, uint32_t threadCount, uint32_t capacity, uint32_t slotCount, Completion &&completion);
+		void Destroy();  // waits for files in flight
+		bool IsInitialized() const { return m_initialized; }
+
+		WriteBackend GetBackend() const { return m_backend; }
+		bool IsDirect() const { return m_directIo; }
+
+		// writes size bytes of data to new file at path, readable is size of memory at data (direct writes are rounded up to it)
+		// data is in slot (or NO_SLOT), slot that gets other memory is registered again
+		// returns false if file could not be opened or writer is full, completion is not called then
+		bool Submit(const char *path, const void *data, size_t size, size_t readable, uint32_t slot, uint64_t tag);
+
+		// delivers finished files, with wait blocks until at least one finishes (if any is in flight)
+		uint32_t Poll(bool wait);
+		void Flush();
+
+		uint32_t GetInFlight() const { return m_capacity - static_cast<uint32_t>(m_freeRequests.size()); }
+		Stats GetStats() const;
+
+	private:
+		struct Request {
+			int            fd = -1;
+			const uint8_t *data = nullptr;
+			size_t         size = 0;       // of file
+			size_t         writeSize = 0;  // size rounded up for direct writes
+			size_t         written = 0;
+			uint32_t       slot = NO_SLOT;
+			uint64_t       tag = 0;
+			bool           direct = false;
+			bool           preallocated = false;  // file was grown to rounded size, so it is truncated to size at end
+			bool           directFailed = false;  // direct write was refused and rest went through cache
+			bool           ok = false;
+		};
+
+		struct Slot {
+			const void *data = nullptr;
+			size_t      size = 0;
+			bool        registered = false;
+		};
+
+		int  OpenFile(const char *path, size_t size, size_t readable, const void *data, bool &direct);
+		void FinishFile(Request &request);
+		void Complete(uint32_t index);
+
+		// pwrite backend
+		void WriteLoop();
+		bool WriteFile(Request &request);
+
+	#ifdef VR_HAS_IO_URING
+		bool InitRing(uint32_t slotCount);
+		void DestroyRing();
+		void RegisterSlot(uint32_t slot, const void *data, size_t size);
+		void QueueWrite(uint32_t index);
+		uint32_t ReapRing(bool wait);
+	#endif
+
+	private:
+		bool         m_initialized = false;
+		WriteBackend m_backend = WriteBackend::Pwrite;
+		bool         m_directIo = false;
+		Completion   m_completion;
+		uint32_t     m_capacity = 0;
+
+		std::vector<Request>  m_requests;
+		std::vector<uint32_t> m_freeRequests;  // calling thread only
+		std::vector<Slot>     m_slots;
+
+		// pwrite backend, requests go to threads and come back finished
+		std::vector<std::thread> m_threads;
+		std::vector<uint32_t>    m_queued;    // circular queues of capacity
+		std::vector<uint32_t>    m_finished;
+		uint32_t                 m_queuedHead = 0;
+		uint32_t                 m_queuedCount = 0;
+		uint32_t                 m_finishedHead = 0;
+		uint32_t                 m_finishedCount = 0;
+		std::mutex               m_mutex;
+		std::condition_variable  m_queuedAvailable;
+		std::condition_variable  m_finishedAvailable;
+		bool                     m_stopping = false;
+
+	#ifdef VR_HAS_IO_URING
+		int       m_ringFd = -1;
+		void     *m_sqRing = nullptr;
+		void     *m_cqRing = nullptr;
+		size_t    m_sqRingSize = 0;
+		size_t    m_cqRingSize = 0;
+		void     *m_sqes = nullptr;
+		size_t    m_sqesSize = 0;
+		uint32_t *m_sqHead = nullptr;
+		uint32_t *m_sqTail = nullptr;
+		uint32_t *m_sqMask = nullptr;
+		uint32_t *m_sqArray = nullptr;
+		uint32_t *m_cqHead = nullptr;
+		uint32_t *m_cqTail = nullptr;
+		uint32_t *m_cqMask = nullptr;
+		void     *m_cqes = nullptr;
+		bool      m_fixedBuffers = false;  // sparse buffer table was registered
+	#endif
+
+		uint64_t m_files = 0;
+		uint64_t m_bytes = 0;
+		uint64_t m_failed = 0;
+	};
+}
+
+namespace vkutils {
+	// writes frameCount files of frameSize bytes to directory with every backend (with and without direct io)
+	// and adds GB/s until files are closed and until they are on disk to report, files are removed afterwards
+	// returns false (and logs error) if files could not be written
+	bool BenchmarkFrameWriters(const std::string &directory, size_t frameSize, uint32_t frameCount, uint32_t threadCount, vr::BenchmarkReport &report);
+}
@@ -0,0 +1,219 @@
+#include <vk-gpu-profiler.hpp>
+
+#include <algorithm>
+
+using namespace vr;
+
+
+static const uint32_t DEFAULT_HISTORY_SIZE = 256;
+
+
+void GpuProfiler::Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t frameSlots, const std::string &exportPath) {
+	m_device = device;
+	SetHistorySize(DEFAULT_HISTORY_SIZE);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+	if (validBits == 0) {
+		spdlog::warn("Queue does not support timestamps, GPU profiler is disabled");
+		return;
+	}
+	m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = QUERY_COUNT;
+
+	m_slots.resize(frameSlots);
+	for (auto &slot : m_slots) {
+		VK_CHECK(vkCreateQueryPool(m_device, &poolInfo, nullptr, &slot.queryPool));
+	}
+
+	if (!exportPath.empty()) {
+		m_exportFile = std::fopen(exportPath.c_str(), "w");
+		if (!m_exportFile) {
+			spdlog::error("failed to open GPU profile file: {}", exportPath);
+		}
+	}
+}
+
+
+void GpuProfiler::Destroy() {
+	for (auto &slot : m_slots) {
+		vkDestroyQueryPool(m_device, slot.queryPool, nullptr);
+	}
+	m_slots.clear();
+
+	if (m_exportFile) {
+		std::fclose(m_exportFile);
+		m_exportFile = nullptr;
+	}
+}
+
+
+void GpuProfiler::BeginFrame(uint32_t slotIndex, uint32_t frameNumber) {
+	BeginRecordedFrame(slotIndex, frameNumber, 0);
+}
+
+
+void GpuProfiler::BeginRecordedFrame(uint32_t slotIndex, uint32_t frameNumber, uint32_t writtenPhases) {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	Slot &slot = m_slots[slotIndex];
+	if (slot.pending) {
+		ReadResults(slot);
+	}
+
+	// fence of slot was waited, so no queue uses queries anymore (hostQueryReset)
+	vkResetQueryPool(m_device, slot.queryPool, 0, QUERY_COUNT);
+
+	slot.frameNumber = frameNumber;
+	slot.writtenPhases = writtenPhases;
+	slot.pending = true;
+}
+
+
+void GpuProfiler::BeginPhase(VkCommandBuffer cmd, uint32_t slotIndex, GpuPhase phase) {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	// timestamp is written when all previous commands are finished
+	uint32_t p = static_cast<uint32_t>(phase);
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_slots[slotIndex].queryPool, p * 2);
+}
+
+
+void GpuProfiler::EndPhase(VkCommandBuffer cmd, uint32_t slotIndex, GpuPhase phase) {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	uint32_t p = static_cast<uint32_t>(phase);
+	Slot &slot = m_slots[slotIndex];
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, slot.queryPool, p * 2 + 1);
+	slot.writtenPhases |= 1u << p;
+}
+
+
+void GpuProfiler::ReadResults(Slot &slot) {
+	slot.pending = false;
+	if (slot.writtenPhases == 0) {
+		return;
+	}
+
+	// value and availability of every query, phases that were not recorded are not available
+	std::array<uint64_t, QUERY_COUNT * 2> results{};
+	VkResult result = vkGetQueryPoolResults(m_device, slot.queryPool, 0, QUERY_COUNT, sizeof(results), results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		return;
+	}
+
+	if (m_exportFile) {
+		std::fprintf(m_exportFile, "{\"frame\":%u", slot.frameNumber);
+	}
+
+	float frameMs = 0.0f;
+
+	for (uint32_t p = 0; p != PHASE_COUNT; ++p) {
+		const uint64_t *begin = &results[p * 4];
+		const uint64_t *end = &results[p * 4 + 2];
+		if ((slot.writtenPhases & (1u << p)) == 0 || begin[1] == 0 || end[1] == 0) {
+			continue;
+		}
+
+		float ms = static_cast<float>((end[0] - begin[0]) & m_timestampMask) * m_timestampPeriod / 1e6f;
+		frameMs += ms;
+
+		History &history = m_history[p];
+		uint32_t historySize = static_cast<uint32_t>(history.samples.size());
+		history.samples[history.next] = ms;
+		history.next = (history.next + 1) % historySize;
+		history.count = std::min(history.count + 1, historySize);
+
+		if (m_exportFile) {
+			std::fprintf(m_exportFile, ",\"%s_ms\":%.4f", PhaseName(static_cast<GpuPhase>(p)), ms);
+		}
+	}
+
+	if (m_exportFile) {
+		std::fputs("}\n", m_exportFile);
+	}
+
+	m_latestFrameMs = frameMs;
+	m_latestFrame = slot.frameNumber;
+}
+
+
+GpuPhaseStats GpuProfiler::GetStats(GpuPhase phase) const {
+	const History &history = m_history[static_cast<uint32_t>(phase)];
+
+	GpuPhaseStats stats;
+	stats.samples = history.count;
+	if (history.count == 0) {
+		return stats;
+	}
+
+	// sorted copy, so percentile can be picked directly
+	std::copy(history.samples.begin(), history.samples.begin() + history.count, m_sorted.begin());
+	std::sort(m_sorted.begin(), m_sorted.begin() + history.count);
+
+	float sum = 0.0f;
+	for (uint32_t i = 0; i != history.count; ++i) {
+		sum += m_sorted[i];
+	}
+
+	stats.minMs = m_sorted[0];
+	stats.avgMs = sum / history.count;
+	stats.p99Ms = m_sorted[std::min(history.count - 1, history.count * 99 / 100)];
+	return stats;
+}
+
+
+void GpuProfiler::ReadPending() {
+	for (auto &slot : m_slots) {
+		if (slot.pending) {
+			ReadResults(slot);
+		}
+	}
+}
+
+
+void GpuProfiler::SetHistorySize(uint32_t historySize) {
+	historySize = std::max(historySize, 1u);
+	for (auto &history : m_history) {
+		history.samples.assign(historySize, 0.0f);
+	}
+	m_sorted.assign(historySize, 0.0f);
+	ResetStats();
+}
+
+
+void GpuProfiler::ResetStats() {
+	for (auto &history : m_history) {
+		history.count = 0;
+		history.next = 0;
+	}
+}
+
+
+const char *GpuProfiler::PhaseName(GpuPhase phase) {
+	switch (phase) {
+		case GpuPhase::Compute:  return "compute";
+		case GpuPhase::Resolve:  return "resolve";
+		case GpuPhase::Imgui:    return "imgui";
+		case GpuPhase::Readback: return "readback";
+		default:                 return "unknown";
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vk-types.hpp>
+
+#include <array>
+#include <cstdio>
+
+namespace vr {
+	// parts of frame that are timed on gpu
+	enum class GpuPhase : uint32_t {
+		Compute,   // effect dispatch
+		Resolve,   // render image to swapchain image (skipped when effect writes swapchain directly)
+		Imgui,     // overlay
+		Readback,  // render image to readback staging buffer (headless output, screenshots)
+		Count,
+	};
+
+	struct GpuPhaseStats {
+		uint32_t samples = 0;
+		float    minMs = 0.0f;
+		float    avgMs = 0.0f;
+		float    p99Ms = 0.0f;
+	};
+
+	// timestamp queries around frame phases, one query pool per frame slot
+	// results are read when frame slot is reused (its fence is already signalled), so reading never stalls
+	class GpuProfiler final {
+	public:
+		// exportPath is file for JSON lines with timings of every frame (empty disables export)
+		void Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t frameSlots, const std::string &exportPath);
+		void Destroy();
+
+		// reads timings that slot recorded last time and resets its queries on host, call after slot fence was waited
+		// (before recording, queries are not reset in command buffers, so graphics and compute queue can both write them)
+		void BeginFrame(uint32_t slot, uint32_t frameNumber);
+
+		// same for command buffer that was recorded earlier, it already writes phases
+		void BeginRecordedFrame(uint32_t slot, uint32_t frameNumber, uint32_t writtenPhases);
+		uint32_t GetWrittenPhases(uint32_t slot) const { return IsEnabled() ? m_slots[slot].writtenPhases : 0; }
+		void BeginPhase(VkCommandBuffer cmd, uint32_t slot, GpuPhase phase);
+		void EndPhase(VkCommandBuffer cmd, uint32_t slot, GpuPhase phase);
+
+		// reads slots that were not reused yet, call when device is idle
+		void ReadPending();
+
+		// statistics over last historySize frames (256 by default)
+		GpuPhaseStats GetStats(GpuPhase phase) const;
+		void SetHistorySize(uint32_t historySize);
+		void ResetStats();
+		bool IsEnabled() const { return !m_slots.empty(); }
+
+		// total time of all phases of last frame that was read (zero if nothing was read yet)
+		float GetLatestFrameMs(uint32_t &frameNumber) const { frameNumber = m_latestFrame; return m_latestFrameMs; }
+
+		static const char *PhaseName(GpuPhase phase);
+
+	private:
+		static constexpr uint32_t PHASE_COUNT = static_cast<uint32_t>(GpuPhase::Count);
+		static constexpr uint32_t QUERY_COUNT = PHASE_COUNT * 2;  // begin and end of every phase
+
+		struct Slot {
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			uint32_t    frameNumber = 0;
+			uint32_t    writtenPhases = 0;  // bit per phase that was recorded
+			bool        pending = false;
+		};
+
+		// ring of recent durations
+		struct History {
+			std::vector<float> samples;
+			uint32_t           count = 0;
+			uint32_t           next = 0;
+		};
+
+		void ReadResults(Slot &slot);
+
+	private:
+		VkDevice          m_device = VK_NULL_HANDLE;
+		std::vector<Slot> m_slots;
+		float             m_timestampPeriod = 1.0f;  // nanoseconds per tick
+		uint64_t          m_timestampMask = ~0ull;   // timestamps can have less than 64 valid bits
+
+		float                            m_latestFrameMs = 0.0f;
+		uint32_t                         m_latestFrame = 0;
+		std::array<History, PHASE_COUNT> m_history;
+		mutable std::vector<float>       m_sorted;  // scratch for percentiles, allocated once
+		std::FILE                       *m_exportFile = nullptr;
+	};
+}
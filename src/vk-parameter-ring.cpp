@@ -0,0 +1,62 @@
+#include <vk-parameter-ring.hpp>
+
+#include <cstring>
+
+using namespace vr;
+
+
+void ParameterRing::Init(VkDevice device, VmaAllocator allocator, uint32_t frameSlots, VkDeviceSize slotSize) {
+	m_allocator = allocator;
+	m_slotSize = (slotSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_slotSize * frameSlots;
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+	// stays mapped, frame writes straight into it
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &m_buffer.buffer, &m_buffer.allocation, &m_buffer.info));
+
+	VkBufferDeviceAddressInfo addressInfo{};
+	addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	addressInfo.buffer = m_buffer.buffer;
+	m_address = vkGetBufferDeviceAddress(device, &addressInfo);
+	m_mapped = static_cast<uint8_t*>(m_buffer.info.pMappedData);
+
+	BeginFrame(0);
+}
+
+
+void ParameterRing::Destroy() {
+	if (m_buffer.buffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(m_allocator, m_buffer.buffer, m_buffer.allocation);
+		m_buffer = AllocatedBuffer{};
+	}
+}
+
+
+void ParameterRing::BeginFrame(uint32_t slot) {
+	m_offset = slot * m_slotSize;
+	m_end = m_offset + m_slotSize;
+}
+
+
+VkDeviceAddress ParameterRing::Push(const void *data, VkDeviceSize size) {
+	VkDeviceSize offset = (m_offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	if (offset + size > m_end) {
+		if (!m_reported) {
+			spdlog::error("Parameter ring is full ({} bytes per frame)", m_slotSize);
+			m_reported = true;
+		}
+		return 0;
+	}
+
+	std::memcpy(m_mapped + offset, data, size);
+	VK_CHECK(vmaFlushAllocation(m_allocator, m_buffer.allocation, offset, size));
+
+	m_offset = offset + size;
+	return m_address + offset;
+}
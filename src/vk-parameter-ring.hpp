@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vk-types.hpp>
+
+namespace vr {
+	// host visible buffer with device address, split into one part per frame slot
+	// frame copies its parameter blocks into its part, shaders read them through buffer references
+	// part is reused when slot comes around again, so nothing is allocated or written to descriptors per frame
+	class ParameterRing final {
+	public:
+		void Init(VkDevice device, VmaAllocator allocator, uint32_t frameSlots, VkDeviceSize slotSize);
+		void Destroy();
+
+		// starts filling part of slot, previous frame of slot has to be finished
+		void BeginFrame(uint32_t slot);
+
+		// copies data to part of current slot and returns its device address (0 if part is full)
+		VkDeviceAddress Push(const void *data, VkDeviceSize size);
+
+		VkDeviceSize GetSlotSize() const { return m_slotSize; }
+
+		// blocks are aligned for any buffer_reference_align up to this
+		static constexpr VkDeviceSize ALIGNMENT = 64;
+
+	private:
+		VmaAllocator    m_allocator = VK_NULL_HANDLE;
+		AllocatedBuffer m_buffer{};
+		VkDeviceAddress m_address = 0;
+		uint8_t        *m_mapped = nullptr;
+		VkDeviceSize    m_slotSize = 0;
+		VkDeviceSize    m_offset = 0;  // next free byte of current part
+		VkDeviceSize    m_end = 0;     // end of current part
+		bool            m_reported = false;
+	};
+}
@@ -0,0 +1,292 @@
+#include <vk-pipeline-cache.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace vr;
+
+
+static const uint32_t CACHE_FILE_MAGIC = 0x43504356;  // "VCPC"
+static const uint32_t CACHE_FILE_VERSION = 1;
+
+
+// FNV-1a, only used to detect truncated or corrupted files
+static uint64_t Checksum(const uint8_t *data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+
+void PipelineCache::Init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path) {
+	m_device = device;
+	m_path = path;
+	vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+	std::vector<uint8_t> data;
+	if (!m_path.empty() && ReadFile(data)) {
+		m_loadedSize = data.size();
+		spdlog::info("Pipeline cache loaded: {} ({} bytes)", m_path, data.size());
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	// driver may still reject data (it is allowed to), in this case start with empty cache
+	if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+		spdlog::warn("Pipeline cache data was rejected by driver, starting with empty cache");
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		m_loadedSize = 0;
+		VK_CHECK(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache));
+	}
+
+	m_savedSize = m_loadedSize;
+
+	if (!m_path.empty()) {
+		m_stopping = false;
+		m_saver = std::thread(&PipelineCache::SaveLoop, this);
+	}
+}
+
+
+void PipelineCache::Destroy() {
+	if (m_saver.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_requestMutex);
+			m_stopping = true;
+		}
+		m_requested.notify_one();
+		m_saver.join();
+	}
+
+	if (m_cache != VK_NULL_HANDLE) {
+		vkDestroyPipelineCache(m_device, m_cache, nullptr);
+		m_cache = VK_NULL_HANDLE;
+	}
+}
+
+
+bool PipelineCache::Save() {
+	if (m_cache == VK_NULL_HANDLE || m_path.empty()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> saveLock(m_saveMutex);
+
+	size_t liveSize = 0;
+	VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &liveSize, nullptr));
+	if (liveSize == m_savedSize) {
+		return true;  // nothing new was compiled
+	}
+
+	// merge needs exclusive access to its destination, while worker threads can build pipelines with live cache
+	// so live cache and file (another player could have saved its pipelines in the meantime) are merged into temporary one
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	VkPipelineCache mergedCache;
+	VK_CHECK(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &mergedCache));
+
+	VkPipelineCache sources[2] = {m_cache, VK_NULL_HANDLE};
+	uint32_t sourceCount = 1;
+
+	std::vector<uint8_t> diskData;
+	if (ReadFile(diskData)) {
+		cacheInfo.initialDataSize = diskData.size();
+		cacheInfo.pInitialData = diskData.data();
+		if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &sources[1]) == VK_SUCCESS) {
+			sourceCount = 2;
+		}
+	}
+
+	VkResult merged = vkMergePipelineCaches(m_device, mergedCache, sourceCount, sources);
+	if (sourceCount == 2) {
+		vkDestroyPipelineCache(m_device, sources[1], nullptr);
+	}
+	if (merged != VK_SUCCESS) {
+		vkDestroyPipelineCache(m_device, mergedCache, nullptr);
+		spdlog::error("Failed to merge pipeline cache: {}", string_VkResult(merged));
+		return false;
+	}
+
+	// temporary cache is not used by anyone else, so its size cannot change between the two calls
+	size_t dataSize = 0;
+	VK_CHECK(vkGetPipelineCacheData(m_device, mergedCache, &dataSize, nullptr));
+	std::vector<uint8_t> data(dataSize);
+	VK_CHECK(vkGetPipelineCacheData(m_device, mergedCache, &dataSize, data.data()));
+	data.resize(dataSize);
+	vkDestroyPipelineCache(m_device, mergedCache, nullptr);
+
+	FileHeader header = MakeHeader();
+	header.dataSize = data.size();
+	header.checksum = Checksum(data.data(), data.size());
+
+	// write to unique temporary file next to the cache and rename it over the old one
+	// rename is atomic, so readers see either old or new file, never a partial one
+	uint64_t uniqueId = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	std::string tmpPath = m_path + ".tmp" + std::to_string(uniqueId);
+
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			spdlog::error("Failed to write pipeline cache: {}", tmpPath);
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+		if (!file.good()) {
+			spdlog::error("Failed to write pipeline cache: {}", tmpPath);
+			file.close();
+			std::filesystem::remove(tmpPath);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, m_path, ec);
+	if (ec) {
+		spdlog::error("Failed to replace pipeline cache {}: {}", m_path, ec.message());
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	m_savedSize = liveSize;
+	spdlog::info("Pipeline cache saved: {} ({} bytes)", m_path, data.size());
+
+	return true;
+}
+
+
+void PipelineCache::SaveAsync() {
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_saveRequested = true;
+	}
+	m_requested.notify_one();
+}
+
+
+void PipelineCache::SaveLoop() {
+	std::unique_lock<std::mutex> lock(m_requestMutex);
+	for (;;) {
+		m_requested.wait(lock, [this]() { return m_saveRequested || m_stopping; });
+		if (!m_saveRequested) {
+			return;
+		}
+		m_saveRequested = false;
+
+		// file is read, merged and written without holding request lock
+		lock.unlock();
+		Save();
+		lock.lock();
+	}
+}
+
+
+bool PipelineCache::ReadFile(std::vector<uint8_t> &data) const {
+	std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(FileHeader)) {
+		spdlog::warn("Pipeline cache {} is truncated, ignoring it", m_path);
+		return false;
+	}
+
+	FileHeader header;
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (header.dataSize != fileSize - sizeof(FileHeader)) {
+		spdlog::warn("Pipeline cache {} is truncated, ignoring it", m_path);
+		return false;
+	}
+
+	data.resize(header.dataSize);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!file.good()) {
+		data.clear();
+		return false;
+	}
+
+	if (!IsCompatible(header, data)) {
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+bool PipelineCache::IsCompatible(const FileHeader &header, const std::vector<uint8_t> &data) const {
+	FileHeader expected = MakeHeader();
+
+	if (header.magic != expected.magic || header.version != expected.version) {
+		spdlog::warn("Pipeline cache {} has unknown format, ignoring it", m_path);
+		return false;
+	}
+
+	if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID) {
+		spdlog::info("Pipeline cache {} was created on different device, ignoring it", m_path);
+		return false;
+	}
+
+	if (header.driverVersion != expected.driverVersion) {
+		spdlog::info("Pipeline cache {} was created by different driver version, ignoring it", m_path);
+		return false;
+	}
+
+	if (std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		spdlog::info("Pipeline cache {} has different cache UUID, ignoring it", m_path);
+		return false;
+	}
+
+	if (header.checksum != Checksum(data.data(), data.size())) {
+		spdlog::warn("Pipeline cache {} is corrupted, ignoring it", m_path);
+		return false;
+	}
+
+	// vulkan's own header must match as well
+	VkPipelineCacheHeaderVersionOne vkHeader{};
+	if (data.size() < sizeof(vkHeader)) {
+		return false;
+	}
+	std::memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+
+	bool matches = vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		vkHeader.vendorID == m_properties.vendorID &&
+		vkHeader.deviceID == m_properties.deviceID &&
+		std::memcmp(vkHeader.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+	if (!matches) {
+		spdlog::warn("Pipeline cache {} has mismatching vulkan header, ignoring it", m_path);
+	}
+
+	return matches;
+}
+
+
+PipelineCache::FileHeader PipelineCache::MakeHeader() const {
+	FileHeader header{};
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.vendorID = m_properties.vendorID;
+	header.deviceID = m_properties.deviceID;
+	header.driverVersion = m_properties.driverVersion;
+	std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	return header;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vk-types.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace vr {
+	// VkPipelineCache that is stored on disk between runs
+	// file is ignored if it was written by different device or driver
+	// live cache is only read while saving, so pipelines can be built with it during save
+	class PipelineCache final {
+	public:
+		void Init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path);
+		void Destroy();  // waits for save in progress
+
+		// writes cache to disk if it has grown since last save
+		// write is atomic (temporary file + rename), so several players can share one file
+		bool Save();
+
+		// same as Save on background thread, render thread only wakes it up
+		void SaveAsync();
+
+		VkPipelineCache Get() const { return m_cache; }
+		bool IsWarm() const { return m_loadedSize > 0; }
+
+	private:
+		// header that is written in front of vulkan cache data
+		struct FileHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t checksum;
+		};
+
+		// reads file and returns vulkan cache data if it matches current device
+		bool ReadFile(std::vector<uint8_t> &data) const;
+		bool IsCompatible(const FileHeader &header, const std::vector<uint8_t> &data) const;
+		FileHeader MakeHeader() const;
+
+		void SaveLoop();
+
+	private:
+		VkDevice                   m_device = VK_NULL_HANDLE;
+		VkPipelineCache            m_cache = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties m_properties{};
+		std::string                m_path;
+		size_t                     m_loadedSize = 0;
+		size_t                     m_savedSize = 0;  // of live cache at last save
+
+		std::mutex                 m_saveMutex;  // one save at a time
+		std::thread                m_saver;
+		std::mutex                 m_requestMutex;
+		std::condition_variable    m_requested;
+		bool                       m_saveRequested = false;
+		bool                       m_stopping = false;
+	};
+}
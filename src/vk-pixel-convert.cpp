@@ -0,0 +1,516 @@
+#include <vk-pixel-convert.hpp>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include <glm/gtc/packing.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VR_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VR_TARGET_AVX2
+#else
+// only kernels that are selected at runtime use AVX2, rest of program stays baseline
+// (no FMA, so multiply and add round same as scalar table)
+#define VR_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#endif
+#endif
+
+using namespace vkutils;
+
+
+// every half value maps to one byte, so table replaces unpack, clamp, encode and round
+// sRGB table follows linear one, so gather can index both from one base
+struct HalfTables {
+	uint8_t linear[65536];
+	uint8_t srgb[65536];
+	uint8_t padding[4];  // gather reads 4 bytes at last index
+};
+
+static const HalfTables &GetHalfTables() {
+	static const std::unique_ptr<HalfTables> tables = []() {
+		auto t = std::make_unique<HalfTables>();
+		std::memset(t->padding, 0, sizeof(t->padding));
+		for (uint32_t h = 0; h != 65536; ++h) {
+			float v = glm::unpackHalf1x16(static_cast<uint16_t>(h));
+			v = v == v ? std::clamp(v, 0.0f, 1.0f) : 0.0f;  // NaN is black
+			float s = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+			t->linear[h] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+			t->srgb[h] = static_cast<uint8_t>(s * 255.0f + 0.5f);
+		}
+		return t;
+	}();
+	return *tables;
+}
+
+
+// rows of 8 bit pixels, count pixels of src are converted to dst
+// alpha is never sRGB encoded, bgra swaps red and blue
+static void ConvertRowScalar(const uint16_t *src, uint8_t *dst, uint32_t count, bool srgb, bool bgra) {
+	const HalfTables &tables = GetHalfTables();
+	const uint8_t *color = srgb ? tables.srgb : tables.linear;
+	const uint8_t *alpha = tables.linear;
+	uint32_t r = bgra ? 2 : 0;
+	uint32_t b = bgra ? 0 : 2;
+
+	for (uint32_t x = 0; x != count; ++x) {
+		const uint16_t *p = src + x * 4;
+		uint8_t *out = dst + x * 4;
+		out[r] = color[p[0]];
+		out[1] = color[p[1]];
+		out[b] = color[p[2]];
+		out[3] = alpha[p[3]];
+	}
+}
+
+
+#ifdef VR_CONVERT_X86
+
+// sign, exponent and mantissa are moved to float positions, multiply fixes exponent bias (and denormals)
+// negative values become 0 (they are clamped anyway), infinity and NaN keep their float encoding
+static __m128 HalfToFloatSse2(__m128i h) {
+	const __m128i em = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	__m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(em, 13)), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+	const __m128i infNan = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x7bff));
+	f = _mm_or_ps(f, _mm_and_ps(_mm_castsi128_ps(infNan), _mm_castsi128_ps(_mm_set1_epi32(0x7f800000))));
+	const __m128i positive = _mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), _mm_setzero_si128());
+	return _mm_and_ps(f, _mm_castsi128_ps(positive));
+}
+
+
+// one pixel, result is scaled to [0, 255] and truncated like scalar table
+template <bool Bgra>
+static __m128i EncodeSse2(__m128 v) {
+	// max returns second operand for NaN, so NaN is black
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	if (Bgra) {
+		v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+	}
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+
+template <bool Bgra>
+static void ConvertRowSse2(const uint16_t *src, uint8_t *dst, uint32_t count, bool, bool) {
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t x = 0;
+	for (; x + 4 <= count; x += 4) {
+		__m128i h01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+		__m128i h23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4 + 8));
+		__m128i p0 = EncodeSse2<Bgra>(HalfToFloatSse2(_mm_unpacklo_epi16(h01, zero)));
+		__m128i p1 = EncodeSse2<Bgra>(HalfToFloatSse2(_mm_unpackhi_epi16(h01, zero)));
+		__m128i p2 = EncodeSse2<Bgra>(HalfToFloatSse2(_mm_unpacklo_epi16(h23, zero)));
+		__m128i p3 = EncodeSse2<Bgra>(HalfToFloatSse2(_mm_unpackhi_epi16(h23, zero)));
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), bytes);
+	}
+	ConvertRowScalar(src + x * 4, dst + x * 4, count - x, false, Bgra);
+}
+
+
+template <bool Bgra>
+VR_TARGET_AVX2 static __m256i EncodeAvx2(__m256 v) {
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	if (Bgra) {
+		v = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));  // 128 bit lanes are pixels
+	}
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+
+// 8 encoded pixels in 32 bit channels, packs work in 128 bit lanes, so pixels come out as 0 2 4 6 1 3 5 7
+VR_TARGET_AVX2 static void StorePixelsAvx2(uint8_t *dst, __m256i p01, __m256i p23, __m256i p45, __m256i p67) {
+	__m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_packs_epi32(p45, p67));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+}
+
+
+template <bool Bgra>
+VR_TARGET_AVX2 static void ConvertRowAvx2(const uint16_t *src, uint8_t *dst, uint32_t count, bool, bool) {
+	uint32_t x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m128i *h = reinterpret_cast<const __m128i*>(src + x * 4);
+		StorePixelsAvx2(dst + x * 4,
+			EncodeAvx2<Bgra>(_mm256_cvtph_ps(_mm_loadu_si128(h + 0))),
+			EncodeAvx2<Bgra>(_mm256_cvtph_ps(_mm_loadu_si128(h + 1))),
+			EncodeAvx2<Bgra>(_mm256_cvtph_ps(_mm_loadu_si128(h + 2))),
+			EncodeAvx2<Bgra>(_mm256_cvtph_ps(_mm_loadu_si128(h + 3))));
+	}
+	ConvertRowScalar(src + x * 4, dst + x * 4, count - x, false, Bgra);
+}
+
+
+// sRGB curve is cheaper to look up than to compute, table is exact and gather looks up 8 channels at once
+template <bool Bgra>
+VR_TARGET_AVX2 static __m256i GatherSrgbAvx2(const int *tables, __m128i halves) {
+	// color channels index sRGB table, alpha stays linear
+	const __m256i offset = _mm256_setr_epi32(65536, 65536, 65536, 0, 65536, 65536, 65536, 0);
+	__m256i index = _mm256_add_epi32(_mm256_cvtepu16_epi32(halves), offset);
+	if (Bgra) {
+		index = _mm256_shuffle_epi32(index, _MM_SHUFFLE(3, 0, 1, 2));
+	}
+	return _mm256_and_si256(_mm256_i32gather_epi32(tables, index, 1), _mm256_set1_epi32(0xff));
+}
+
+
+template <bool Bgra>
+VR_TARGET_AVX2 static void ConvertRowSrgbAvx2(const uint16_t *src, uint8_t *dst, uint32_t count, bool, bool) {
+	const int *tables = reinterpret_cast<const int*>(GetHalfTables().linear);
+	uint32_t x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m128i *h = reinterpret_cast<const __m128i*>(src + x * 4);
+		StorePixelsAvx2(dst + x * 4,
+			GatherSrgbAvx2<Bgra>(tables, _mm_loadu_si128(h + 0)),
+			GatherSrgbAvx2<Bgra>(tables, _mm_loadu_si128(h + 1)),
+			GatherSrgbAvx2<Bgra>(tables, _mm_loadu_si128(h + 2)),
+			GatherSrgbAvx2<Bgra>(tables, _mm_loadu_si128(h + 3)));
+	}
+	ConvertRowScalar(src + x * 4, dst + x * 4, count - x, true, Bgra);
+}
+
+
+// 4 pixels of 16 bit channels in two registers, returns their dot products with coefficients (32 bit)
+static __m128i Dot4Sse2(__m128i p01, __m128i p23, __m128i coefficients) {
+	__m128i d01 = _mm_madd_epi16(p01, coefficients);
+	__m128i d23 = _mm_madd_epi16(p23, coefficients);
+	d01 = _mm_add_epi32(d01, _mm_srli_epi64(d01, 32));
+	d23 = _mm_add_epi32(d23, _mm_srli_epi64(d23, 32));
+	return _mm_unpacklo_epi64(_mm_shuffle_epi32(d01, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(d23, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+
+// 8 pixels of upper and lower RGBA8 row, same integer math as scalar version
+static void YuvBlockSse2(const uint8_t *upper, const uint8_t *lower, uint8_t *lumaUpper, uint8_t *lumaLower, uint8_t *u, uint8_t *v) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lumaCoefficients = _mm_setr_epi16(47, 157, 16, 0, 47, 157, 16, 0);
+	const __m128i uCoefficients = _mm_setr_epi16(-26, -86, 112, 0, -26, -86, 112, 0);
+	const __m128i vCoefficients = _mm_setr_epi16(112, -102, -10, 0, 112, -102, -10, 0);
+
+	__m128i pixels[2][4];
+	const uint8_t *rows[2] = {upper, lower};
+	uint8_t *luma[2] = {lumaUpper, lumaLower};
+	for (uint32_t r = 0; r != 2; ++r) {
+		__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r]));
+		__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 16));
+		pixels[r][0] = _mm_unpacklo_epi8(lo, zero);
+		pixels[r][1] = _mm_unpackhi_epi8(lo, zero);
+		pixels[r][2] = _mm_unpacklo_epi8(hi, zero);
+		pixels[r][3] = _mm_unpackhi_epi8(hi, zero);
+
+		__m128i y0 = _mm_srai_epi32(_mm_add_epi32(Dot4Sse2(pixels[r][0], pixels[r][1], lumaCoefficients), _mm_set1_epi32(128)), 8);
+		__m128i y1 = _mm_srai_epi32(_mm_add_epi32(Dot4Sse2(pixels[r][2], pixels[r][3], lumaCoefficients), _mm_set1_epi32(128)), 8);
+		__m128i y = _mm_add_epi16(_mm_packs_epi32(y0, y1), _mm_set1_epi16(16));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(luma[r]), _mm_packus_epi16(y, y));
+	}
+
+	// sums of 2x2 pixels, two chroma samples per register
+	__m128i sums[4];
+	for (uint32_t i = 0; i != 4; ++i) {
+		__m128i s = _mm_add_epi16(pixels[0][i], pixels[1][i]);
+		sums[i] = _mm_add_epi16(s, _mm_srli_si128(s, 8));
+	}
+	__m128i s01 = _mm_unpacklo_epi64(sums[0], sums[1]);
+	__m128i s23 = _mm_unpacklo_epi64(sums[2], sums[3]);
+
+	__m128i cu = _mm_srai_epi32(_mm_add_epi32(Dot4Sse2(s01, s23, uCoefficients), _mm_set1_epi32(512)), 10);
+	__m128i cv = _mm_srai_epi32(_mm_add_epi32(Dot4Sse2(s01, s23, vCoefficients), _mm_set1_epi32(512)), 10);
+	__m128i c = _mm_add_epi16(_mm_packs_epi32(cu, cv), _mm_set1_epi16(128));
+	c = _mm_packus_epi16(c, c);
+	uint32_t packed[2] = {static_cast<uint32_t>(_mm_cvtsi128_si32(c)), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(c, 4)))};
+	std::memcpy(u, &packed[0], 4);
+	std::memcpy(v, &packed[1], 4);
+}
+
+#endif
+
+
+using RowKernel = void (*)(const uint16_t *src, uint8_t *dst, uint32_t count, bool srgb, bool bgra);
+
+static RowKernel GetRowKernel(ConvertKernel kernel, bool srgb, bool bgra) {
+#ifdef VR_CONVERT_X86
+	if (kernel == ConvertKernel::Avx2) {
+		return srgb ? (bgra ? ConvertRowSrgbAvx2<true> : ConvertRowSrgbAvx2<false>) : (bgra ? ConvertRowAvx2<true> : ConvertRowAvx2<false>);
+	}
+	// SSE2 has no gather, so sRGB stays with table
+	if (kernel == ConvertKernel::Sse2 && !srgb) {
+		return bgra ? ConvertRowSse2<true> : ConvertRowSse2<false>;
+	}
+#endif
+	return ConvertRowScalar;
+}
+
+
+static uint8_t LumaBt709(int r, int g, int b) {
+	return static_cast<uint8_t>(16 + ((47 * r + 157 * g + 16 * b + 128) >> 8));
+}
+
+
+// pixels [x, count) of two RGBA8 rows, count is even
+static void YuvBlockScalar(const uint8_t *upper, const uint8_t *lower, uint32_t x, uint32_t count, uint8_t *lumaUpper, uint8_t *lumaLower, uint8_t *u, uint8_t *v) {
+	for (; x != count; x += 2) {
+		int sumR = 0, sumG = 0, sumB = 0;
+		const uint8_t *rows[2] = {upper, lower};
+		uint8_t *luma[2] = {lumaUpper, lumaLower};
+		for (uint32_t r = 0; r != 2; ++r) {
+			for (uint32_t i = x; i != x + 2; ++i) {
+				const uint8_t *p = rows[r] + i * 4;
+				sumR += p[0];
+				sumG += p[1];
+				sumB += p[2];
+				luma[r][i] = LumaBt709(p[0], p[1], p[2]);
+			}
+		}
+
+		// sums are 4 pixels, so shift includes division by 4
+		u[x / 2] = static_cast<uint8_t>(128 + ((-26 * sumR - 86 * sumG + 112 * sumB + 512) >> 10));
+		v[x / 2] = static_cast<uint8_t>(128 + ((112 * sumR - 102 * sumG - 10 * sumB + 512) >> 10));
+	}
+}
+
+
+static void ConvertYuvRows(const PixelConversion &conversion, const void *src, size_t srcPitch, uint8_t *dst, uint32_t width, uint32_t height, uint32_t rowBegin, uint32_t rowEnd) {
+	RowKernel kernel = GetRowKernel(conversion.kernel, conversion.srgb, false);
+	uint32_t chromaWidth = (width + 1) / 2;
+	uint32_t chromaHeight = (height + 1) / 2;
+	uint8_t *planeY = dst;
+	uint8_t *planeU = planeY + static_cast<size_t>(width) * height;
+	uint8_t *planeV = planeU + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+	// rows are converted to RGBA8 in chunks on stack, chunk has one more pixel for odd width
+	const uint32_t chunkSize = 256;
+	alignas(16) uint8_t chunk[2][(chunkSize + 1) * 4];
+	uint8_t lumaScratch[2][chunkSize + 1];
+
+	// two rows at a time, last row is repeated when height is odd
+	for (uint32_t y0 = rowBegin; y0 < rowEnd; y0 += 2) {
+		uint32_t y1 = std::min(y0 + 1, height - 1);
+		const uint16_t *rows[2] = {
+			reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(src) + y0 * srcPitch),
+			reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(src) + y1 * srcPitch),
+		};
+		size_t c = static_cast<size_t>(y0 / 2) * chromaWidth;
+
+		for (uint32_t x = 0; x < width; x += chunkSize) {
+			uint32_t count = std::min(chunkSize, width - x);
+			kernel(rows[0] + x * 4, chunk[0], count, conversion.srgb, false);
+			kernel(rows[1] + x * 4, chunk[1], count, conversion.srgb, false);
+
+			// last pixel is duplicated at odd width
+			uint32_t evenCount = count;
+			if (count % 2 != 0) {
+				std::memcpy(chunk[0] + count * 4, chunk[0] + (count - 1) * 4, 4);
+				std::memcpy(chunk[1] + count * 4, chunk[1] + (count - 1) * 4, 4);
+				evenCount++;
+			}
+
+			uint32_t i = 0;
+		#ifdef VR_CONVERT_X86
+			if (conversion.kernel != ConvertKernel::Scalar) {
+				for (; i + 8 <= evenCount; i += 8) {
+					YuvBlockSse2(chunk[0] + i * 4, chunk[1] + i * 4, lumaScratch[0] + i, lumaScratch[1] + i, planeU + c + (x + i) / 2, planeV + c + (x + i) / 2);
+				}
+			}
+		#endif
+			YuvBlockScalar(chunk[0], chunk[1], i, evenCount, lumaScratch[0], lumaScratch[1], planeU + c + x / 2, planeV + c + x / 2);
+
+			// duplicated rows and pixels are not copied out
+			std::memcpy(planeY + static_cast<size_t>(y0) * width + x, lumaScratch[0], count);
+			if (y1 != y0) {
+				std::memcpy(planeY + static_cast<size_t>(y1) * width + x, lumaScratch[1], count);
+			}
+		}
+	}
+}
+
+
+static bool HasAvx2() {
+#if defined(VR_CONVERT_X86) && defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	bool f16c = (info[2] & (1 << 29)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!f16c || !osxsave || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(VR_CONVERT_X86)
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#else
+	return false;
+#endif
+}
+
+
+bool vkutils::IsConvertKernelSupported(ConvertKernel kernel) {
+	switch (kernel) {
+		case ConvertKernel::Scalar: return true;
+	#ifdef VR_CONVERT_X86
+		case ConvertKernel::Sse2:   return true;  // every x86 cpu that runs Vulkan has it
+		case ConvertKernel::Avx2: {
+			static const bool supported = HasAvx2();
+			return supported;
+		}
+	#endif
+		default:                    return false;
+	}
+}
+
+
+ConvertKernel vkutils::GetBestConvertKernel() {
+	for (ConvertKernel kernel : {ConvertKernel::Avx2, ConvertKernel::Sse2}) {
+		if (IsConvertKernelSupported(kernel)) {
+			return kernel;
+		}
+	}
+	return ConvertKernel::Scalar;
+}
+
+
+const char *vkutils::ConvertKernelName(ConvertKernel kernel) {
+	switch (kernel) {
+		case ConvertKernel::Scalar: return "scalar";
+		case ConvertKernel::Sse2:   return "sse2";
+		case ConvertKernel::Avx2:   return "avx2";
+		default:                    return "unknown";
+	}
+}
+
+
+const char *vkutils::PixelFormatName(PixelFormat format) {
+	switch (format) {
+		case PixelFormat::Rgba8:  return "rgba8";
+		case PixelFormat::Bgra8:  return "bgra8";
+		case PixelFormat::Yuv420: return "yuv420";
+		default:                  return "unknown";
+	}
+}
+
+
+size_t vkutils::GetConvertedSize(PixelFormat format, uint32_t width, uint32_t height) {
+	if (format == PixelFormat::Yuv420) {
+		size_t chroma = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+		return static_cast<size_t>(width) * height + chroma * 2;
+	}
+	return static_cast<size_t>(width) * height * 4;
+}
+
+
+void vkutils::ConvertPixelRows(const PixelConversion &conversion, const void *src, size_t srcPitch, uint8_t *dst, uint32_t width, uint32_t height, uint32_t rowBegin, uint32_t rowEnd) {
+	if (conversion.format == PixelFormat::Yuv420) {
+		ConvertYuvRows(conversion, src, srcPitch, dst, width, height, rowBegin, rowEnd);
+		return;
+	}
+
+	bool bgra = conversion.format == PixelFormat::Bgra8;
+	RowKernel kernel = GetRowKernel(conversion.kernel, conversion.srgb, bgra);
+	for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+		const uint16_t *row = reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(src) + y * srcPitch);
+		kernel(row, dst + static_cast<size_t>(y) * width * 4, width, conversion.srgb, bgra);
+	}
+}
+
+
+void vkutils::ConvertPixels(const PixelConversion &conversion, const void *src, size_t srcPitch, uint8_t *dst, uint32_t width, uint32_t height, vr::ParallelWorkers &workers) {
+	// few bands per thread, so threads that start late still get work; YUV bands start at even rows
+	uint32_t bands = workers.GetThreadCount() * 4;
+	uint32_t bandRows = std::max((height + bands - 1) / bands, 16u);
+	bandRows += bandRows % 2;
+
+	workers.Run((height + bandRows - 1) / bandRows, [&](uint32_t band) {
+		uint32_t rowBegin = band * bandRows;
+		ConvertPixelRows(conversion, src, srcPitch, dst, width, height, rowBegin, std::min(rowBegin + bandRows, height));
+	});
+}
+
+
+bool vkutils::BenchmarkPixelConversion(uint32_t width, uint32_t height, vr::ParallelWorkers &workers, vr::BenchmarkReport &report) {
+	using Clock = std::chrono::high_resolution_clock;
+	const uint32_t repeats = 5;  // best of runs
+
+	// values over whole range, with some out of range, negative, infinite and NaN values
+	std::vector<uint16_t> src(static_cast<size_t>(width) * height * 4);
+	uint32_t state = 1;
+	for (auto &h : src) {
+		state = state * 1664525u + 1013904223u;
+		float v = static_cast<float>(state >> 8) / static_cast<float>(1 << 24) * 1.2f - 0.1f;
+		h = (state & 0xff) == 0 ? static_cast<uint16_t>(0x7c00 | (state >> 24)) : glm::packHalf1x16(v);
+	}
+	size_t srcPitch = static_cast<size_t>(width) * 4 * sizeof(uint16_t);
+
+	// every kernel uses same arithmetic (sRGB curve is same table), so any difference is a bug
+	auto countDifferences = [](const std::vector<uint8_t> &result, const std::vector<uint8_t> &reference, int &maxDifference) {
+		size_t count = 0;
+		for (size_t i = 0; i != result.size(); ++i) {
+			int difference = std::abs(static_cast<int>(result[i]) - static_cast<int>(reference[i]));
+			maxDifference = std::max(maxDifference, difference);
+			count += difference != 0;
+		}
+		return count;
+	};
+
+	bool matches = true;
+	for (PixelFormat format : {PixelFormat::Rgba8, PixelFormat::Bgra8, PixelFormat::Yuv420}) {
+		for (bool srgb : {false, true}) {
+			size_t size = GetConvertedSize(format, width, height);
+			std::vector<uint8_t> reference(size);
+			std::vector<uint8_t> result(size);
+
+			auto measure = [&](ConvertKernel kernel, bool threads) {
+				PixelConversion conversion{format, srgb, kernel};
+				double best = 1e30;
+				for (uint32_t r = 0; r != repeats; ++r) {
+					auto start = Clock::now();
+					if (threads) {
+						ConvertPixels(conversion, src.data(), srcPitch, result.data(), width, height, workers);
+					} else {
+						ConvertPixelRows(conversion, src.data(), srcPitch, result.data(), width, height, 0, height);
+					}
+					best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+				}
+				return best;
+			};
+
+			double scalarMs = measure(ConvertKernel::Scalar, false);
+			std::swap(reference, result);
+
+			std::string name = fmt::format("pixel_conversion.{}{}", PixelFormatName(format), srgb ? "_srgb" : "");
+			report.host.push_back({name + ".scalar", static_cast<float>(scalarMs), "ms"});
+
+			std::string line = fmt::format("Pixel conversion {}x{} {}{}: scalar {:.2f} ms", width, height, PixelFormatName(format), srgb ? " srgb" : "", scalarMs);
+			int maxDifference = 0;
+			for (ConvertKernel kernel : {ConvertKernel::Sse2, ConvertKernel::Avx2}) {
+				if (!IsConvertKernelSupported(kernel)) {
+					continue;
+				}
+				double ms = measure(kernel, false);
+				if (size_t differences = countDifferences(result, reference, maxDifference)) {
+					spdlog::error("Pixel conversion {}{}: {} kernel differs from scalar kernel in {} bytes", PixelFormatName(format), srgb ? " srgb" : "",
+						ConvertKernelName(kernel), differences);
+					matches = false;
+				}
+				line += fmt::format(", {} {:.2f} ms ({:.1f}x)", ConvertKernelName(kernel), ms, scalarMs / ms);
+				report.host.push_back({name + "." + ConvertKernelName(kernel), static_cast<float>(ms), "ms"});
+			}
+
+			// row bands must give same bytes as whole frame (Yuv420 bands start at even rows)
+			double threadedMs = measure(GetBestConvertKernel(), true);
+			if (size_t differences = countDifferences(result, reference, maxDifference)) {
+				spdlog::error("Pixel conversion {}{}: row bands differ from scalar kernel in {} bytes", PixelFormatName(format), srgb ? " srgb" : "", differences);
+				matches = false;
+			}
+			line += fmt::format(", {} threads {:.2f} ms ({:.1f}x), max difference {}", workers.GetThreadCount(), threadedMs, scalarMs / threadedMs, maxDifference);
+			report.host.push_back({name + ".threads", static_cast<float>(threadedMs), "ms"});
+			spdlog::info("{}", line);
+		}
+	}
+	return matches;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vk-thread-pool.hpp>
+#include <vk-benchmark.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vkutils {
+	// 8 bit layouts that RGBA16F render image pixels are converted to for export
+	enum class PixelFormat {
+		Rgba8,
+		Bgra8,
+		Yuv420,  // planar Y, then U and V at half resolution rounded up, BT.709 limited range, chroma is average of 2x2 pixels
+	};
+
+	// instruction sets of conversion kernels, best supported one is picked at runtime
+	enum class ConvertKernel {
+		Scalar,  // table per half value, reference for others
+		Sse2,
+		Avx2,    // with F16C for half to float
+	};
+
+	struct PixelConversion {
+		PixelFormat   format = PixelFormat::Rgba8;
+		// encode values with sRGB curve (for effects that output linear values)
+		// otherwise values are clamped to [0, 1] and stored as they are, same as the blit to the UNORM swapchain
+		bool          srgb = false;
+		ConvertKernel kernel = ConvertKernel::Scalar;
+	};
+
+	ConvertKernel GetBestConvertKernel();
+	bool IsConvertKernelSupported(ConvertKernel kernel);
+	const char *ConvertKernelName(ConvertKernel kernel);
+	const char *PixelFormatName(PixelFormat format);
+
+	// bytes of converted frame, rows are tightly packed
+	size_t GetConvertedSize(PixelFormat format, uint32_t width, uint32_t height);
+
+	// converts rows [rowBegin, rowEnd) of frame on calling thread (rowBegin must be even for Yuv420)
+	void ConvertPixelRows(const PixelConversion &conversion, const void *src, size_t srcPitch, uint8_t *dst, uint32_t width, uint32_t height, uint32_t rowBegin, uint32_t rowEnd);
+
+	// whole frame, split into row bands on workers
+	void ConvertPixels(const PixelConversion &conversion, const void *src, size_t srcPitch, uint8_t *dst, uint32_t width, uint32_t height, vr::ParallelWorkers &workers);
+
+	// logs time of every kernel and of workers for every format and adds it to report
+	// returns false (and logs error) if any kernel or row band split gives other bytes than scalar kernel
+	bool BenchmarkPixelConversion(uint32_t width, uint32_t height, vr::ParallelWorkers &workers, vr::BenchmarkReport &report);
+}
@@ -0,0 +1,157 @@
+#include <vk-readback.hpp>
+
+using namespace vr;
+
+
+static const VkDeviceSize BUFFER_ALIGNMENT = 4096;
+
+
+void ReadbackRing::Init(VkDevice device, VmaAllocator allocator, uint32_t bufferCount) {
+	m_device = device;
+	m_allocator = allocator;
+	m_buffers = std::vector<Buffer>(bufferCount);
+	m_pending.assign(bufferCount, 0);
+	m_pendingHead = 0;
+	m_pendingCount = 0;
+}
+
+
+void ReadbackRing::Destroy() {
+	for (auto &buffer : m_buffers) {
+		if (buffer.buffer.buffer != VK_NULL_HANDLE) {
+			vmaDestroyBuffer(m_allocator, buffer.buffer.buffer, buffer.buffer.allocation);
+		}
+	}
+	m_buffers.clear();
+	m_pendingCount = 0;
+}
+
+
+uint32_t ReadbackRing::AddConsumer(Consumer &&consumer) {
+	m_consumers.push_back(std::move(consumer));
+	return 1u << (m_consumers.size() - 1);
+}
+
+
+bool ReadbackRing::CanRecord() const {
+	for (auto &buffer : m_buffers) {
+		if (buffer.holds.load(std::memory_order_acquire) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool ReadbackRing::Record(VkCommandBuffer cmd, VkImage image, VkFormat format, uint32_t bytesPerPixel, VkExtent2D extent, uint32_t frameNumber, uint64_t timelineValue, uint32_t consumers) {
+	// buffers are tried round robin, so one that consumer just released is not reused right away
+	uint32_t count = static_cast<uint32_t>(m_buffers.size());
+	Buffer *free = nullptr;
+	for (uint32_t i = 0; i != count && !free; ++i) {
+		uint32_t index = (m_next + i) % count;
+		if (m_buffers[index].holds.load(std::memory_order_acquire) == 0) {
+			free = &m_buffers[index];
+			m_next = (index + 1) % count;
+		}
+	}
+
+	if (!free) {
+		m_dropped++;
+		return false;
+	}
+
+	uint32_t index = static_cast<uint32_t>(free - m_buffers.data());
+	size_t rowPitch = static_cast<size_t>(extent.width) * bytesPerPixel;
+	VkDeviceSize size = (rowPitch * extent.height + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+
+	// buffer grows when image gets bigger, it is idle because nothing holds it
+	if (free->size < size) {
+		if (free->buffer.buffer != VK_NULL_HANDLE) {
+			vmaDestroyBuffer(m_allocator, free->buffer.buffer, free->buffer.allocation);
+		}
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		// cached host memory, cpu reads every byte
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &free->buffer.buffer, &free->buffer.allocation, &free->buffer.info));
+		free->size = size;
+	}
+
+	VkBufferImageCopy copyRegion{};
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageExtent = {extent.width, extent.height, 1};
+	vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, free->buffer.buffer, 1, &copyRegion);
+
+	free->holds.store(1, std::memory_order_relaxed);
+	free->image = {index, free->buffer.info.pMappedData, extent.width, extent.height, rowPitch, format, frameNumber, static_cast<size_t>(free->size)};
+	free->timelineValue = timelineValue;
+	free->consumers = consumers;
+
+	m_pending[(m_pendingHead + m_pendingCount) % count] = index;
+	m_pendingCount++;
+	return true;
+}
+
+
+void ReadbackRing::Poll(uint64_t completedValue) {
+	uint32_t count = static_cast<uint32_t>(m_buffers.size());
+	while (m_pendingCount != 0) {
+		Buffer &buffer = m_buffers[m_pending[m_pendingHead]];
+		if (buffer.timelineValue > completedValue) {
+			break;  // copies finish in submit order
+		}
+		m_pendingHead = (m_pendingHead + 1) % count;
+		m_pendingCount--;
+
+		VK_CHECK(vmaInvalidateAllocation(m_allocator, buffer.buffer.allocation, 0, VK_WHOLE_SIZE));
+
+		for (uint32_t c = 0; c != m_consumers.size(); ++c) {
+			if (buffer.consumers & (1u << c)) {
+				m_consumers[c](buffer.image);
+			}
+		}
+		m_delivered++;
+
+		// hold of ring, consumers that retained buffer keep it
+		Release(buffer.image.buffer);
+	}
+}
+
+
+uint64_t ReadbackRing::GetOldestPendingValue() const {
+	return m_pendingCount != 0 ? m_buffers[m_pending[m_pendingHead]].timelineValue : 0;
+}
+
+
+void ReadbackRing::Retain(uint32_t buffer) {
+	m_buffers[buffer].holds.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void ReadbackRing::Release(uint32_t buffer) {
+	// release orders reads of consumer before next copy to buffer
+	m_buffers[buffer].holds.fetch_sub(1, std::memory_order_release);
+}
+
+
+ReadbackRing::Stats ReadbackRing::GetStats() const {
+	Stats stats;
+	stats.buffers = static_cast<uint32_t>(m_buffers.size());
+	stats.pending = m_pendingCount;
+	for (auto &buffer : m_buffers) {
+		if (buffer.holds.load(std::memory_order_relaxed) != 0) {
+			stats.held++;
+		}
+	}
+	stats.held -= m_pendingCount;
+	stats.delivered = m_delivered;
+	stats.dropped = m_dropped;
+	return stats;
+}
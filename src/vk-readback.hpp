@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vk-types.hpp>
+
+#include <atomic>
+
+namespace vr {
+	// pixels of one frame in mapped staging buffer
+	struct ReadbackImage {
+		uint32_t    buffer;       // index for Retain and Release
+		const void *pixels;
+		uint32_t    width;
+		uint32_t    height;
+		size_t      rowPitch;
+		VkFormat    format;
+		uint32_t    frameNumber;
+		size_t      bufferSize;   // mapped bytes at pixels, at least rowPitch * height
+	};
+
+	// ring of persistently mapped host buffers that frames copy images to
+	// finished copies are found by timeline value and handed to consumers, cpu never waits for gpu here
+	// when every buffer is still in flight or held by consumer, frame is not read back (it is counted as dropped)
+	class ReadbackRing final {
+	public:
+		using Consumer = std::function<void(const ReadbackImage &image)>;
+
+		struct Stats {
+			uint32_t buffers = 0;
+			uint32_t pending = 0;    // copies that gpu has not finished yet
+			uint32_t held = 0;       // buffers kept by consumers after their callback
+			uint64_t delivered = 0;
+			uint64_t dropped = 0;
+		};
+
+		// buffers are created on first use with size of image that is copied (rounded up to whole pages)
+		// each has its own memory, so mapped pixels start at page boundary (for O_DIRECT writes from them)
+		void Init(VkDevice device, VmaAllocator allocator, uint32_t bufferCount);
+		void Destroy();  // device has to be idle and no buffer held
+
+		// consumers are registered once, frames select them with returned bit
+		uint32_t AddConsumer(Consumer &&consumer);
+
+		bool CanRecord() const;
+
+		// records copy of image (in TRANSFER_SRC_OPTIMAL layout) to free buffer, submit of cmd has to signal timelineValue
+		bool Record(VkCommandBuffer cmd, VkImage image, VkFormat format, uint32_t bytesPerPixel, VkExtent2D extent, uint32_t frameNumber, uint64_t timelineValue, uint32_t consumers);
+
+		// gives copies that are finished at completedValue to their consumers, in frame order
+		void Poll(uint64_t completedValue);
+
+		// timeline value of oldest copy in flight (0 if there is none), for callers that must not drop frames
+		uint64_t GetOldestPendingValue() const;
+
+		// consumer can keep buffer after its callback returns, for example to write it from other thread
+		// both are thread safe, buffer is reused after last release
+		void Retain(uint32_t buffer);
+		void Release(uint32_t buffer);
+
+		Stats GetStats() const;
+
+	private:
+		struct Buffer {
+			AllocatedBuffer       buffer{};
+			VkDeviceSize          size = 0;
+			std::atomic<uint32_t> holds{0};  // ring holds buffer while copy is pending, consumers while they use it
+			ReadbackImage         image{};
+			uint64_t              timelineValue = 0;
+			uint32_t              consumers = 0;
+		};
+
+	private:
+		VkDevice              m_device = VK_NULL_HANDLE;
+		VmaAllocator          m_allocator = VK_NULL_HANDLE;
+		std::vector<Buffer>   m_buffers;
+		std::vector<uint32_t> m_pending;  // buffers with copies in flight, circular queue in frame order
+		uint32_t              m_pendingHead = 0;
+		uint32_t              m_pendingCount = 0;
+		uint32_t              m_next = 0;  // buffer where search for free one starts
+		std::vector<Consumer> m_consumers;
+		uint64_t              m_delivered = 0;
+		uint64_t              m_dropped = 0;
+	};
+}
@@ -0,0 +1,237 @@
+#include <vk-recorder.hpp>
+#include <vk-pixel-convert.hpp>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#endif
+
+using namespace vr;
+
+
+// stages wait for each other by polling, frame period is much longer than this
+static void Backoff() {
+	std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+
+bool FrameRecorder::Start(const std::string &path, RecordFormat format, bool srgb, uint32_t fps, uint32_t threadCount, ReadbackRing *ring) {
+	m_stdout = path == "-";
+	if (m_stdout) {
+	#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+	#endif
+		m_file = stdout;
+	} else {
+		m_file = std::fopen(path.c_str(), "wb");
+		if (!m_file) {
+			spdlog::error("failed to open recording file: {}", path);
+			return false;
+		}
+	}
+
+#ifndef _WIN32
+	// encoder that reads pipe can exit first, write then fails instead of killing player
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	// large buffer, so writer makes few big writes
+	std::setvbuf(m_file, nullptr, _IOFBF, 4 << 20);
+
+	m_ring = ring;
+	m_format = format;
+	m_conversion.format = format == RecordFormat::Y4M ? vkutils::PixelFormat::Yuv420 : format == RecordFormat::RawBgra ? vkutils::PixelFormat::Bgra8 : vkutils::PixelFormat::Rgba8;
+	m_conversion.srgb = srgb;
+	m_conversion.kernel = vkutils::GetBestConvertKernel();
+	m_fps = std::max(fps, 1u);
+	m_stopping = false;
+	m_convertersDone = false;
+
+	for (uint32_t i = 0; i != std::max(threadCount, 1u); ++i) {
+		auto converter = std::make_unique<Converter>();
+		converter->input = std::make_unique<SpscQueue<Frame>>(QUEUE_DEPTH);
+		converter->output = std::make_unique<SpscQueue<Frame>>(QUEUE_DEPTH);
+		converter->freeBuffers = std::make_unique<SpscQueue<uint32_t>>(QUEUE_DEPTH);
+		converter->buffers.resize(QUEUE_DEPTH);
+		for (uint32_t b = 0; b != QUEUE_DEPTH; ++b) {
+			converter->freeBuffers->Push(b);
+		}
+		m_converters.push_back(std::move(converter));
+	}
+	for (auto &converter : m_converters) {
+		converter->thread = std::thread(&FrameRecorder::ConvertLoop, this, std::ref(*converter));
+	}
+	m_writer = std::thread(&FrameRecorder::WriteLoop, this);
+
+	spdlog::info("Recording {} at {} fps to {} ({} conversion threads, {} kernel)", RecordFormatName(format), m_fps, m_stdout ? "stdout" : path,
+		m_converters.size(), vkutils::ConvertKernelName(m_conversion.kernel));
+	return true;
+}
+
+
+void FrameRecorder::Stop() {
+	if (!m_file) {
+		return;
+	}
+
+	// converters finish their queues first, writer then knows nothing else comes
+	m_stopping = true;
+	for (auto &converter : m_converters) {
+		converter->thread.join();
+	}
+	m_convertersDone = true;
+	m_writer.join();
+	m_converters.clear();
+
+	if (m_stdout) {
+		std::fflush(m_file);
+	} else {
+		std::fclose(m_file);
+	}
+	m_file = nullptr;
+
+	spdlog::info("Recorded {} frames ({} dropped, {} late)", m_written.load(), m_dropped.load(), m_late.load());
+}
+
+
+bool FrameRecorder::Submit(const ReadbackImage &image, bool wait) {
+	if (m_width == 0) {
+		m_width = image.width;
+		m_height = image.height;
+		if (m_format != RecordFormat::Y4M) {
+			spdlog::info("Raw recording: -f rawvideo -pix_fmt {} -video_size {}x{} -framerate {}", m_format == RecordFormat::RawBgra ? "bgra" : "rgba", m_width, m_height, m_fps);
+		}
+	}
+
+	if (image.width != m_width || image.height != m_height) {
+		if (!m_sizeReported) {
+			spdlog::warn("Recording keeps size {}x{}, frames of other size are dropped", m_width, m_height);
+			m_sizeReported = true;
+		}
+		m_dropped++;
+		return false;
+	}
+
+	Frame frame;
+	frame.image = image;
+	frame.captured = std::chrono::steady_clock::now();
+
+	// retained before push, converter can release it right after
+	m_ring->Retain(image.buffer);
+	SpscQueue<Frame> &input = *m_converters[m_submitted % m_converters.size()]->input;
+	while (!input.Push(frame)) {
+		if (!wait) {
+			m_ring->Release(image.buffer);
+			m_dropped++;
+			return false;
+		}
+		Backoff();
+	}
+
+	m_submitted++;
+	return true;
+}
+
+
+void FrameRecorder::ConvertLoop(Converter &converter) {
+	Frame frame;
+	while (true) {
+		// flag is read before pop: it is set after last push, so once it is seen, failed pop means queue is drained
+		// (reading it after failed pop would miss frame pushed in between)
+		bool stopping = m_stopping;
+		if (!converter.input->Pop(frame)) {
+			if (stopping) {
+				return;
+			}
+			Backoff();
+			continue;
+		}
+
+		// writer gives buffers back after writing them
+		while (!converter.freeBuffers->Pop(frame.output)) {
+			Backoff();
+		}
+
+		// allocated once, every frame has same size
+		std::vector<uint8_t> &buffer = converter.buffers[frame.output];
+		const ReadbackImage &image = frame.image;
+		buffer.resize(vkutils::GetConvertedSize(m_conversion.format, image.width, image.height));
+
+		// converters already run in parallel on different frames, so each frame is converted on one thread
+		vkutils::ConvertPixelRows(m_conversion, image.pixels, image.rowPitch, buffer.data(), image.width, image.height, 0, image.height);
+		m_ring->Release(image.buffer);
+
+		// output queue has room, it holds at most as many frames as there are buffers
+		converter.output->Push(frame);
+	}
+}
+
+
+void FrameRecorder::WriteLoop() {
+	const auto period = std::chrono::duration<double>(1.0 / m_fps);
+	bool headerWritten = false;
+	uint64_t next = 0;
+
+	while (true) {
+		Converter &converter = *m_converters[next % m_converters.size()];
+		Frame frame;
+		bool convertersDone = m_convertersDone;  // read before pop, same as in ConvertLoop
+		if (!converter.output->Pop(frame)) {
+			// converters are joined, so empty queue of next frame means there are no more frames
+			if (convertersDone) {
+				return;
+			}
+			Backoff();
+			continue;
+		}
+
+		const std::vector<uint8_t> &buffer = converter.buffers[frame.output];
+		if (!m_writeFailed) {
+			bool ok = true;
+			if (m_format == RecordFormat::Y4M) {
+				if (!headerWritten) {
+					ok = std::fprintf(m_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", m_width, m_height, m_fps) > 0;
+					headerWritten = true;
+				}
+				ok = ok && std::fputs("FRAME\n", m_file) >= 0;
+			}
+			ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), m_file) == buffer.size();
+
+			if (!ok) {
+				spdlog::error("Recording write failed, remaining frames are dropped");
+				m_writeFailed = true;
+			}
+		}
+
+		if (m_writeFailed) {
+			m_dropped++;
+		} else {
+			m_written++;
+			if (std::chrono::steady_clock::now() - frame.captured > period * LATE_FRAMES) {
+				m_late++;
+			}
+		}
+
+		converter.freeBuffers->Push(frame.output);
+		next++;
+	}
+}
+
+
+FrameRecorder::Stats FrameRecorder::GetStats() const {
+	Stats stats;
+	stats.submitted = m_submitted;
+	stats.written = m_written;
+	stats.dropped = m_dropped;
+	stats.late = m_late;
+	for (auto &converter : m_converters) {
+		stats.convertQueued += static_cast<uint32_t>(converter->input->Size());
+		stats.writeQueued += static_cast<uint32_t>(converter->output->Size());
+	}
+	stats.queueCapacity = static_cast<uint32_t>(m_converters.size()) * QUEUE_DEPTH;
+	return stats;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vk-config.hpp>
+#include <vk-readback.hpp>
+#include <vk-spsc-queue.hpp>
+#include <vk-pixel-convert.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace vr {
+	// video stream of read back frames, written to file or stdout (for piping into encoder)
+	// capture (thread that polls readback ring) -> conversion to 8 bit (worker threads) -> writer thread
+	// frame n goes to converter n % count and writer takes frames back in same order,
+	// so every queue has one producer and one consumer and frames stay in order
+	class FrameRecorder final {
+	public:
+		struct Stats {
+			uint64_t submitted = 0;
+			uint64_t written = 0;
+			uint64_t dropped = 0;       // queues were full or size changed
+			uint64_t late = 0;          // written later than LATE_FRAMES frame periods after capture
+			uint32_t convertQueued = 0;
+			uint32_t writeQueued = 0;
+			uint32_t queueCapacity = 0;  // of each stage
+		};
+
+		// path "-" writes to stdout, srgb encodes frames with sRGB curve
+		bool Start(const std::string &path, RecordFormat format, bool srgb, uint32_t fps, uint32_t threadCount, ReadbackRing *ring);
+		void Stop();  // writes queued frames
+		bool IsRecording() const { return m_file != nullptr; }
+
+		// called by readback consumer, buffer is retained until frame is converted
+		// with wait, full queue blocks instead of dropping frame (offline rendering)
+		bool Submit(const ReadbackImage &image, bool wait);
+
+		Stats GetStats() const;
+
+		static constexpr uint32_t QUEUE_DEPTH = 4;  // frames per converter in each stage
+		static constexpr uint32_t LATE_FRAMES = 3;
+
+	private:
+		struct Frame {
+			ReadbackImage image;
+			uint32_t      output = 0;  // buffer of converter
+			std::chrono::steady_clock::time_point captured;
+		};
+
+		struct Converter {
+			std::unique_ptr<SpscQueue<Frame>>    input;        // capture -> converter
+			std::unique_ptr<SpscQueue<Frame>>    output;       // converter -> writer
+			std::unique_ptr<SpscQueue<uint32_t>> freeBuffers;  // writer -> converter
+			std::vector<std::vector<uint8_t>>    buffers;
+			std::thread                          thread;
+		};
+
+		void ConvertLoop(Converter &converter);
+		void WriteLoop();
+
+	private:
+		ReadbackRing *m_ring = nullptr;
+		RecordFormat  m_format = RecordFormat::Y4M;
+		vkutils::PixelConversion m_conversion;
+		uint32_t      m_fps = 60;
+		std::FILE    *m_file = nullptr;
+		bool          m_stdout = false;
+
+		// size of first frame, stream cannot change it
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		bool     m_sizeReported = false;
+
+		std::vector<std::unique_ptr<Converter>> m_converters;
+		std::thread                             m_writer;
+		std::atomic<bool>                       m_stopping{false};
+		std::atomic<bool>                       m_convertersDone{false};
+
+		uint64_t              m_submitted = 0;  // capture thread only
+		std::atomic<uint64_t> m_written{0};
+		std::atomic<uint64_t> m_dropped{0};
+		std::atomic<uint64_t> m_late{0};
+		bool                  m_writeFailed = false;  // writer thread only
+	};
+}
@@ -0,0 +1,661 @@
+#include <vk-reflection.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+using namespace vr;
+
+
+namespace {
+	// parts of spir-v specification that are needed for reflection
+	const uint32_t SPIRV_MAGIC = 0x07230203;
+
+	enum Op : uint32_t {
+		OpName                  = 5,
+		OpMemberName            = 6,
+		OpEntryPoint            = 15,
+		OpExecutionMode         = 16,
+		OpCapability            = 17,
+		OpTypeBool              = 20,
+		OpTypeInt               = 21,
+		OpTypeFloat             = 22,
+		OpTypeVector            = 23,
+		OpTypeMatrix            = 24,
+		OpTypeImage             = 25,
+		OpTypeSampler           = 26,
+		OpTypeSampledImage      = 27,
+		OpTypeArray             = 28,
+		OpTypeRuntimeArray      = 29,
+		OpTypeStruct            = 30,
+		OpTypePointer           = 32,
+		OpConstant              = 43,
+		OpConstantComposite     = 44,
+		OpSpecConstantTrue      = 48,
+		OpSpecConstantFalse     = 49,
+		OpSpecConstant          = 50,
+		OpSpecConstantComposite = 51,
+		OpVariable              = 59,
+		OpDecorate              = 71,
+		OpMemberDecorate        = 72,
+		OpExecutionModeId       = 331,
+	};
+
+	enum Decoration : uint32_t {
+		DecorationSpecId        = 1,
+		DecorationBlock         = 2,
+		DecorationBufferBlock   = 3,
+		DecorationArrayStride   = 6,
+		DecorationMatrixStride  = 7,
+		DecorationBuiltIn       = 11,
+		DecorationBinding       = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset        = 35,
+	};
+
+	enum StorageClass : uint32_t {
+		StorageClassUniformConstant = 0,
+		StorageClassUniform         = 2,
+		StorageClassPushConstant    = 9,
+		StorageClassStorageBuffer   = 12,
+		StorageClassPhysicalStorageBuffer = 5349,
+	};
+
+	const uint32_t EXECUTION_MODEL_GLCOMPUTE   = 5;
+	const uint32_t EXECUTION_MODE_LOCAL_SIZE    = 17;
+	const uint32_t EXECUTION_MODE_LOCAL_SIZE_ID = 38;
+	const uint32_t BUILTIN_WORKGROUP_SIZE       = 25;
+	const uint32_t DIM_BUFFER                   = 5;
+	const uint32_t CAPABILITY_STORAGE_IMAGE_WRITE_WITHOUT_FORMAT = 56;
+	const uint32_t NONE                         = ~0u;
+
+	// everything that is known about one result id
+	struct IdInfo {
+		uint32_t        opcode = 0;
+		const uint32_t *words = nullptr;  // whole instruction
+		uint32_t        wordCount = 0;
+
+		std::string name;
+		std::vector<std::string> memberNames;
+		std::vector<uint32_t>    memberOffsets;
+		std::vector<uint32_t>    memberMatrixStrides;
+
+		uint32_t set = NONE;
+		uint32_t binding = NONE;
+		uint32_t arrayStride = 0;
+		uint32_t builtIn = NONE;
+		uint32_t specId = NONE;
+		bool     block = false;
+		bool     bufferBlock = false;
+	};
+
+	std::string ReadString(const uint32_t *words, uint32_t wordCount) {
+		const char *chars = reinterpret_cast<const char*>(words);
+		return std::string(chars, strnlen(chars, wordCount * sizeof(uint32_t)));
+	}
+
+	template<typename T>
+	void SetAt(std::vector<T> &values, uint32_t index, const T &value) {
+		if (values.size() <= index) {
+			values.resize(index + 1);
+		}
+		values[index] = value;
+	}
+
+
+	class Reflector {
+	public:
+		bool Parse(const std::vector<uint32_t> &spirv, std::string &error);
+		bool Reflect(ShaderReflection &reflection, std::string &error);
+
+	private:
+		const IdInfo *Get(uint32_t id) const { return id < m_ids.size() && m_ids[id].opcode != 0 ? &m_ids[id] : nullptr; }
+		uint32_t ConstantValue(uint32_t id) const;
+		uint32_t TypeSize(uint32_t typeId, uint32_t matrixStride) const;
+		bool ReflectBinding(const IdInfo &variable, uint32_t typeId, uint32_t storageClass, DescriptorBinding &binding, std::string &error) const;
+		void ReflectPushConstants(uint32_t typeId, ShaderReflection &reflection) const;
+		void ReflectMembers(const IdInfo &block, std::vector<PushConstantMember> &members) const;
+		void SetLocalSize(const uint32_t *constantIds, ShaderReflection &reflection) const;
+
+	private:
+		std::vector<IdInfo>         m_ids;
+		std::vector<const uint32_t*> m_variables;
+		std::vector<const uint32_t*> m_executionModes;
+		bool                         m_hasComputeEntry = false;
+	};
+
+
+	bool Reflector::Parse(const std::vector<uint32_t> &spirv, std::string &error) {
+		if (spirv.size() < 5 || spirv[0] != SPIRV_MAGIC) {
+			error = "not a spir-v module";
+			return false;
+		}
+
+		m_ids.resize(spirv[3]);  // id bound
+
+		size_t i = 5;
+		while (i < spirv.size()) {
+			const uint32_t *words = &spirv[i];
+			uint32_t wordCount = words[0] >> 16;
+			uint32_t opcode = words[0] & 0xFFFF;
+
+			if (wordCount == 0 || i + wordCount > spirv.size()) {
+				error = "corrupted spir-v module";
+				return false;
+			}
+
+			// types have result id in first operand, constants and variables in second
+			uint32_t resultId = NONE;
+			switch (opcode) {
+				case OpTypeBool: case OpTypeInt: case OpTypeFloat: case OpTypeVector: case OpTypeMatrix:
+				case OpTypeImage: case OpTypeSampler: case OpTypeSampledImage: case OpTypeArray:
+				case OpTypeRuntimeArray: case OpTypeStruct: case OpTypePointer:
+					resultId = words[1];
+					break;
+				case OpConstant: case OpConstantComposite: case OpSpecConstantTrue: case OpSpecConstantFalse:
+				case OpSpecConstant: case OpSpecConstantComposite: case OpVariable:
+					resultId = words[2];
+					break;
+			}
+
+			if (resultId != NONE && resultId < m_ids.size()) {
+				m_ids[resultId].opcode = opcode;
+				m_ids[resultId].words = words;
+				m_ids[resultId].wordCount = wordCount;
+			}
+
+			// debug names and decorations come before types, so they are stored by target id
+			uint32_t target = wordCount > 1 ? words[1] : NONE;
+			IdInfo *info = target < m_ids.size() ? &m_ids[target] : nullptr;
+
+			switch (opcode) {
+				case OpName:
+					if (info) info->name = ReadString(words + 2, wordCount - 2);
+					break;
+				case OpMemberName:
+					if (info) SetAt(info->memberNames, words[2], ReadString(words + 3, wordCount - 3));
+					break;
+				case OpEntryPoint:
+					m_hasComputeEntry |= words[1] == EXECUTION_MODEL_GLCOMPUTE;
+					break;
+				case OpExecutionMode:
+				case OpExecutionModeId:
+					m_executionModes.push_back(words);
+					break;
+				case OpVariable:
+					m_variables.push_back(words);
+					break;
+				case OpDecorate:
+					if (!info) break;
+					switch (words[2]) {
+						case DecorationSpecId:        info->specId = words[3]; break;
+						case DecorationBlock:         info->block = true; break;
+						case DecorationBufferBlock:   info->bufferBlock = true; break;
+						case DecorationArrayStride:   info->arrayStride = words[3]; break;
+						case DecorationBuiltIn:       info->builtIn = words[3]; break;
+						case DecorationBinding:       info->binding = words[3]; break;
+						case DecorationDescriptorSet: info->set = words[3]; break;
+					}
+					break;
+				case OpMemberDecorate:
+					if (!info) break;
+					if (words[3] == DecorationOffset) SetAt(info->memberOffsets, words[2], words[4]);
+					if (words[3] == DecorationMatrixStride) SetAt(info->memberMatrixStrides, words[2], words[4]);
+					break;
+			}
+
+			i += wordCount;
+		}
+
+		if (!m_hasComputeEntry) {
+			error = "not a compute shader";
+			return false;
+		}
+		return true;
+	}
+
+
+	// value of integer constant (default value for specialization constants)
+	uint32_t Reflector::ConstantValue(uint32_t id) const {
+		const IdInfo *constant = Get(id);
+		if (!constant || (constant->opcode != OpConstant && constant->opcode != OpSpecConstant) || constant->wordCount < 4) {
+			return 0;
+		}
+		return constant->words[3];
+	}
+
+
+	uint32_t Reflector::TypeSize(uint32_t typeId, uint32_t matrixStride) const {
+		const IdInfo *type = Get(typeId);
+		if (!type) {
+			return 0;
+		}
+
+		const uint32_t *w = type->words;
+		switch (type->opcode) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return w[2] / 8;
+			case OpTypeVector:
+				return w[3] * TypeSize(w[2], 0);
+			case OpTypeMatrix:
+				return w[3] * (matrixStride ? matrixStride : TypeSize(w[2], 0));
+			case OpTypeArray:
+				return ConstantValue(w[3]) * (type->arrayStride ? type->arrayStride : TypeSize(w[2], 0));
+			case OpTypeRuntimeArray:
+				return 0;  // size is known only at runtime
+			case OpTypePointer:
+				return 8;  // buffer reference
+			case OpTypeStruct: {
+				uint32_t size = 0;
+				for (uint32_t m = 0; m + 2 < type->wordCount; ++m) {
+					uint32_t offset = m < type->memberOffsets.size() ? type->memberOffsets[m] : 0;
+					uint32_t stride = m < type->memberMatrixStrides.size() ? type->memberMatrixStrides[m] : 0;
+					size = std::max(size, offset + TypeSize(w[2 + m], stride));
+				}
+				return size;
+			}
+		}
+		return 0;
+	}
+
+
+	VkFormat ToVkFormat(uint32_t imageFormat) {
+		switch (imageFormat) {
+			case 1:  return VK_FORMAT_R32G32B32A32_SFLOAT;  // rgba32f
+			case 2:  return VK_FORMAT_R16G16B16A16_SFLOAT;  // rgba16f
+			case 3:  return VK_FORMAT_R32_SFLOAT;           // r32f
+			case 4:  return VK_FORMAT_R8G8B8A8_UNORM;       // rgba8
+			case 6:  return VK_FORMAT_R32G32_SFLOAT;        // rg32f
+			case 7:  return VK_FORMAT_R16G16_SFLOAT;        // rg16f
+			case 9:  return VK_FORMAT_R16_SFLOAT;           // r16f
+			case 21: return VK_FORMAT_R32G32B32A32_SINT;    // rgba32i
+			case 24: return VK_FORMAT_R32_SINT;             // r32i
+			case 30: return VK_FORMAT_R32G32B32A32_UINT;    // rgba32ui
+			case 33: return VK_FORMAT_R32_UINT;             // r32ui
+		}
+		return VK_FORMAT_UNDEFINED;
+	}
+
+
+	bool Reflector::ReflectBinding(const IdInfo &variable, uint32_t typeId, uint32_t storageClass, DescriptorBinding &binding, std::string &error) const {
+		binding.name = variable.name;
+		binding.set = variable.set;
+		binding.binding = variable.binding;
+		binding.count = 1;
+		binding.imageFormat = VK_FORMAT_UNDEFINED;
+		binding.bufferSize = 0;
+		binding.arrayStride = 0;
+
+		// arrays of descriptors
+		const IdInfo *type = Get(typeId);
+		if (type && type->opcode == OpTypeArray) {
+			binding.count = ConstantValue(type->words[3]);
+			type = Get(type->words[2]);
+		} else if (type && type->opcode == OpTypeRuntimeArray) {
+			binding.count = 0;  // only bindless table has them
+			type = Get(type->words[2]);
+		}
+
+		if (!type) {
+			error = "unknown type of " + binding.name;
+			return false;
+		}
+
+		switch (type->opcode) {
+			case OpTypeImage: {
+				bool storage = type->words[7] == 2;
+				bool buffer = type->words[3] == DIM_BUFFER;
+				if (storage) {
+					binding.type = buffer ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				} else {
+					binding.type = buffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+				binding.imageFormat = ToVkFormat(type->words[8]);
+				return true;
+			}
+			case OpTypeSampledImage:
+				binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				return true;
+			case OpTypeSampler:
+				binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+				return true;
+			case OpTypeStruct: {
+				bool storage = storageClass == StorageClassStorageBuffer || type->bufferBlock;
+				binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				binding.bufferSize = TypeSize(type->words[1], 0);
+
+				// anonymous blocks have name only on type
+				if (binding.name.empty()) {
+					binding.name = type->name;
+				}
+
+				// runtime array can only be last member
+				const IdInfo *last = type->wordCount > 2 ? Get(type->words[type->wordCount - 1]) : nullptr;
+				if (last && last->opcode == OpTypeRuntimeArray) {
+					binding.arrayStride = last->arrayStride;
+				}
+				return true;
+			}
+		}
+
+		error = "unsupported descriptor type of " + binding.name;
+		return false;
+	}
+
+
+	void Reflector::ReflectPushConstants(uint32_t typeId, ShaderReflection &reflection) const {
+		const IdInfo *block = Get(typeId);
+		if (!block || block->opcode != OpTypeStruct) {
+			return;
+		}
+
+		reflection.pushConstantSize = TypeSize(typeId, 0);
+		ReflectMembers(*block, reflection.pushConstants);
+
+		// buffer references to structs are parameter blocks
+		for (uint32_t m = 0; m + 2 < block->wordCount; ++m) {
+			const IdInfo *pointer = Get(block->words[2 + m]);
+			if (!pointer || pointer->opcode != OpTypePointer || pointer->words[2] != StorageClassPhysicalStorageBuffer) {
+				continue;
+			}
+
+			const IdInfo *pointee = Get(pointer->words[3]);
+			if (!pointee || pointee->opcode != OpTypeStruct) {
+				continue;
+			}
+
+			ParameterBlock parameters{};
+			parameters.name = reflection.pushConstants[m].name;
+			parameters.offset = reflection.pushConstants[m].offset;
+			parameters.size = TypeSize(pointer->words[3], 0);
+			ReflectMembers(*pointee, parameters.members);
+			reflection.parameterBlocks.push_back(parameters);
+		}
+	}
+
+
+	void Reflector::ReflectMembers(const IdInfo &block, std::vector<PushConstantMember> &members) const {
+		for (uint32_t m = 0; m + 2 < block.wordCount; ++m) {
+			PushConstantMember member{};
+			member.name = m < block.memberNames.size() ? block.memberNames[m] : "";
+			member.offset = m < block.memberOffsets.size() ? block.memberOffsets[m] : 0;
+			member.size = TypeSize(block.words[2 + m], m < block.memberMatrixStrides.size() ? block.memberMatrixStrides[m] : 0);
+			member.scalar = ReflectedScalar::Other;
+			member.components = 0;
+
+			// arrays of scalars and vectors (palettes, curves) get control for every element
+			const IdInfo *type = Get(block.words[2 + m]);
+			if (type && type->opcode == OpTypeArray && type->arrayStride != 0) {
+				member.count = ConstantValue(type->words[3]);
+				member.stride = type->arrayStride;
+				type = Get(type->words[2]);
+			}
+
+			uint32_t components = 1;
+			if (type && type->opcode == OpTypeVector) {
+				components = type->words[3];
+				type = Get(type->words[2]);
+			}
+
+			if (type && type->opcode == OpTypeFloat && type->words[2] == 32) {
+				member.scalar = ReflectedScalar::Float;
+				member.components = components;
+			} else if (type && type->opcode == OpTypeInt && type->words[2] == 32) {
+				member.scalar = type->words[3] ? ReflectedScalar::Int : ReflectedScalar::Uint;
+				member.components = components;
+			}
+
+			members.push_back(member);
+		}
+	}
+
+
+	// workgroup size given by constants, specialization constants can be changed when pipeline is created
+	void Reflector::SetLocalSize(const uint32_t *constantIds, ShaderReflection &reflection) const {
+		for (int i = 0; i != 3; ++i) {
+			reflection.localSize[i] = ConstantValue(constantIds[i]);
+
+			const IdInfo *constant = Get(constantIds[i]);
+			reflection.localSizeSpecIds[i] = constant && constant->opcode == OpSpecConstant ? constant->specId : NONE;
+		}
+	}
+
+
+	bool Reflector::Reflect(ShaderReflection &reflection, std::string &error) {
+		reflection = ShaderReflection{};
+
+		for (const uint32_t *words : m_variables) {
+			const IdInfo &variable = m_ids[words[2]];
+			const IdInfo *pointer = Get(words[1]);
+			uint32_t storageClass = words[3];
+			if (!pointer || pointer->opcode != OpTypePointer) {
+				continue;
+			}
+
+			uint32_t typeId = pointer->words[3];
+
+			if (storageClass == StorageClassPushConstant) {
+				ReflectPushConstants(typeId, reflection);
+			} else if (storageClass == StorageClassUniformConstant || storageClass == StorageClassUniform || storageClass == StorageClassStorageBuffer) {
+				if (variable.set == NONE || variable.binding == NONE) {
+					continue;
+				}
+
+				DescriptorBinding binding{};
+				if (!ReflectBinding(variable, typeId, storageClass, binding, error)) {
+					return false;
+				}
+				reflection.bindings.push_back(binding);
+			}
+		}
+
+		std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const DescriptorBinding &a, const DescriptorBinding &b) {
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+
+		// workgroup size, WorkgroupSize built-in overrides execution mode
+		for (const uint32_t *words : m_executionModes) {
+			uint32_t opcode = words[0] & 0xFFFF;
+			if (words[2] == EXECUTION_MODE_LOCAL_SIZE && opcode == OpExecutionMode) {
+				for (int i = 0; i != 3; ++i) reflection.localSize[i] = words[3 + i];
+			} else if (words[2] == EXECUTION_MODE_LOCAL_SIZE_ID && opcode == OpExecutionModeId) {
+				SetLocalSize(words + 3, reflection);
+			}
+		}
+
+		for (const IdInfo &info : m_ids) {
+			if (info.builtIn == BUILTIN_WORKGROUP_SIZE && (info.opcode == OpConstantComposite || info.opcode == OpSpecConstantComposite) && info.wordCount >= 6) {
+				SetLocalSize(info.words + 3, reflection);
+			}
+		}
+
+		// specialization constants
+		for (const IdInfo &info : m_ids) {
+			if (info.specId == NONE || info.opcode == 0) {
+				continue;
+			}
+
+			SpecializationConstant constant{};
+			constant.name = info.name;
+			constant.id = info.specId;
+			constant.scalar = ReflectedScalar::Other;
+
+			if (info.opcode == OpSpecConstantTrue || info.opcode == OpSpecConstantFalse) {
+				constant.scalar = ReflectedScalar::Bool;
+				constant.defaultValue = info.opcode == OpSpecConstantTrue ? 1 : 0;
+			} else if (info.opcode == OpSpecConstant) {
+				const IdInfo *type = Get(info.words[1]);
+				if (type && type->opcode == OpTypeFloat && type->words[2] == 32) {
+					constant.scalar = ReflectedScalar::Float;
+				} else if (type && type->opcode == OpTypeInt && type->words[2] == 32) {
+					constant.scalar = type->words[3] ? ReflectedScalar::Int : ReflectedScalar::Uint;
+				}
+				constant.defaultValue = info.words[3];
+			}
+
+			if (constant.scalar == ReflectedScalar::Other) {
+				error = "unsupported type of specialization constant " + constant.name;
+				return false;
+			}
+
+			// workgroup size constants have no names in glslang output
+			for (int i = 0; constant.name.empty() && i != 3; ++i) {
+				if (reflection.localSizeSpecIds[i] == constant.id) {
+					constant.name = std::string("local_size_") + "xyz"[i];
+				}
+			}
+			reflection.specConstants.push_back(constant);
+		}
+
+		std::sort(reflection.specConstants.begin(), reflection.specConstants.end(), [](const SpecializationConstant &a, const SpecializationConstant &b) {
+			return a.id < b.id;
+		});
+
+		for (int i = 0; i != 3; ++i) {
+			if (reflection.localSize[i] == 0) {
+				error = "invalid workgroup size";
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+
+bool vkutils::ReflectComputeShader(const std::vector<uint32_t> &spirv, ShaderReflection &reflection, std::string &error) {
+	Reflector reflector;
+	return reflector.Parse(spirv, error) && reflector.Reflect(reflection, error);
+}
+
+
+bool vkutils::PushConstantsToUniformBuffer(const std::vector<uint32_t> &spirv, uint32_t set, uint32_t binding, std::vector<uint32_t> &result, std::string &error) {
+	if (spirv.size() < 5 || spirv[0] != SPIRV_MAGIC) {
+		error = "not a spir-v module";
+		return false;
+	}
+
+	result.assign(spirv.begin(), spirv.begin() + 5);
+	result.reserve(spirv.size() + 8);
+
+	// pointer types and variable change storage class, block and member offsets are already decorated
+	uint32_t variableId = NONE;
+	size_t decorationsAt = 0;
+	for (size_t i = 5; i < spirv.size();) {
+		uint32_t wordCount = spirv[i] >> 16;
+		uint32_t opcode = spirv[i] & 0xFFFF;
+		if (wordCount == 0 || i + wordCount > spirv.size()) {
+			error = "corrupted spir-v module";
+			return false;
+		}
+
+		size_t start = result.size();
+		result.insert(result.end(), spirv.begin() + i, spirv.begin() + i + wordCount);
+		uint32_t *words = result.data() + start;
+		i += wordCount;
+
+		if ((opcode == OpDecorate || opcode == OpMemberDecorate) && decorationsAt == 0) {
+			decorationsAt = start;
+		} else if (opcode == OpTypePointer && wordCount >= 4 && words[2] == StorageClassPushConstant) {
+			words[2] = StorageClassUniform;
+		} else if (opcode == OpVariable && wordCount >= 4 && words[3] == StorageClassPushConstant) {
+			if (variableId != NONE) {
+				error = "more than one push constant block";
+				return false;
+			}
+			words[3] = StorageClassUniform;
+			variableId = words[2];
+		}
+	}
+
+	if (variableId == NONE || decorationsAt == 0) {
+		error = "shader has no push constant block";
+		return false;
+	}
+
+	// decorations of variable go to annotation section, before first existing decoration
+	const uint32_t decorations[] = {
+		(4u << 16) | OpDecorate, variableId, DecorationDescriptorSet, set,
+		(4u << 16) | OpDecorate, variableId, DecorationBinding, binding,
+	};
+	result.insert(result.begin() + decorationsAt, std::begin(decorations), std::end(decorations));
+	return true;
+}
+
+
+bool vkutils::DeclareStorageImageFormat(std::vector<uint32_t> &spirv, uint32_t set, uint32_t binding, VkFormat format, std::string &error) {
+	if (spirv.size() < 5 || spirv[0] != SPIRV_MAGIC) {
+		error = "not a spir-v module";
+		return false;
+	}
+
+	uint32_t imageFormat = 0;
+	for (uint32_t f = 1; f != 40 && imageFormat == 0; ++f) {
+		imageFormat = ToVkFormat(f) == format ? f : 0;
+	}
+	if (imageFormat == 0) {
+		error = "format cannot be declared in spir-v";
+		return false;
+	}
+
+	// decorations come before types and variables, so variable at set and binding is known when it is reached
+	std::vector<uint32_t> sets(spirv[3], NONE);
+	std::vector<uint32_t> bindings(spirv[3], NONE);
+	std::vector<uint32_t> pointees(spirv[3], NONE);
+	std::vector<size_t>   images(spirv[3], 0);  // position of image types
+	uint32_t imageType = NONE;
+	for (size_t i = 5; i < spirv.size();) {
+		uint32_t wordCount = spirv[i] >> 16;
+		uint32_t opcode = spirv[i] & 0xFFFF;
+		if (wordCount == 0 || i + wordCount > spirv.size()) {
+			error = "corrupted spir-v module";
+			return false;
+		}
+
+		const uint32_t *words = &spirv[i];
+		if (opcode == OpDecorate && wordCount >= 4 && words[1] < spirv[3]) {
+			if (words[2] == DecorationDescriptorSet) {
+				sets[words[1]] = words[3];
+			} else if (words[2] == DecorationBinding) {
+				bindings[words[1]] = words[3];
+			}
+		} else if (opcode == OpTypeImage && wordCount >= 9 && words[1] < spirv[3]) {
+			images[words[1]] = i;
+		} else if (opcode == OpTypePointer && wordCount >= 4 && words[1] < spirv[3]) {
+			pointees[words[1]] = words[3];
+		} else if (opcode == OpVariable && wordCount >= 4 && words[2] < spirv[3] && words[1] < spirv[3] &&
+		           sets[words[2]] == set && bindings[words[2]] == binding) {
+			imageType = pointees[words[1]];
+		}
+		i += wordCount;
+	}
+
+	// storage image without format, types are shared, so other images of same type get format too
+	if (imageType == NONE || imageType >= spirv[3] || images[imageType] == 0) {
+		return true;
+	}
+	uint32_t *words = &spirv[images[imageType]];
+	if (words[7] != 2 || words[8] != 0) {
+		return true;
+	}
+	words[8] = imageFormat;
+
+	// capability is only declared if no other image needs it
+	for (size_t position : images) {
+		if (position != 0 && spirv[position + 7] == 2 && spirv[position + 8] == 0) {
+			return true;
+		}
+	}
+	for (size_t i = 5; i < spirv.size();) {
+		uint32_t wordCount = spirv[i] >> 16;
+		if ((spirv[i] & 0xFFFF) == OpCapability && wordCount == 2 && spirv[i + 1] == CAPABILITY_STORAGE_IMAGE_WRITE_WITHOUT_FORMAT) {
+			spirv.erase(spirv.begin() + i, spirv.begin() + i + wordCount);
+			continue;
+		}
+		i += wordCount;
+	}
+	return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace vr {
+	// basic type of push constant member, used to pick overlay control
+	enum class ReflectedScalar { Float, Int, Uint, Bool, Other };
+
+	struct PushConstantMember {
+		std::string     name;
+		uint32_t        offset;
+		uint32_t        size;
+		ReflectedScalar scalar;
+		uint32_t        components;  // 1 for scalars, 2-4 for vectors (or their arrays), 0 for matrices and structs
+		uint32_t        count = 1;   // elements of array
+		uint32_t        stride = 0;  // between array elements
+	};
+
+	// struct behind buffer_reference member of push constants
+	// engine copies it to frame ring every frame and writes its device address into that member
+	struct ParameterBlock {
+		std::string                     name;     // push constant member that holds address
+		uint32_t                        offset;   // of address in push constants
+		uint32_t                        size;     // runtime array at the end is not included
+		std::vector<PushConstantMember> members;
+	};
+
+	struct DescriptorBinding {
+		std::string      name;
+		uint32_t         set;
+		uint32_t         binding;
+		VkDescriptorType type;
+		uint32_t         count;        // 0 for runtime arrays
+		VkFormat         imageFormat;  // storage images only (VK_FORMAT_UNDEFINED if shader does not declare it)
+		uint32_t         bufferSize;   // buffers only, without runtime array at the end
+		uint32_t         arrayStride;  // stride of runtime array at the end of buffer (0 if there is none)
+	};
+
+	// constant_id of shader, value is raw 32 bits (float bits for floats, 0 or 1 for bools)
+	struct SpecializationConstant {
+		std::string     name;
+		uint32_t        id;
+		ReflectedScalar scalar;
+		uint32_t        defaultValue;
+	};
+
+	// interface of compute shader
+	struct ShaderReflection {
+		uint32_t                        pushConstantSize = 0;
+		std::vector<PushConstantMember> pushConstants;
+		std::vector<ParameterBlock>     parameterBlocks;
+		std::vector<DescriptorBinding>  bindings;  // sorted by set and binding
+		std::vector<SpecializationConstant> specConstants;  // sorted by id
+		uint32_t                        localSize[3] = {1, 1, 1};             // default values if size is specialized
+		uint32_t                        localSizeSpecIds[3] = {~0u, ~0u, ~0u};  // constant_id of each dimension (~0u if it is literal)
+	};
+}
+
+namespace vkutils {
+	// reads interface of compute shader from spir-v
+	bool ReflectComputeShader(const std::vector<uint32_t> &spirv, vr::ShaderReflection &reflection, std::string &error);
+
+	// turns push constant block of shader into uniform buffer at set and binding, members keep their offsets
+	// (push constants are stored in command buffer, uniform buffer can change without recording it again)
+	bool PushConstantsToUniformBuffer(const std::vector<uint32_t> &spirv, uint32_t set, uint32_t binding, std::vector<uint32_t> &result, std::string &error);
+
+	// declares format of storage image at set and binding if shader left it out
+	// (devices without shaderStorageImageWriteWithoutFormat cannot write such images)
+	bool DeclareStorageImageFormat(std::vector<uint32_t> &spirv, uint32_t set, uint32_t binding, VkFormat format, std::string &error);
+}
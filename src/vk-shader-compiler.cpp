@@ -0,0 +1,254 @@
+#include <vk-shader-compiler.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#ifdef COMPUTE_PLAYER_HAS_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+
+static bool ReadTextFile(const std::filesystem::path &path, std::string &text) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+
+// used to name temporary files, so workers and other players do not write same file
+static uint64_t UniqueId() {
+	return std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+
+// same lookup order as glslangValidator: next to including file, then shaders folder
+static std::filesystem::path ResolveInclude(const std::filesystem::path &includingFile, const std::string &includeName, const std::string &includeRoot) {
+	std::filesystem::path local = includingFile.parent_path() / includeName;
+	if (std::filesystem::exists(local)) {
+		return local;
+	}
+	return std::filesystem::path(includeRoot) / includeName;
+}
+
+
+// returns names from #include "name" lines
+static std::vector<std::string> ParseIncludes(const std::string &source) {
+	std::vector<std::string> includes;
+
+	std::istringstream stream(source);
+	std::string line;
+	while (std::getline(stream, line)) {
+		size_t pos = line.find_first_not_of(" \t");
+		if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0) {
+			continue;
+		}
+
+		size_t begin = line.find('"', pos + 8);
+		size_t end = begin == std::string::npos ? std::string::npos : line.find('"', begin + 1);
+		if (end != std::string::npos) {
+			includes.push_back(line.substr(begin + 1, end - begin - 1));
+		}
+	}
+
+	return includes;
+}
+
+
+#ifdef COMPUTE_PLAYER_HAS_SHADERC
+
+namespace {
+	class Includer final : public shaderc::CompileOptions::IncluderInterface {
+	public:
+		explicit Includer(std::string includeRoot) : m_includeRoot(std::move(includeRoot)) {}
+
+		shaderc_include_result *GetInclude(const char *requestedSource, shaderc_include_type type, const char *requestingSource, size_t includeDepth) override {
+			IncludeData *data = new IncludeData;
+			data->name = ResolveInclude(requestingSource, requestedSource, m_includeRoot).generic_string();
+
+			if (!ReadTextFile(data->name, data->content)) {
+				// empty name tells shaderc that include failed, content holds error message
+				data->content = "cannot open include file " + std::string(requestedSource);
+				data->name.clear();
+			}
+
+			data->result.source_name = data->name.c_str();
+			data->result.source_name_length = data->name.size();
+			data->result.content = data->content.c_str();
+			data->result.content_length = data->content.size();
+			data->result.user_data = data;
+			return &data->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result *result) override {
+			delete static_cast<IncludeData*>(result->user_data);
+		}
+
+	private:
+		struct IncludeData {
+			shaderc_include_result result;
+			std::string name;
+			std::string content;
+		};
+
+		std::string m_includeRoot;
+	};
+}
+
+
+bool vkutils::CompileComputeShader(const std::string &sourcePath, const std::string &includeRoot, std::vector<uint32_t> &spirv, std::string &errors) {
+	std::string source;
+	if (!ReadTextFile(sourcePath, source)) {
+		errors = "cannot open " + sourcePath;
+		return false;
+	}
+
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+	options.SetIncluder(std::make_unique<Includer>(includeRoot));
+
+	// compiler is cheap to create and is not shared between worker threads
+	shaderc::Compiler compiler;
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, shaderc_compute_shader, sourcePath.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		errors = result.GetErrorMessage();
+		return false;
+	}
+
+	spirv.assign(result.cbegin(), result.cend());
+	return true;
+}
+
+#else
+
+// without shaderc glslangValidator (found by cmake) is run in child process
+bool vkutils::CompileComputeShader(const std::string &sourcePath, const std::string &includeRoot, std::vector<uint32_t> &spirv, std::string &errors) {
+#ifdef GLSL_VALIDATOR_PATH
+	const char *validator = GLSL_VALIDATOR_PATH;
+#else
+	const char *validator = "glslangValidator";
+#endif
+
+	std::filesystem::path outputPath = std::filesystem::temp_directory_path() / ("hot_reload_" + std::to_string(UniqueId()) + ".spv");
+
+	std::string command = "\"" + std::string(validator) + "\" -V -I\"" + includeRoot + "\" \"" + sourcePath + "\" -o \"" + outputPath.string() + "\" 2>&1";
+
+	FILE *pipe = popen(command.c_str(), "r");
+	if (!pipe) {
+		errors = "cannot run " + std::string(validator);
+		return false;
+	}
+
+	std::string output;
+	char buffer[256];
+	while (std::fgets(buffer, sizeof(buffer), pipe)) {
+		output += buffer;
+	}
+
+	int status = pclose(pipe);
+	bool compiled = status == 0 && ReadSpirvFile(outputPath.string(), spirv);
+
+	std::error_code ec;
+	std::filesystem::remove(outputPath, ec);
+
+	if (!compiled) {
+		errors = output.empty() ? "compilation failed" : output;
+	}
+	return compiled;
+}
+
+#endif
+
+
+std::vector<std::string> vkutils::FindDependentShaders(const std::string &shadersDir, const std::string &includeFile) {
+	std::filesystem::path target = std::filesystem::weakly_canonical(std::filesystem::path(shadersDir) / includeFile);
+
+	std::vector<std::string> dependents;
+
+	for (auto &p : std::filesystem::recursive_directory_iterator(shadersDir)) {
+		if (p.path().extension() != ".comp") {
+			continue;
+		}
+
+		// walk include tree of shader, every file is visited once
+		std::set<std::filesystem::path> visited;
+		std::function<bool(const std::filesystem::path&)> includes = [&](const std::filesystem::path &file) {
+			std::string source;
+			if (!visited.insert(file).second || !ReadTextFile(file, source)) {
+				return false;
+			}
+
+			for (auto &name : ParseIncludes(source)) {
+				std::filesystem::path included = std::filesystem::weakly_canonical(ResolveInclude(file, name, shadersDir));
+				if (included == target || includes(included)) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		if (includes(std::filesystem::weakly_canonical(p.path()))) {
+			dependents.push_back(std::filesystem::relative(p.path(), shadersDir).generic_string());
+		}
+	}
+
+	return dependents;
+}
+
+
+bool vkutils::ReadSpirvFile(const std::string &path, std::vector<uint32_t> &spirv) {
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+		return false;
+	}
+
+	spirv.resize(fileSize / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(spirv.data()), fileSize);
+
+	return file.good();
+}
+
+
+bool vkutils::WriteSpirvFile(const std::string &path, const std::vector<uint32_t> &spirv) {
+	std::string tempPath = path + ".tmp" + std::to_string(UniqueId());
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+		if (!file.good()) {
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkutils {
+	// compiles glsl compute shader to spir-v
+	// includes are searched next to including file and then in includeRoot (shaders folder)
+	// on failure errors holds compiler output
+	bool CompileComputeShader(const std::string &sourcePath, const std::string &includeRoot, std::vector<uint32_t> &spirv, std::string &errors);
+
+	// returns compute shaders (relative to shadersDir) that include file directly or through other includes
+	std::vector<std::string> FindDependentShaders(const std::string &shadersDir, const std::string &includeFile);
+
+	bool ReadSpirvFile(const std::string &path, std::vector<uint32_t> &spirv);
+
+	// writes through temporary file, so shader is never seen half written
+	bool WriteSpirvFile(const std::string &path, const std::vector<uint32_t> &spirv);
+}
@@ -0,0 +1,163 @@
+#include <vk-shader-watcher.hpp>
+
+#include <algorithm>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace vr;
+
+
+bool ShaderWatcher::IsShaderSource(const std::filesystem::path &path) {
+	return path.extension() == ".comp" || path.extension() == ".glsl";
+}
+
+
+#ifdef __linux__
+
+bool ShaderWatcher::Init(const std::string &directory) {
+	m_directory = directory;
+
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0) {
+		spdlog::error("Failed to initialize inotify, shader hot reload is disabled");
+		return false;
+	}
+
+	AddWatch("");
+	for (auto &p : std::filesystem::recursive_directory_iterator(m_directory)) {
+		if (p.is_directory()) {
+			AddWatch(std::filesystem::relative(p.path(), m_directory).generic_string());
+		}
+	}
+
+	spdlog::info("Watching {} for shader changes", m_directory);
+	return true;
+}
+
+
+void ShaderWatcher::Destroy() {
+	if (m_inotifyFd >= 0) {
+		close(m_inotifyFd);  // removes all watches
+		m_inotifyFd = -1;
+	}
+	m_watchedDirs.clear();
+}
+
+
+void ShaderWatcher::AddWatch(const std::string &relativeDir) {
+	std::string fullPath = relativeDir.empty() ? m_directory : (std::filesystem::path(m_directory) / relativeDir).string();
+
+	// editors often save through temporary file and rename, so moves are watched as well
+	int wd = inotify_add_watch(m_inotifyFd, fullPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0) {
+		spdlog::warn("Failed to watch directory {}", fullPath);
+		return;
+	}
+
+	m_watchedDirs[wd] = relativeDir;
+}
+
+
+std::vector<std::string> ShaderWatcher::Poll() {
+	std::vector<std::string> changed;
+	if (m_inotifyFd < 0) {
+		return changed;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break;  // no more events (fd is non blocking)
+		}
+
+		for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len) {
+			const inotify_event *event = reinterpret_cast<const inotify_event*>(ptr);
+			if (event->len == 0) {
+				continue;
+			}
+
+			auto dir = m_watchedDirs.find(event->wd);
+			if (dir == m_watchedDirs.end()) {
+				continue;
+			}
+
+			std::filesystem::path relativePath = std::filesystem::path(dir->second) / event->name;
+
+			if (event->mask & IN_ISDIR) {
+				AddWatch(relativePath.generic_string());  // new subdirectory
+				continue;
+			}
+
+			// new files are reported once they are closed after writing
+			if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && IsShaderSource(relativePath)) {
+				changed.push_back(relativePath.generic_string());
+			}
+		}
+	}
+
+	// one save can produce several events
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+	return changed;
+}
+
+#else
+
+bool ShaderWatcher::Init(const std::string &directory) {
+	m_directory = directory;
+	Scan(nullptr);
+
+	spdlog::info("Watching {} for shader changes (polling)", m_directory);
+	return true;
+}
+
+
+void ShaderWatcher::Destroy() {
+	m_writeTimes.clear();
+}
+
+
+void ShaderWatcher::Scan(std::vector<std::string> *changed) {
+	std::error_code ec;
+	for (auto &p : std::filesystem::recursive_directory_iterator(m_directory, ec)) {
+		if (!p.is_regular_file() || !IsShaderSource(p.path())) {
+			continue;
+		}
+
+		std::string relativePath = std::filesystem::relative(p.path(), m_directory).generic_string();
+		auto writeTime = p.last_write_time(ec);
+
+		auto it = m_writeTimes.find(relativePath);
+		if (it == m_writeTimes.end() || it->second != writeTime) {
+			m_writeTimes[relativePath] = writeTime;
+			if (changed) {
+				changed->push_back(relativePath);
+			}
+		}
+	}
+}
+
+
+std::vector<std::string> ShaderWatcher::Poll() {
+	std::vector<std::string> changed;
+
+	// scanning directory every frame is wasteful, twice a second is enough
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_lastScan < std::chrono::milliseconds(500)) {
+		return changed;
+	}
+	m_lastScan = now;
+
+	Scan(&changed);
+	return changed;
+}
+
+#endif
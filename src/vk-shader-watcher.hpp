@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vr {
+	// watches shader sources (.comp and .glsl files) in directory and its subdirectories
+	// uses inotify on linux and polls modification times elsewhere
+	class ShaderWatcher final {
+	public:
+		bool Init(const std::string &directory);
+		void Destroy();
+
+		// returns sources (relative to watched directory) that were written since last call
+		std::vector<std::string> Poll();
+
+	private:
+		static bool IsShaderSource(const std::filesystem::path &path);
+
+	private:
+		std::string m_directory;
+
+	#ifdef __linux__
+		void AddWatch(const std::string &relativeDir);
+
+		int m_inotifyFd = -1;
+		std::unordered_map<int, std::string> m_watchedDirs;  // watch descriptor -> directory relative to m_directory
+	#else
+		void Scan(std::vector<std::string> *changed);
+
+		std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+		std::chrono::steady_clock::time_point m_lastScan;
+	#endif
+	};
+}
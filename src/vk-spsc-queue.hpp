@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace vr {
+	// bounded lock-free queue for exactly one producer thread and one consumer thread
+	// head and tail only grow, slot is index modulo capacity
+	template<typename T>
+	class SpscQueue final {
+	public:
+		explicit SpscQueue(size_t capacity) : m_items(capacity) {}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue &operator=(const SpscQueue&) = delete;
+
+		// producer, false when queue is full
+		bool Push(const T &item) {
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) == m_items.size()) {
+				return false;
+			}
+			m_items[tail % m_items.size()] = item;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer, false when queue is empty
+		bool Pop(T &item) {
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			item = m_items[head % m_items.size()];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// approximate when called from other threads
+		size_t Size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+		size_t Capacity() const { return m_items.size(); }
+
+	private:
+		std::vector<T> m_items;
+
+		// on separate cache lines, so producer and consumer do not invalidate each other
+		alignas(64) std::atomic<size_t> m_head{0};
+		alignas(64) std::atomic<size_t> m_tail{0};
+	};
+}
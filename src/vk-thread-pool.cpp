@@ -0,0 +1,173 @@
+#include <vk-thread-pool.hpp>
+
+#include <algorithm>
+
+using namespace vr;
+
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(threadCount);
+	for (uint32_t i = 0; i != threadCount; ++i) {
+		m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+
+	for (auto &worker : m_workers) {
+		worker.join();
+	}
+}
+
+
+void ThreadPool::Submit(std::function<void()> &&task, bool urgent) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (urgent) {
+			m_tasks.push_front(std::move(task));
+		} else {
+			m_tasks.push_back(std::move(task));
+		}
+	}
+	m_taskAvailable.notify_one();
+}
+
+
+void ThreadPool::Clear() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.clear();
+	}
+	m_idle.notify_all();
+}
+
+
+void ThreadPool::WaitIdle() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_tasks.empty() && m_activeTasks == 0; });
+}
+
+
+void ThreadPool::WorkerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+			if (m_stopping && m_tasks.empty()) {
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			m_activeTasks++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeTasks--;
+		}
+		m_idle.notify_all();
+	}
+}
+
+
+ParallelWorkers::ParallelWorkers(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 1; i < threadCount; ++i) {
+		m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+
+ParallelWorkers::~ParallelWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_start.notify_all();
+
+	for (auto &worker : m_workers) {
+		worker.join();
+	}
+}
+
+
+void ParallelWorkers::Run(uint32_t partCount, void (*function)(void *context, uint32_t part), void *context) {
+	Job job{function, context, partCount};
+	if (m_workers.empty() || partCount < 2) {
+		for (uint32_t part = 0; part != partCount; ++part) {
+			function(context, part);
+		}
+		return;
+	}
+
+	{
+		// worker that woke up late can still hold previous job, part counter is reset only after it saw all parts taken
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this]() { return m_activeWorkers == 0; });
+		m_job = job;
+		m_nextPart.store(0, std::memory_order_relaxed);
+		m_generation++;
+	}
+	m_start.notify_all();
+
+	RunParts(job);
+
+	// workers that took this job are done with it before it returns
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_activeWorkers == 0; });
+}
+
+
+void ParallelWorkers::WorkerLoop() {
+	uint64_t generation = 0;
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+			if (m_stopping) {
+				return;
+			}
+			generation = m_generation;
+			job = m_job;
+			m_activeWorkers++;
+		}
+
+		RunParts(job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeWorkers--;
+		}
+		m_done.notify_one();
+	}
+}
+
+
+void ParallelWorkers::RunParts(const Job &job) {
+	while (true) {
+		uint32_t part = m_nextPart.fetch_add(1, std::memory_order_relaxed);
+		if (part >= job.partCount) {
+			return;
+		}
+		job.function(job.context, part);
+	}
+}
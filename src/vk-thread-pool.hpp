@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vr {
+	// fixed set of worker threads that execute submitted tasks in order
+	class ThreadPool final {
+	public:
+		// 0 threads means one thread per hardware core
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool &operator=(const ThreadPool&) = delete;
+
+		// urgent tasks are put in front of the queue
+		void Submit(std::function<void()> &&task, bool urgent = false);
+
+		// drops tasks that have not started yet
+		void Clear();
+
+		// blocks until queue is empty and no task is running
+		void WaitIdle();
+
+		uint32_t Size() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	private:
+		void WorkerLoop();
+
+	private:
+		std::vector<std::thread>          m_workers;
+		std::deque<std::function<void()>> m_tasks;
+		std::mutex                        m_mutex;
+		std::condition_variable           m_taskAvailable;
+		std::condition_variable           m_idle;
+		uint32_t                          m_activeTasks = 0;
+		bool                              m_stopping = false;
+	};
+
+
+	// fixed set of threads that run one job split into numbered parts, calling thread runs parts too
+	// threads wait for next job, so running a job does not allocate or create threads
+	class ParallelWorkers final {
+	public:
+		// threads including calling thread, 0 means one per core
+		explicit ParallelWorkers(uint32_t threadCount = 0);
+		~ParallelWorkers();
+
+		ParallelWorkers(const ParallelWorkers&) = delete;
+		ParallelWorkers &operator=(const ParallelWorkers&) = delete;
+
+		// calls function(part) for every part, returns when all are done
+		template <typename F>
+		void Run(uint32_t partCount, F &&function) {
+			using Function = std::remove_reference_t<F>;
+			Run(partCount, [](void *context, uint32_t part) { (*static_cast<Function*>(context))(part); }, const_cast<void*>(static_cast<const void*>(&function)));
+		}
+		void Run(uint32_t partCount, void (*function)(void *context, uint32_t part), void *context);
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+	private:
+		struct Job {
+			void   (*function)(void *context, uint32_t part) = nullptr;
+			void    *context = nullptr;
+			uint32_t partCount = 0;
+		};
+
+		void WorkerLoop();
+		void RunParts(const Job &job);
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex               m_mutex;
+		std::condition_variable  m_start;
+		std::condition_variable  m_done;
+		uint64_t                 m_generation = 0;  // increased for every job
+		uint32_t                 m_activeWorkers = 0;
+		bool                     m_stopping = false;
+
+		Job                   m_job;
+		std::atomic<uint32_t> m_nextPart{0};
+	};
+}
@@ -8,6 +8,7 @@
 #include <array>
 #include <functional>
 #include <deque>
+#include <map>
 #include <iostream>
 
 #include <vulkan/vulkan.h>
@@ -20,6 +21,8 @@
 #define FMT_UNICODE 0
 #include <spdlog/spdlog.h>
 
+#include <vk-reflection.hpp>
+
 #define VK_CHECK(x)                                                                   \
     do {                                                                              \
         VkResult err = x;                                                             \
@@ -35,7 +38,7 @@ namespace vr {
 		std::deque<std::function<void()>> deletors;
 
 		void PushFunction(std::function<void()> &&function) {
-			deletors.push_back(function);
+			deletors.push_back(std::move(function));
 		}
 
 		void flush() {
@@ -47,36 +50,103 @@ namespace vr {
 		}
 	};
 
+
+	struct AllocatedImage {
+		VkImage image;
+		VkImageView imageView;
+		VmaAllocation allocation;
+		VkExtent3D imageExtent;
+		VkFormat imageFormat;
+	};
+
+	struct AllocatedBuffer {
+		VkBuffer buffer;
+		VmaAllocation allocation;
+		VmaAllocationInfo info;
+	};
+
+	// command buffer that is submitted again while nothing it was recorded with changes (see --prerecorded-frames)
+	struct RecordedFrame {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t        generation = 0;   // recordings of older generations are recorded again
+		VkExtent2D      extent{};         // rendered part of render image
+		bool            directOutput = false;
+		uint32_t        gpuPhases = 0;    // profiler phases that it writes
+	};
+
 	// structures and commands needed to draw one frame in flight
 	struct FrameData {
 		VkCommandPool   commandPool;
 		VkCommandBuffer mainCommandBuffer;
+
+		// effect dispatch on compute queue (async compute only)
+		VkCommandPool   computeCommandPool = VK_NULL_HANDLE;
+		VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
 		VkSemaphore     swapchainSemaphore;
 		VkSemaphore     renderSemaphore;
-		VkFence         renderFence;
-		DeletionQueue   deletionQueue;
+		VkFence         renderFence;         // used by fence pacing only
+		uint64_t        timelineValue = 0;   // value of frame timeline that last submit of this slot signals
+
+		// prerecorded frames, one per effect and swapchain image, allocated from commandPool
+		std::vector<RecordedFrame> recordedFrames;
 	};
 
-	struct AllocatedImage {
-		VkImage image;
-		VkImageView imageView;
-		VmaAllocation allocation;
-		VkExtent3D imageExtent;
-		VkFormat imageFormat;
+	// values that engine writes into push constant members with matching name every frame
+	enum class EngineInput {
+		Data1,   // vec4(time, aspect, mouse x, mouse y)
+		Time,    // float, seconds
+		Aspect,  // float, width / height
+		Mouse,   // vec2, 0..1
+		Resolution,  // vec2, rendered size in pixels (can be smaller than render image)
+	};
+
+	struct EngineInputSlot {
+		EngineInput input;
+		uint32_t    offset;
 	};
 
-	struct ComputePushConstants {
-		glm::vec4 data1;
-		glm::vec4 data2;
-		glm::vec4 data3;
-		glm::vec4 data4;
+	// resources for effect bindings other than render image
+	struct EffectResources {
+		VkDescriptorPool             descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> descriptorSets;  // one for every set index
+		std::vector<AllocatedImage>  images;
+		std::vector<AllocatedBuffer> buffers;
+		std::vector<uint32_t>        imageHandles;   // entries of bindless table
+		std::vector<uint32_t>        bufferHandles;
 	};
 
 	struct ComputeEffect {
 		std::string name;
-		VkPipeline pipeline;
+		std::string shaderPath;
+		std::string sourcePath;  // glsl source, empty if it was not found (effect is not hot reloaded)
+		VkPipeline pipeline;  // VK_NULL_HANDLE until it is built
 		VkPipelineLayout layout;
-		ComputePushConstants data;
+
+		// specialization variants of current code, built on first use
+		std::shared_ptr<const std::vector<uint32_t>>   spirv;
+		std::vector<uint32_t>                          specValues;  // selected values, in order of reflection.specConstants
+		std::vector<uint32_t>                          activeValues;  // values of running pipeline (differ while selected variant is built)
+		std::map<std::vector<uint32_t>, VkPipeline>    variants;    // pipeline is one of them
+		std::vector<std::vector<uint32_t>>             variantsBuilding;
+
+		// interface of shader, push constants are stored as raw bytes that overlay edits
+		ShaderReflection             reflection;
+		std::vector<uint8_t>         pushData;
+		std::vector<std::vector<uint8_t>> parameterData;  // contents of every reflection.parameterBlocks, addresses are in pushData
+		std::vector<EngineInputSlot> inputs;
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::string                  resourceKey;  // resources are recreated when it changes
+		EffectResources              resources;     // empty when render image is the only binding
+
+		// copy of running pipeline that reads push constants from parameter buffer (prerecorded frames)
+		// it is running pipeline itself when effect has no push constants
+		VkPipeline       recordedPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout recordedLayout = VK_NULL_HANDLE;
+		VkPipeline       recordedSource = VK_NULL_HANDLE;  // pipeline that copy was made from
+
+		// hot reload
+		uint32_t buildGeneration = 0;  // latest requested build, older builds are dropped when they finish
+		std::string compileError;      // error of latest build, last good pipeline keeps running
 	};
 }
 
@@ -0,0 +1,112 @@
+#include <vk-workgroup-tuning.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#define FMT_UNICODE 0
+#include <spdlog/spdlog.h>
+
+using namespace vr;
+
+
+void WorkgroupTuning::Load(const std::string &path, const uint8_t deviceUUID[VK_UUID_SIZE]) {
+	m_path = path;
+	m_entries.clear();
+
+	m_device.clear();
+	for (int i = 0; i != VK_UUID_SIZE; ++i) {
+		m_device += fmt::format("{:02x}", deviceUUID[i]);
+	}
+
+	if (m_path.empty()) {
+		return;
+	}
+
+	std::ifstream file(m_path);
+	if (!file.is_open()) {
+		return;  // nothing was tuned yet
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream stream(line);
+		Entry entry{};
+		if (!(stream >> entry.device >> entry.x >> entry.y) || entry.x == 0 || entry.y == 0) {
+			spdlog::warn("Skipping invalid line in {}: {}", m_path, line);
+			continue;
+		}
+
+		// rest of line is effect name (it can contain spaces)
+		std::getline(stream >> std::ws, entry.effect);
+		m_entries.push_back(entry);
+	}
+
+	size_t tuned = std::count_if(m_entries.begin(), m_entries.end(), [&](const Entry &e) { return e.device == m_device; });
+	spdlog::info("Loaded workgroup sizes of {} effects for this device from {}", tuned, m_path);
+}
+
+
+bool WorkgroupTuning::Save() const {
+	if (m_path.empty()) {
+		return false;
+	}
+
+	// write to unique temporary file and rename it, so other players never read partial file
+	uint64_t uniqueId = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	std::string tmpPath = m_path + ".tmp" + std::to_string(uniqueId);
+	{
+		std::ofstream file(tmpPath, std::ios::trunc);
+		if (!file.is_open()) {
+			spdlog::error("Failed to write workgroup sizes: {}", tmpPath);
+			return false;
+		}
+
+		file << "# device uuid, workgroup size x, y, effect (written by --autotune)\n";
+		for (auto &entry : m_entries) {
+			file << entry.device << ' ' << entry.x << ' ' << entry.y << ' ' << entry.effect << '\n';
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, m_path, ec);
+	if (ec) {
+		spdlog::error("Failed to replace {}: {}", m_path, ec.message());
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	spdlog::info("Saved workgroup sizes to {}", m_path);
+	return true;
+}
+
+
+bool WorkgroupTuning::Get(const std::string &effectName, uint32_t &x, uint32_t &y) const {
+	for (auto &entry : m_entries) {
+		if (entry.device == m_device && entry.effect == effectName) {
+			x = entry.x;
+			y = entry.y;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void WorkgroupTuning::Set(const std::string &effectName, uint32_t x, uint32_t y) {
+	for (auto &entry : m_entries) {
+		if (entry.device == m_device && entry.effect == effectName) {
+			entry.x = x;
+			entry.y = y;
+			return;
+		}
+	}
+	m_entries.push_back({m_device, effectName, x, y});
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace vr {
+	// best workgroup size of every effect, found by autotune and stored per device
+	// file has one line per device and effect: "<device uuid> <x> <y> <effect name>"
+	class WorkgroupTuning final {
+	public:
+		void Load(const std::string &path, const uint8_t deviceUUID[VK_UUID_SIZE]);
+		bool Save() const;
+
+		// returns false if effect was not tuned on this device
+		bool Get(const std::string &effectName, uint32_t &x, uint32_t &y) const;
+		void Set(const std::string &effectName, uint32_t x, uint32_t y);
+
+	private:
+		struct Entry {
+			std::string device;
+			std::string effect;
+			uint32_t    x;
+			uint32_t    y;
+		};
+
+		std::string        m_path;    // empty if tuning file is disabled
+		std::string        m_device;  // uuid of current device as hex string
+		std::vector<Entry> m_entries; // entries of all devices, so saving keeps results of other devices
+	};
+}